@@ -79,7 +79,16 @@ How to build
                               Default: OFF
        APU_HAVE_ODBC          Build ODBC DBD driver
                               Default: ON
-       APR_BUILD_TESTAPR      Build APR-Util test suite
+       APU_HAVE_ZLIB          Build the deflate and gzip brigade codecs,
+                              using zlib
+                              Default: OFF
+       APU_HAVE_ZSTD          Build the Zstandard brigade codec, using
+                              libzstd 1.4 or later (found through its
+                              CMake package)
+                              Default: OFF
+       APR_BUILD_TESTAPR      Build APR-Util test suite, and the bucket
+                              benchmarks built and run by the "bench"
+                              target
                               Default: OFF
        TEST_STATIC_LIBS       Build the test suite to test the APR static
                               library instead of the APR dynamic library.
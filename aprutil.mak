@@ -58,8 +58,13 @@ CLEAN :
 !ENDIF 
 	-@erase "$(INTDIR)\apr_base64.obj"
 	-@erase "$(INTDIR)\apr_brigade.obj"
+	-@erase "$(INTDIR)\apr_brigade_array.obj"
+	-@erase "$(INTDIR)\apr_brigade_codec.obj"
+	-@erase "$(INTDIR)\apr_brigade_cursor.obj"
+	-@erase "$(INTDIR)\apr_brigade_digest.obj"
 	-@erase "$(INTDIR)\apr_buckets.obj"
 	-@erase "$(INTDIR)\apr_buckets_alloc.obj"
+	-@erase "$(INTDIR)\apr_buckets_atomic.obj"
 	-@erase "$(INTDIR)\apr_buckets_eos.obj"
 	-@erase "$(INTDIR)\apr_buckets_file.obj"
 	-@erase "$(INTDIR)\apr_buckets_flush.obj"
@@ -70,6 +75,7 @@ CLEAN :
 	-@erase "$(INTDIR)\apr_buckets_refcount.obj"
 	-@erase "$(INTDIR)\apr_buckets_simple.obj"
 	-@erase "$(INTDIR)\apr_buckets_socket.obj"
+	-@erase "$(INTDIR)\apr_buckets_splice.obj"
 	-@erase "$(INTDIR)\apr_crypto.obj"
 	-@erase "$(INTDIR)\apr_date.obj"
 	-@erase "$(INTDIR)\apr_dbd.obj"
@@ -162,8 +168,13 @@ LIB32=link.exe -lib
 LIB32_FLAGS=/nologo /out:"$(OUTDIR)\aprutil-1.lib" 
 LIB32_OBJS= \
 	"$(INTDIR)\apr_brigade.obj" \
+	"$(INTDIR)\apr_brigade_array.obj" \
+	"$(INTDIR)\apr_brigade_codec.obj" \
+	"$(INTDIR)\apr_brigade_cursor.obj" \
+	"$(INTDIR)\apr_brigade_digest.obj" \
 	"$(INTDIR)\apr_buckets.obj" \
 	"$(INTDIR)\apr_buckets_alloc.obj" \
+	"$(INTDIR)\apr_buckets_atomic.obj" \
 	"$(INTDIR)\apr_buckets_eos.obj" \
 	"$(INTDIR)\apr_buckets_file.obj" \
 	"$(INTDIR)\apr_buckets_flush.obj" \
@@ -174,6 +185,7 @@ LIB32_OBJS= \
 	"$(INTDIR)\apr_buckets_refcount.obj" \
 	"$(INTDIR)\apr_buckets_simple.obj" \
 	"$(INTDIR)\apr_buckets_socket.obj" \
+	"$(INTDIR)\apr_buckets_splice.obj" \
 	"$(INTDIR)\apr_crypto.obj" \
 	"$(INTDIR)\apr_md4.obj" \
 	"$(INTDIR)\apr_md5.obj" \
@@ -250,8 +262,13 @@ CLEAN :
 !ENDIF 
 	-@erase "$(INTDIR)\apr_base64.obj"
 	-@erase "$(INTDIR)\apr_brigade.obj"
+	-@erase "$(INTDIR)\apr_brigade_array.obj"
+	-@erase "$(INTDIR)\apr_brigade_codec.obj"
+	-@erase "$(INTDIR)\apr_brigade_cursor.obj"
+	-@erase "$(INTDIR)\apr_brigade_digest.obj"
 	-@erase "$(INTDIR)\apr_buckets.obj"
 	-@erase "$(INTDIR)\apr_buckets_alloc.obj"
+	-@erase "$(INTDIR)\apr_buckets_atomic.obj"
 	-@erase "$(INTDIR)\apr_buckets_eos.obj"
 	-@erase "$(INTDIR)\apr_buckets_file.obj"
 	-@erase "$(INTDIR)\apr_buckets_flush.obj"
@@ -262,6 +279,7 @@ CLEAN :
 	-@erase "$(INTDIR)\apr_buckets_refcount.obj"
 	-@erase "$(INTDIR)\apr_buckets_simple.obj"
 	-@erase "$(INTDIR)\apr_buckets_socket.obj"
+	-@erase "$(INTDIR)\apr_buckets_splice.obj"
 	-@erase "$(INTDIR)\apr_crypto.obj"
 	-@erase "$(INTDIR)\apr_date.obj"
 	-@erase "$(INTDIR)\apr_dbd.obj"
@@ -359,8 +377,13 @@ LIB32=link.exe -lib
 LIB32_FLAGS=/nologo /out:"$(OUTDIR)\aprutil-1.lib" 
 LIB32_OBJS= \
 	"$(INTDIR)\apr_brigade.obj" \
+	"$(INTDIR)\apr_brigade_array.obj" \
+	"$(INTDIR)\apr_brigade_codec.obj" \
+	"$(INTDIR)\apr_brigade_cursor.obj" \
+	"$(INTDIR)\apr_brigade_digest.obj" \
 	"$(INTDIR)\apr_buckets.obj" \
 	"$(INTDIR)\apr_buckets_alloc.obj" \
+	"$(INTDIR)\apr_buckets_atomic.obj" \
 	"$(INTDIR)\apr_buckets_eos.obj" \
 	"$(INTDIR)\apr_buckets_file.obj" \
 	"$(INTDIR)\apr_buckets_flush.obj" \
@@ -371,6 +394,7 @@ LIB32_OBJS= \
 	"$(INTDIR)\apr_buckets_refcount.obj" \
 	"$(INTDIR)\apr_buckets_simple.obj" \
 	"$(INTDIR)\apr_buckets_socket.obj" \
+	"$(INTDIR)\apr_buckets_splice.obj" \
 	"$(INTDIR)\apr_crypto.obj" \
 	"$(INTDIR)\apr_md4.obj" \
 	"$(INTDIR)\apr_md5.obj" \
@@ -447,8 +471,13 @@ CLEAN :
 !ENDIF 
 	-@erase "$(INTDIR)\apr_base64.obj"
 	-@erase "$(INTDIR)\apr_brigade.obj"
+	-@erase "$(INTDIR)\apr_brigade_array.obj"
+	-@erase "$(INTDIR)\apr_brigade_codec.obj"
+	-@erase "$(INTDIR)\apr_brigade_cursor.obj"
+	-@erase "$(INTDIR)\apr_brigade_digest.obj"
 	-@erase "$(INTDIR)\apr_buckets.obj"
 	-@erase "$(INTDIR)\apr_buckets_alloc.obj"
+	-@erase "$(INTDIR)\apr_buckets_atomic.obj"
 	-@erase "$(INTDIR)\apr_buckets_eos.obj"
 	-@erase "$(INTDIR)\apr_buckets_file.obj"
 	-@erase "$(INTDIR)\apr_buckets_flush.obj"
@@ -459,6 +488,7 @@ CLEAN :
 	-@erase "$(INTDIR)\apr_buckets_refcount.obj"
 	-@erase "$(INTDIR)\apr_buckets_simple.obj"
 	-@erase "$(INTDIR)\apr_buckets_socket.obj"
+	-@erase "$(INTDIR)\apr_buckets_splice.obj"
 	-@erase "$(INTDIR)\apr_crypto.obj"
 	-@erase "$(INTDIR)\apr_date.obj"
 	-@erase "$(INTDIR)\apr_dbd.obj"
@@ -556,8 +586,13 @@ LIB32=link.exe -lib
 LIB32_FLAGS=/nologo /out:"$(OUTDIR)\aprutil-1.lib" 
 LIB32_OBJS= \
 	"$(INTDIR)\apr_brigade.obj" \
+	"$(INTDIR)\apr_brigade_array.obj" \
+	"$(INTDIR)\apr_brigade_codec.obj" \
+	"$(INTDIR)\apr_brigade_cursor.obj" \
+	"$(INTDIR)\apr_brigade_digest.obj" \
 	"$(INTDIR)\apr_buckets.obj" \
 	"$(INTDIR)\apr_buckets_alloc.obj" \
+	"$(INTDIR)\apr_buckets_atomic.obj" \
 	"$(INTDIR)\apr_buckets_eos.obj" \
 	"$(INTDIR)\apr_buckets_file.obj" \
 	"$(INTDIR)\apr_buckets_flush.obj" \
@@ -568,6 +603,7 @@ LIB32_OBJS= \
 	"$(INTDIR)\apr_buckets_refcount.obj" \
 	"$(INTDIR)\apr_buckets_simple.obj" \
 	"$(INTDIR)\apr_buckets_socket.obj" \
+	"$(INTDIR)\apr_buckets_splice.obj" \
 	"$(INTDIR)\apr_crypto.obj" \
 	"$(INTDIR)\apr_md4.obj" \
 	"$(INTDIR)\apr_md5.obj" \
@@ -644,8 +680,13 @@ CLEAN :
 !ENDIF 
 	-@erase "$(INTDIR)\apr_base64.obj"
 	-@erase "$(INTDIR)\apr_brigade.obj"
+	-@erase "$(INTDIR)\apr_brigade_array.obj"
+	-@erase "$(INTDIR)\apr_brigade_codec.obj"
+	-@erase "$(INTDIR)\apr_brigade_cursor.obj"
+	-@erase "$(INTDIR)\apr_brigade_digest.obj"
 	-@erase "$(INTDIR)\apr_buckets.obj"
 	-@erase "$(INTDIR)\apr_buckets_alloc.obj"
+	-@erase "$(INTDIR)\apr_buckets_atomic.obj"
 	-@erase "$(INTDIR)\apr_buckets_eos.obj"
 	-@erase "$(INTDIR)\apr_buckets_file.obj"
 	-@erase "$(INTDIR)\apr_buckets_flush.obj"
@@ -656,6 +697,7 @@ CLEAN :
 	-@erase "$(INTDIR)\apr_buckets_refcount.obj"
 	-@erase "$(INTDIR)\apr_buckets_simple.obj"
 	-@erase "$(INTDIR)\apr_buckets_socket.obj"
+	-@erase "$(INTDIR)\apr_buckets_splice.obj"
 	-@erase "$(INTDIR)\apr_crypto.obj"
 	-@erase "$(INTDIR)\apr_date.obj"
 	-@erase "$(INTDIR)\apr_dbd.obj"
@@ -753,8 +795,13 @@ LIB32=link.exe -lib
 LIB32_FLAGS=/nologo /out:"$(OUTDIR)\aprutil-1.lib" 
 LIB32_OBJS= \
 	"$(INTDIR)\apr_brigade.obj" \
+	"$(INTDIR)\apr_brigade_array.obj" \
+	"$(INTDIR)\apr_brigade_codec.obj" \
+	"$(INTDIR)\apr_brigade_cursor.obj" \
+	"$(INTDIR)\apr_brigade_digest.obj" \
 	"$(INTDIR)\apr_buckets.obj" \
 	"$(INTDIR)\apr_buckets_alloc.obj" \
+	"$(INTDIR)\apr_buckets_atomic.obj" \
 	"$(INTDIR)\apr_buckets_eos.obj" \
 	"$(INTDIR)\apr_buckets_file.obj" \
 	"$(INTDIR)\apr_buckets_flush.obj" \
@@ -765,6 +812,7 @@ LIB32_OBJS= \
 	"$(INTDIR)\apr_buckets_refcount.obj" \
 	"$(INTDIR)\apr_buckets_simple.obj" \
 	"$(INTDIR)\apr_buckets_socket.obj" \
+	"$(INTDIR)\apr_buckets_splice.obj" \
 	"$(INTDIR)\apr_crypto.obj" \
 	"$(INTDIR)\apr_md4.obj" \
 	"$(INTDIR)\apr_md5.obj" \
@@ -835,6 +883,30 @@ SOURCE=.\buckets\apr_brigade.c
 	$(CPP) $(CPP_PROJ) $(SOURCE)
 
 
+SOURCE=.\buckets\apr_brigade_array.c
+
+"$(INTDIR)\apr_brigade_array.obj" : $(SOURCE) "$(INTDIR)" ".\include\apu.h"
+	$(CPP) $(CPP_PROJ) $(SOURCE)
+
+
+SOURCE=.\buckets\apr_brigade_codec.c
+
+"$(INTDIR)\apr_brigade_codec.obj" : $(SOURCE) "$(INTDIR)" ".\include\apu.h"
+	$(CPP) $(CPP_PROJ) $(SOURCE)
+
+
+SOURCE=.\buckets\apr_brigade_cursor.c
+
+"$(INTDIR)\apr_brigade_cursor.obj" : $(SOURCE) "$(INTDIR)" ".\include\apu.h"
+	$(CPP) $(CPP_PROJ) $(SOURCE)
+
+
+SOURCE=.\buckets\apr_brigade_digest.c
+
+"$(INTDIR)\apr_brigade_digest.obj" : $(SOURCE) "$(INTDIR)" ".\include\apu.h"
+	$(CPP) $(CPP_PROJ) $(SOURCE)
+
+
 SOURCE=.\buckets\apr_buckets.c
 
 "$(INTDIR)\apr_buckets.obj" : $(SOURCE) "$(INTDIR)" ".\include\apu.h"
@@ -847,6 +919,12 @@ SOURCE=.\buckets\apr_buckets_alloc.c
 	$(CPP) $(CPP_PROJ) $(SOURCE)
 
 
+SOURCE=.\buckets\apr_buckets_atomic.c
+
+"$(INTDIR)\apr_buckets_atomic.obj" : $(SOURCE) "$(INTDIR)" ".\include\apu.h"
+	$(CPP) $(CPP_PROJ) $(SOURCE)
+
+
 SOURCE=.\buckets\apr_buckets_eos.c
 
 "$(INTDIR)\apr_buckets_eos.obj" : $(SOURCE) "$(INTDIR)" ".\include\apu.h"
@@ -907,6 +985,12 @@ SOURCE=.\buckets\apr_buckets_socket.c
 	$(CPP) $(CPP_PROJ) $(SOURCE)
 
 
+SOURCE=.\buckets\apr_buckets_splice.c
+
+"$(INTDIR)\apr_buckets_splice.obj" : $(SOURCE) "$(INTDIR)" ".\include\private\apu_config.h" ".\include\apu.h"
+	$(CPP) $(CPP_PROJ) $(SOURCE)
+
+
 SOURCE=.\crypto\apr_crypto.c
 
 "$(INTDIR)\apr_crypto.obj" : $(SOURCE) "$(INTDIR)" ".\include\private\apu_config.h" ".\include\apu.h"
@@ -19,7 +19,9 @@
 #include "apr_strings.h"
 #include "apr_pools.h"
 #include "apr_tables.h"
+#include "apr_hash.h"
 #include "apr_buckets.h"
+#include "apr_buckets_internal.h"
 #include "apr_errno.h"
 #define APR_WANT_MEMFUNC
 #define APR_WANT_STRFUNC
@@ -47,10 +49,16 @@ APU_DECLARE(apr_status_t) apr_brigade_cleanup(void *data)
     return APR_SUCCESS;
 }
 
+static void spool_file_destroy(apr_bucket_brigade *b);
+
 APU_DECLARE(apr_status_t) apr_brigade_destroy(apr_bucket_brigade *b)
 {
+    apr_status_t rv;
+
     apr_pool_cleanup_kill(b->p, b, brigade_cleanup);
-    return apr_brigade_cleanup(b);
+    rv = apr_brigade_cleanup(b);
+    spool_file_destroy(b);
+    return rv;
 }
 
 APU_DECLARE(apr_bucket_brigade *) apr_brigade_create(apr_pool_t *p,
@@ -389,6 +397,27 @@ memmem(const void *_hay, size_t hay_len, const void *needle, size_t needle_len)
 }
 #endif
 
+/*
+ * Find the first position from which the rest of str is the beginning of
+ * the boundary, where a boundary spanning buckets may start.
+ *
+ * Only the positions holding the first byte of the boundary are compared,
+ * found with memchr(), rather than comparing at every offset.
+ */
+static const char *boundary_prefix(const char *str, apr_size_t len,
+                                   const char *boundary)
+{
+    const char *end = str + len;
+
+    while (str < end && (str = memchr(str, boundary[0], end - str))) {
+        if (!memcmp(str, boundary, end - str)) {
+            return str;
+        }
+        str++;
+    }
+
+    return NULL;
+}
 
 APU_DECLARE(apr_status_t) apr_brigade_split_boundary(apr_bucket_brigade *bbOut,
                                                      apr_bucket_brigade *bbIn,
@@ -484,26 +513,25 @@ APU_DECLARE(apr_status_t) apr_brigade_split_boundary(apr_bucket_brigade *bbOut,
             leftover = boundary_len - 1;
             off = (len - leftover);
 
-            while (leftover) {
-                if (!memcmp(str + off, boundary, leftover)) {
-
-                    if (off) {
+            pos = boundary_prefix(str + off, leftover, boundary);
+            if (pos != NULL) {
 
-                        apr_bucket_split(e, off);
-                        APR_BUCKET_REMOVE(e);
-                        APR_BRIGADE_INSERT_TAIL(bbOut, e);
-                        ignore = 0;
+                off = pos - str;
 
-                        e = APR_BRIGADE_FIRST(bbIn);
-                    }
+                if (off) {
 
-                    outbytes += off;
-                    inbytes -= off;
+                    apr_bucket_split(e, off);
+                    APR_BUCKET_REMOVE(e);
+                    APR_BRIGADE_INSERT_TAIL(bbOut, e);
+                    ignore = 0;
 
-                    goto skip;
+                    e = APR_BRIGADE_FIRST(bbIn);
                 }
-                off++;
-                leftover--;
+
+                outbytes += off;
+                inbytes -= off;
+
+                goto skip;
             }
 
             APR_BUCKET_REMOVE(e);
@@ -529,28 +557,28 @@ APU_DECLARE(apr_status_t) apr_brigade_split_boundary(apr_bucket_brigade *bbOut,
             len -= ignore;
 
             /* find all definite non matches */
-            while (len) {
-                if (!memcmp(str + off, boundary, len)) {
-
-                    if (off) {
+            pos = boundary_prefix(str + off, len, boundary);
+            if (pos != NULL) {
 
-                        apr_bucket_split(e, off);
-                        APR_BUCKET_REMOVE(e);
-                        APR_BRIGADE_INSERT_TAIL(bbOut, e);
-                        ignore = 0;
+                off = pos - str;
 
-                        outbytes += off;
+                if (off) {
 
-                        e = APR_BRIGADE_FIRST(bbIn);
-                    }
+                    apr_bucket_split(e, off);
+                    APR_BUCKET_REMOVE(e);
+                    APR_BRIGADE_INSERT_TAIL(bbOut, e);
+                    ignore = 0;
 
-                    inbytes -= off;
+                    outbytes += off;
 
-                    goto skip;
+                    e = APR_BRIGADE_FIRST(bbIn);
                 }
-                off++;
-                len--;
+
+                inbytes -= off;
+
+                goto skip;
             }
+            off += len;
 
             APR_BUCKET_REMOVE(e);
             APR_BRIGADE_INSERT_TAIL(bbOut, e);
@@ -662,6 +690,84 @@ skip:
 }
 
 
+/* Whether the bucket is small enough and in memory, so that coalescing
+ * it with its neighbours is worth the copy.
+ */
+static int coalesce_candidate(apr_bucket *e, apr_size_t min_chunk)
+{
+    return e->length < min_chunk
+           && (APR_BUCKET_IS_HEAP(e) || APR_BUCKET_IS_TRANSIENT(e)
+               || APR_BUCKET_IS_IMMORTAL(e) || APR_BUCKET_IS_POOL(e)
+               || APR_BUCKET_IS_ATOMIC(e)
+#if APR_HAS_MMAP
+               || APR_BUCKET_IS_MMAP(e)
+#endif
+               );
+}
+
+APU_DECLARE(apr_status_t) apr_brigade_coalesce(apr_bucket_brigade *bb,
+                                               apr_size_t min_chunk,
+                                               apr_size_t max_chunk)
+{
+    apr_bucket *e, *next, *start, *end;
+    apr_status_t rv;
+
+    if (max_chunk < min_chunk) {
+        max_chunk = min_chunk;
+    }
+
+    for (e = APR_BRIGADE_FIRST(bb); e != APR_BRIGADE_SENTINEL(bb); e = end) {
+        apr_size_t total, count;
+        char *buf, *pos;
+
+        end = APR_BUCKET_NEXT(e);
+        if (!coalesce_candidate(e, min_chunk)) {
+            continue;
+        }
+
+        /* find the run of small buckets fitting in one chunk */
+        total = e->length;
+        count = 1;
+        while (end != APR_BRIGADE_SENTINEL(bb)
+               && coalesce_candidate(end, min_chunk)
+               && total + end->length <= max_chunk) {
+            total += end->length;
+            count++;
+            end = APR_BUCKET_NEXT(end);
+        }
+        if (count < 2) {
+            continue;
+        }
+
+        buf = pos = apr_bucket_alloc(total, bb->bucket_alloc);
+        for (start = e; e != end; e = next) {
+            const char *str;
+            apr_size_t len;
+
+            next = APR_BUCKET_NEXT(e);
+
+            rv = apr_bucket_read(e, &str, &len, APR_BLOCK_READ);
+            if (rv != APR_SUCCESS) {
+                apr_bucket_free(buf);
+                return rv;
+            }
+            memcpy(pos, str, len);
+            pos += len;
+        }
+
+        /* all read, only now replace them */
+        for (e = start; e != end; e = next) {
+            next = APR_BUCKET_NEXT(e);
+            apr_bucket_delete(e);
+        }
+        APR_BUCKET_INSERT_BEFORE(end, apr_bucket_heap_create(buf, total,
+                                                             apr_bucket_free,
+                                                             bb->bucket_alloc));
+    }
+
+    return APR_SUCCESS;
+}
+
 APU_DECLARE(apr_status_t) apr_brigade_to_iovec(apr_bucket_brigade *b, 
                                                struct iovec *vec, int *nvec)
 {
@@ -697,6 +803,172 @@ APU_DECLARE(apr_status_t) apr_brigade_to_iovec(apr_bucket_brigade *b,
     return APR_SUCCESS;
 }
 
+/* The maximum number of iovecs and in-memory bytes gathered by
+ * apr_brigade_send() for a single call to the network.
+ */
+#define MAX_IOVEC_TO_SEND 64
+#define MAX_BYTES_TO_SEND 65536
+
+/* File buckets smaller than this are read rather than sendfile()d, the
+ * system call costing more than the copy.
+ */
+#define MIN_SENDFILE_BYTES 256
+
+/* Remove the first amount bytes from the brigade, splitting the bucket
+ * where the last byte lands, along with the metadata and empty buckets
+ * that follow.
+ */
+static void brigade_consume(apr_bucket_brigade *bb, apr_size_t amount)
+{
+    while (!APR_BRIGADE_EMPTY(bb)) {
+        apr_bucket *e = APR_BRIGADE_FIRST(bb);
+
+        if (e->length == (apr_size_t)(-1)) {
+            break;
+        }
+        if (e->length > amount) {
+            if (amount) {
+                apr_bucket_split(e, amount);
+                apr_bucket_delete(e);
+            }
+            break;
+        }
+        amount -= e->length;
+        apr_bucket_delete(e);
+    }
+}
+
+APU_DECLARE(apr_status_t) apr_brigade_send(apr_socket_t *sock,
+                                           apr_bucket_brigade *bb,
+                                           apr_off_t *nbytes)
+{
+    struct iovec vec[MAX_IOVEC_TO_SEND];
+    apr_status_t rv = APR_SUCCESS;
+    int can_splice = 1;
+
+    *nbytes = 0;
+
+    brigade_consume(bb, 0);
+
+    while (!APR_BRIGADE_EMPTY(bb)) {
+        apr_bucket *e, *file = NULL;
+        apr_size_t total = 0, sent = 0;
+        int nvec = 0, nheaders = 0, spliced = 0;
+
+        for (e = APR_BRIGADE_FIRST(bb);
+             e != APR_BRIGADE_SENTINEL(bb) && nvec < MAX_IOVEC_TO_SEND
+                 && total < MAX_BYTES_TO_SEND;
+             e = APR_BUCKET_NEXT(e))
+        {
+            const char *str;
+            apr_size_t len;
+
+            if (APR_BUCKET_IS_METADATA(e)) {
+                continue;
+            }
+
+#if APR_HAS_SENDFILE
+            if (APR_BUCKET_IS_FILE(e) && e->length >= MIN_SENDFILE_BYTES) {
+                apr_bucket_file *a = e->data;
+
+                if (apr_file_flags_get(a->fd) & APR_FOPEN_SENDFILE_ENABLED) {
+                    if (file) {
+                        /* one file per sendfile(), the previous
+                         * iovecs are its trailers */
+                        break;
+                    }
+                    file = e;
+                    nheaders = nvec;
+                    continue;
+                }
+            }
+#endif
+
+            if (can_splice && (APR_BUCKET_IS_PIPE(e)
+                               || APR_BUCKET_IS_SOCKET(e))) {
+                if (nvec || file) {
+                    /* send what comes before it first */
+                    break;
+                }
+                apr_bucket *next = APR_BUCKET_NEXT(e);
+
+                rv = apr_bucket_splice(e, sock, MAX_BYTES_TO_SEND,
+                                       next != APR_BRIGADE_SENTINEL(bb)
+                                       && !APR_BUCKET_IS_METADATA(next),
+                                       &sent);
+                if (rv != APR_ENOTIMPL) {
+                    spliced = 1;
+                    break;
+                }
+                /* not here, read it like any other bucket */
+                can_splice = 0;
+            }
+
+            rv = apr_bucket_read(e, &str, &len, APR_BLOCK_READ);
+            if (rv != APR_SUCCESS) {
+                if (!nvec && !file) {
+                    return rv;
+                }
+                /* send what we have, the error is reported next time */
+                rv = APR_SUCCESS;
+                break;
+            }
+            if (len) {
+                vec[nvec].iov_base = (void *)str;
+                vec[nvec].iov_len = len;
+                nvec++;
+                total += len;
+            }
+        }
+
+        if (spliced) {
+            /* the data went straight from the descriptor to the socket,
+             * only the metadata and an exhausted bucket are left to drop */
+            *nbytes += sent;
+            if (rv == APR_EOF) {
+                rv = APR_SUCCESS;
+            }
+            brigade_consume(bb, 0);
+            if (rv != APR_SUCCESS) {
+                return rv;
+            }
+            continue;
+        }
+
+#if APR_HAS_SENDFILE
+        if (file) {
+            apr_bucket_file *a = file->data;
+            apr_off_t offset = file->start;
+            apr_hdtr_t hdtr;
+
+            hdtr.headers = vec;
+            hdtr.numheaders = nheaders;
+            hdtr.trailers = vec + nheaders;
+            hdtr.numtrailers = nvec - nheaders;
+
+            sent = file->length;
+            rv = apr_socket_sendfile(sock, a->fd, &hdtr, &offset, &sent, 0);
+        }
+        else
+#endif
+        if (nvec) {
+            sent = total;
+            rv = apr_socket_sendv(sock, vec, nvec, &sent);
+        }
+
+        /* drop whatever made it to the network, splitting the bucket
+         * holding the last byte sent */
+        brigade_consume(bb, sent);
+        *nbytes += sent;
+
+        if (rv != APR_SUCCESS) {
+            return rv;
+        }
+    }
+
+    return APR_SUCCESS;
+}
+
 APU_DECLARE(apr_status_t) apr_brigade_vputstrs(apr_bucket_brigade *b, 
                                                apr_brigade_flush flush,
                                                void *ctx,
@@ -771,6 +1043,7 @@ APU_DECLARE(apr_status_t) apr_brigade_write(apr_bucket_brigade *b,
         else {
             e = apr_bucket_heap_create(str, nbyte, NULL, b->bucket_alloc);
             APR_BRIGADE_INSERT_TAIL(b, e);
+            APR__BUCKET_STATS_COPY(b->bucket_alloc, write_copied, nbyte);
             return APR_SUCCESS;
         }
     }
@@ -792,7 +1065,81 @@ APU_DECLARE(apr_status_t) apr_brigade_write(apr_bucket_brigade *b,
     /* there is a sufficiently big buffer bucket available now */
     memcpy(buf, str, nbyte);
     e->length += nbyte;
+    APR__BUCKET_STATS_COPY(b->bucket_alloc, write_copied, nbyte);
+
+    return APR_SUCCESS;
+}
+
+/* The space left in the buffer of the last bucket of the brigade, if it
+ * is a heap bucket we may write into.
+ */
+static apr_size_t brigade_tail_space(apr_bucket_brigade *b, char **ptr)
+{
+    apr_bucket *e = APR_BRIGADE_LAST(b);
+    apr_bucket_heap *h;
+
+    if (APR_BRIGADE_EMPTY(b) || !APR_BUCKET_IS_HEAP(e)) {
+        return 0;
+    }
+
+    h = e->data;
+    if (h->refcount.refcount != 1) {
+        return 0;
+    }
+
+    /* HEAP bucket start offsets are always in-memory, safe to cast */
+    *ptr = h->base + e->start + e->length;
+    return h->alloc_len - (e->length + (apr_size_t)e->start);
+}
+
+APU_DECLARE(apr_status_t) apr_brigade_reserve(apr_bucket_brigade *b,
+                                              apr_size_t min,
+                                              char **ptr,
+                                              apr_size_t *avail)
+{
+    apr_size_t size, floor;
+    apr_bucket *e;
+    char *buf;
+
+    if (!min) {
+        min = 1;
+    }
+
+    size = brigade_tail_space(b, ptr);
+    if (size >= min) {
+        *avail = size;
+        return APR_SUCCESS;
+    }
+
+    size = (min > APR_BUCKET_BUFF_SIZE) ? min : APR_BUCKET_BUFF_SIZE;
+    floor = apr_bucket_alloc_aligned_floor(b->bucket_alloc, size);
+    if (floor > size) {
+        size = floor;
+    }
+
+    buf = apr_bucket_alloc(size, b->bucket_alloc);
+    e = apr_bucket_heap_create(buf, size, apr_bucket_free, b->bucket_alloc);
+    APR_BRIGADE_INSERT_TAIL(b, e);
+    e->length = 0;   /* empty until committed */
+
+    *ptr = buf;
+    *avail = size;
+    return APR_SUCCESS;
+}
+
+APU_DECLARE(apr_status_t) apr_brigade_commit(apr_bucket_brigade *b,
+                                             apr_size_t used)
+{
+    char *ptr;
+
+    if (!used) {
+        return APR_SUCCESS;
+    }
+    if (used > brigade_tail_space(b, &ptr)) {
+        return APR_EINVAL;
+    }
 
+    APR_BRIGADE_LAST(b)->length += used;
     return APR_SUCCESS;
 }
 
@@ -834,10 +1181,13 @@ APU_DECLARE(apr_status_t) apr_brigade_writev(apr_bucket_brigade *b,
                                            b->bucket_alloc);
                 APR_BRIGADE_INSERT_TAIL(b, e);
             }
+            APR__BUCKET_STATS_COPY(b->bucket_alloc, write_copied, total_len);
             return APR_SUCCESS;
         }
     }
 
+    /* Whatever follows copies all of the iovec into heap buckets */
+    APR__BUCKET_STATS_COPY(b->bucket_alloc, write_copied, total_len);
     i = 0;
 
     /* If there is a heap bucket at the end of the brigade
@@ -1045,3 +1395,221 @@ APU_DECLARE(apr_bucket *) apr_brigade_insert_file(apr_bucket_brigade *bb,
     APR_BRIGADE_INSERT_TAIL(bb, e);
     return e;
 }
+
+/* The temporary files of the brigades spooling, in their pool's userdata,
+ * each holding a reference to the apr_bucket_file shared by its FILE buckets.
+ * Once no FILE bucket refers to it anymore, the file is deleted by the next
+ * call (or when the brigade is destroyed) so that it does not keep growing.
+ */
+#define SPOOL_FILES_KEY "apr_brigade_spool"
+
+typedef struct spool_file_t {
+    apr_bucket_brigade *bb;
+    apr_pool_t *pool;           /* of the file, NULL if none */
+    apr_bucket_file *file;      /* our reference, NULL if none */
+} spool_file_t;
+
+static apr_status_t spool_file_cleanup(void *data)
+{
+    spool_file_t *sf = data;
+
+    sf->pool = NULL;
+    if (sf->file) {
+        /* the FILE buckets left can't be read anymore anyway */
+        if (apr_bucket_shared_destroy(sf->file)) {
+            apr_bucket_free(sf->file);
+        }
+        sf->file = NULL;
+    }
+    return APR_SUCCESS;
+}
+
+/* Release our reference to the file, deleting it if it was the last one */
+static void spool_file_release(spool_file_t *sf)
+{
+    apr_bucket_file *a = sf->file;
+
+    if (a) {
+        sf->file = NULL;
+        if (apr_bucket_shared_destroy(a)) {
+            apr_bucket_free(a);
+            apr_pool_destroy(sf->pool);
+        }
+    }
+}
+
+static apr_status_t spool_file_get(apr_bucket_brigade *bb,
+                                   const char *tmpdir, spool_file_t **psf)
+{
+    apr_hash_t *files = NULL;
+    spool_file_t *sf;
+    apr_pool_t *pool;
+    apr_file_t *f;
+    apr_bucket *e;
+    char *template;
+    apr_status_t rv;
+
+    apr_pool_userdata_get((void **)&files, SPOOL_FILES_KEY, bb->p);
+    if (!files) {
+        files = apr_hash_make(bb->p);
+        rv = apr_pool_userdata_setn(files, SPOOL_FILES_KEY, NULL, bb->p);
+        if (rv != APR_SUCCESS) {
+            return rv;
+        }
+    }
+    sf = apr_hash_get(files, &bb, sizeof(bb));
+    if (!sf) {
+        sf = apr_pcalloc(bb->p, sizeof(*sf));
+        sf->bb = bb;
+        apr_hash_set(files, &sf->bb, sizeof(sf->bb), sf);
+    }
+    *psf = sf;
+
+    if (sf->file) {
+        if (sf->file->refcount.refcount > 1) {
+            return APR_SUCCESS;
+        }
+        /* nothing refers to the data spooled so far, start over */
+        spool_file_release(sf);
+    }
+
+    rv = apr_pool_create(&pool, bb->p);
+    if (rv != APR_SUCCESS) {
+        return rv;
+    }
+    if (!tmpdir) {
+        rv = apr_temp_dir_get(&tmpdir, pool);
+    }
+    if (rv == APR_SUCCESS) {
+        rv = apr_filepath_merge(&template, tmpdir, "aprspoolXXXXXX",
+                                APR_FILEPATH_NATIVE, pool);
+    }
+    if (rv == APR_SUCCESS) {
+        rv = apr_file_mktemp(&f, template,
+                             APR_FOPEN_CREATE | APR_FOPEN_READ
+                           | APR_FOPEN_WRITE | APR_FOPEN_EXCL
+                           | APR_FOPEN_DELONCLOSE | APR_FOPEN_BUFFERED
+                           | APR_FOPEN_SENDFILE_ENABLED, pool);
+    }
+    if (rv != APR_SUCCESS) {
+        apr_pool_destroy(pool);
+        return rv;
+    }
+
+    /* keep the shared part of a FILE bucket, the spooled ones refer to */
+    e = apr_bucket_file_create(f, 0, 0, bb->p, bb->bucket_alloc);
+    sf->file = e->data;
+    apr_bucket_free(e);
+    sf->pool = pool;
+    apr_pool_cleanup_register(pool, sf, spool_file_cleanup,
+                              apr_pool_cleanup_null);
+    return APR_SUCCESS;
+}
+
+/* Forget the spool file of a brigade being destroyed */
+static void spool_file_destroy(apr_bucket_brigade *bb)
+{
+    apr_hash_t *files = NULL;
+    spool_file_t *sf;
+
+    apr_pool_userdata_get((void **)&files, SPOOL_FILES_KEY, bb->p);
+    if (files) {
+        sf = apr_hash_get(files, &bb, sizeof(bb));
+        if (sf) {
+            apr_hash_set(files, &sf->bb, sizeof(sf->bb), NULL);
+            spool_file_release(sf);
+        }
+    }
+}
+
+/* A FILE bucket for the given part of the spool file */
+static apr_bucket *spool_bucket_create(spool_file_t *sf, apr_off_t offset,
+                                       apr_size_t len,
+                                       apr_bucket_alloc_t *list)
+{
+    apr_bucket *e = apr_bucket_alloc(sizeof(*e), list);
+
+    APR_BUCKET_INIT(e);
+    e->free = apr_bucket_free;
+    e->list = list;
+    e->type = &apr_bucket_type_file;
+    e->data = sf->file;
+    e->start = offset;
+    e->length = len;
+    sf->file->refcount.refcount++;
+    return e;
+}
+
+APU_DECLARE(apr_status_t) apr_brigade_spool(apr_bucket_brigade *bb,
+                                            apr_off_t threshold,
+                                            const char *tmpdir)
+{
+    spool_file_t *sf = NULL;
+    apr_file_t *f = NULL;
+    apr_bucket *e, *next, *fe = NULL;
+    apr_off_t inmem = 0, offset = 0;
+    int spooling = 0;
+    apr_status_t rv;
+
+    for (e = APR_BRIGADE_FIRST(bb); e != APR_BRIGADE_SENTINEL(bb); e = next) {
+        const char *str;
+        apr_size_t len;
+
+        next = APR_BUCKET_NEXT(e);
+
+        /* only the buckets holding memory of their own are spooled */
+        if (!APR_BUCKET_IS_HEAP(e) && !APR_BUCKET_IS_POOL(e)
+            && !APR_BUCKET_IS_TRANSIENT(e)) {
+            continue;
+        }
+
+        /* past the threshold everything goes, to keep the data in order */
+        if (!spooling && inmem + (apr_off_t)e->length <= threshold) {
+            inmem += e->length;
+            continue;
+        }
+        spooling = 1;
+
+        if (!f) {
+            rv = spool_file_get(bb, tmpdir, &sf);
+            if (rv != APR_SUCCESS) {
+                return rv;
+            }
+            f = sf->file->fd;
+            /* readers of the previous FILE buckets move the offset */
+            rv = apr_file_seek(f, APR_END, &offset);
+            if (rv != APR_SUCCESS) {
+                return rv;
+            }
+        }
+
+        rv = apr_bucket_read(e, &str, &len, APR_BLOCK_READ);
+        if (rv == APR_SUCCESS) {
+            rv = apr_file_write_full(f, str, len, NULL);
+        }
+        if (rv != APR_SUCCESS) {
+            apr_file_flush(f);
+            return rv;
+        }
+
+        /* extend the file bucket just before, or add one */
+        if (fe && APR_BUCKET_PREV(e) == fe
+            && fe->length + len < MAX_BUCKET_SIZE) {
+            fe->length += len;
+        }
+        else {
+            fe = spool_bucket_create(sf, offset, len, bb->bucket_alloc);
+            APR_BUCKET_INSERT_BEFORE(e, fe);
+        }
+        offset += len;
+
+        apr_bucket_delete(e);
+    }
+
+    if (f) {
+        /* readers may mmap() or sendfile() the descriptor directly */
+        return apr_file_flush(f);
+    }
+
+    return APR_SUCCESS;
+}
@@ -0,0 +1,478 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "apr.h"
+#include "apr_pools.h"
+#include "apr_buckets.h"
+#include "apr_errno.h"
+#define APR_WANT_MEMFUNC
+#include "apr_want.h"
+
+/*
+ * The buckets of a compact brigade are not linked into a ring. Each one
+ * is kept as a ring of its own, since splitting or reading a bucket
+ * inserts the new buckets after it: those are then unlinked and given
+ * their own entries, right after the bucket's.
+ */
+
+/* The data size stored in an entry rather than in a bucket, which with
+ * the bucket pointer and the length makes an entry 64 bytes (a cache
+ * line) on LP64 platforms.
+ */
+#define ARRAY_INLINE_SIZE 48
+
+/* The number of entries held in the compact brigade structure itself,
+ * before an array is allocated.
+ */
+#define ARRAY_SMALL_SIZE 4
+
+typedef struct array_entry_t {
+    /** The bucket, or NULL if the data is stored in u.buf */
+    apr_bucket *bucket;
+    /** The length of the data, (apr_size_t)-1 if unknown */
+    apr_size_t length;
+    union {
+        /** The data of a bucket which reads without morphing, else NULL */
+        const char *data;
+        /** The data stored in the entry */
+        char buf[ARRAY_INLINE_SIZE];
+    } u;
+} array_entry_t;
+
+struct apr_brigade_array_t {
+    /** The pool the compact brigade's cleanup is registered in */
+    apr_pool_t *p;
+    /** The bucket allocator for the buckets and the entries */
+    apr_bucket_alloc_t *bucket_alloc;
+    /** The entries, small or allocated from bucket_alloc */
+    array_entry_t *elts;
+    /** The number of entries used */
+    int nelts;
+    /** The number of entries allocated */
+    int nalloc;
+    /** The entries used until more are needed */
+    array_entry_t small[ARRAY_SMALL_SIZE];
+};
+
+static apr_status_t array_cleanup(void *data)
+{
+    apr_brigade_array_t *a = data;
+
+    apr_brigade_array_cleanup(a);
+    if (a->elts != a->small) {
+        apr_bucket_free(a->elts);
+        a->elts = a->small;
+        a->nalloc = ARRAY_SMALL_SIZE;
+    }
+    return APR_SUCCESS;
+}
+
+/* Make room for n more entries. */
+static void array_reserve(apr_brigade_array_t *a, int n)
+{
+    array_entry_t *elts;
+    int nalloc = a->nalloc;
+
+    if (a->nelts + n <= nalloc) {
+        return;
+    }
+    while (a->nelts + n > nalloc) {
+        nalloc *= 2;
+    }
+    elts = apr_bucket_alloc(nalloc * sizeof(*elts), a->bucket_alloc);
+    memcpy(elts, a->elts, a->nelts * sizeof(*elts));
+    if (a->elts != a->small) {
+        apr_bucket_free(a->elts);
+    }
+    a->elts = elts;
+    a->nalloc = nalloc;
+}
+
+/* Insert an uninitialized entry at index i. */
+static array_entry_t *array_insert(apr_brigade_array_t *a, int i)
+{
+    array_reserve(a, 1);
+    if (i < a->nelts) {
+        memmove(&a->elts[i + 1], &a->elts[i],
+                (a->nelts - i) * sizeof(*a->elts));
+    }
+    a->nelts++;
+    return &a->elts[i];
+}
+
+/* Point an entry at a bucket, linked to nothing but itself. */
+static void entry_set(array_entry_t *en, apr_bucket *e)
+{
+    APR_RING_ELEM_INIT(e, link);
+    en->bucket = e;
+    en->length = e->length;
+    en->u.data = NULL;
+
+    /* Heap and immortal buckets read as a pointer to their data, which
+     * does not change until they are destroyed: remember it, so that
+     * walking the entries needs not dereference the buckets.
+     */
+    if (APR_BUCKET_IS_HEAP(e) || APR_BUCKET_IS_IMMORTAL(e)) {
+        const char *str;
+        apr_size_t len;
+
+        if (apr_bucket_read(e, &str, &len, APR_NONBLOCK_READ)
+                == APR_SUCCESS) {
+            en->u.data = str;
+        }
+    }
+}
+
+/* Read the data of the entry at index i. Reading may morph the bucket,
+ * moving the rest of its data to buckets inserted after it, which get
+ * entries of their own.
+ */
+static apr_status_t entry_read(apr_brigade_array_t *a, int i,
+                               const char **str, apr_size_t *len,
+                               apr_read_type_e block)
+{
+    array_entry_t *en = &a->elts[i];
+    apr_bucket *e = en->bucket, *f;
+    apr_status_t rv;
+
+    if (!e) {
+        *str = en->u.buf;
+        *len = en->length;
+        return APR_SUCCESS;
+    }
+    if (en->u.data) {
+        *str = en->u.data;
+        *len = en->length;
+        return APR_SUCCESS;
+    }
+
+    rv = apr_bucket_read(e, str, len, block);
+    if (rv != APR_SUCCESS) {
+        return rv;
+    }
+    en->length = e->length;
+    if (APR_BUCKET_IS_HEAP(e) || APR_BUCKET_IS_IMMORTAL(e)) {
+        en->u.data = *str;
+    }
+
+    while ((f = APR_BUCKET_NEXT(e)) != e) {
+        APR_BUCKET_REMOVE(f);
+        entry_set(array_insert(a, ++i), f);
+    }
+    return APR_SUCCESS;
+}
+
+/* Split the entry at index i at the given point, inserting the entry
+ * for the rest of its data after it.
+ */
+static apr_status_t entry_split(apr_brigade_array_t *a, int i,
+                                apr_size_t point)
+{
+    array_entry_t *en = &a->elts[i], *rest;
+    apr_bucket *e = en->bucket, *f;
+    apr_status_t rv;
+
+    if (e) {
+        rv = apr_bucket_split(e, point);
+        if (rv != APR_SUCCESS) {
+            return rv;
+        }
+        f = APR_BUCKET_NEXT(e);
+        APR_BUCKET_REMOVE(f);
+        APR_RING_ELEM_INIT(f, link);
+    }
+    else {
+        f = NULL;
+    }
+
+    rest = array_insert(a, i + 1);
+    en = &a->elts[i];
+    rest->bucket = f;
+    if (f) {
+        rest->length = f->length;
+        rest->u.data = en->u.data ? en->u.data + point : NULL;
+    }
+    else {
+        rest->length = en->length - point;
+        memcpy(rest->u.buf, en->u.buf + point, rest->length);
+    }
+    en->length = point;
+
+    return APR_SUCCESS;
+}
+
+APU_DECLARE(apr_brigade_array_t *) apr_brigade_array_create(apr_pool_t *p,
+                                                   apr_bucket_alloc_t *list)
+{
+    apr_brigade_array_t *a;
+
+    a = apr_palloc(p, sizeof(*a));
+    a->p = p;
+    a->bucket_alloc = list;
+    a->elts = a->small;
+    a->nelts = 0;
+    a->nalloc = ARRAY_SMALL_SIZE;
+
+    apr_pool_cleanup_register(a->p, a, array_cleanup, apr_pool_cleanup_null);
+    return a;
+}
+
+APU_DECLARE(apr_status_t) apr_brigade_array_destroy(apr_brigade_array_t *a)
+{
+    apr_pool_cleanup_kill(a->p, a, array_cleanup);
+    return array_cleanup(a);
+}
+
+APU_DECLARE(apr_status_t) apr_brigade_array_cleanup(void *data)
+{
+    apr_brigade_array_t *a = data;
+    int i;
+
+    for (i = 0; i < a->nelts; i++) {
+        if (a->elts[i].bucket) {
+            apr_bucket_destroy(a->elts[i].bucket);
+        }
+    }
+    a->nelts = 0;
+    return APR_SUCCESS;
+}
+
+APU_DECLARE(int) apr_brigade_array_count(const apr_brigade_array_t *a)
+{
+    return a->nelts;
+}
+
+APU_DECLARE(void) apr_brigade_array_insert(apr_brigade_array_t *a,
+                                           apr_bucket *e)
+{
+    entry_set(array_insert(a, a->nelts), e);
+}
+
+APU_DECLARE(apr_status_t) apr_brigade_array_write(apr_brigade_array_t *a,
+                                                  const char *str,
+                                                  apr_size_t nbyte)
+{
+    array_entry_t *en;
+
+    if (!nbyte) {
+        return APR_SUCCESS;
+    }
+
+    if (a->nelts) {
+        en = &a->elts[a->nelts - 1];
+        if (!en->bucket && nbyte <= ARRAY_INLINE_SIZE - en->length) {
+            memcpy(en->u.buf + en->length, str, nbyte);
+            en->length += nbyte;
+            return APR_SUCCESS;
+        }
+    }
+
+    if (nbyte <= ARRAY_INLINE_SIZE) {
+        en = array_insert(a, a->nelts);
+        en->bucket = NULL;
+        en->length = nbyte;
+        memcpy(en->u.buf, str, nbyte);
+    }
+    else {
+        apr_brigade_array_insert(a, apr_bucket_heap_create(str, nbyte, NULL,
+                                                           a->bucket_alloc));
+    }
+    return APR_SUCCESS;
+}
+
+APU_DECLARE(void) apr_brigade_array_from_brigade(apr_brigade_array_t *a,
+                                                 apr_bucket_brigade *b)
+{
+    apr_bucket *e;
+
+    while (!APR_BRIGADE_EMPTY(b)) {
+        e = APR_BRIGADE_FIRST(b);
+        APR_BUCKET_REMOVE(e);
+        apr_brigade_array_insert(a, e);
+    }
+}
+
+APU_DECLARE(void) apr_brigade_array_to_brigade(apr_brigade_array_t *a,
+                                               apr_bucket_brigade *b)
+{
+    int i, j;
+
+    for (i = 0; i < a->nelts; i = j) {
+        apr_bucket *e = a->elts[i].bucket;
+
+        j = i + 1;
+        if (!e) {
+            /* Consecutive data stored in the entries goes to one bucket */
+            apr_size_t len = a->elts[i].length;
+            char *buf;
+
+            while (j < a->nelts && !a->elts[j].bucket) {
+                len += a->elts[j++].length;
+            }
+            buf = apr_bucket_alloc(len, b->bucket_alloc);
+            e = apr_bucket_heap_create(buf, len, apr_bucket_free,
+                                       b->bucket_alloc);
+            for (; i < j; i++) {
+                memcpy(buf, a->elts[i].u.buf, a->elts[i].length);
+                buf += a->elts[i].length;
+            }
+        }
+        APR_BRIGADE_INSERT_TAIL(b, e);
+    }
+    a->nelts = 0;
+}
+
+APU_DECLARE(apr_brigade_array_t *) apr_brigade_array_split(
+                                                    apr_brigade_array_t *a,
+                                                    int index,
+                                                    apr_brigade_array_t *rest)
+{
+    int n;
+
+    if (!rest) {
+        rest = apr_brigade_array_create(a->p, a->bucket_alloc);
+    }
+    else if (rest->nelts) {
+        apr_brigade_array_cleanup(rest);
+    }
+
+    n = a->nelts - index;
+    if (n > 0) {
+        array_reserve(rest, n);
+        memcpy(rest->elts, &a->elts[index], n * sizeof(*a->elts));
+        rest->nelts = n;
+        a->nelts = index;
+    }
+    return rest;
+}
+
+APU_DECLARE(apr_status_t) apr_brigade_array_partition(apr_brigade_array_t *a,
+                                                      apr_off_t point,
+                                                      int *index)
+{
+    apr_uint64_t point64;
+    const char *s;
+    apr_size_t len;
+    apr_status_t rv;
+    int i;
+
+    if (point < 0) {
+        return APR_EINVAL;
+    }
+    point64 = (apr_uint64_t)point;
+
+    for (i = 0; i < a->nelts; i++) {
+        if (!point64) {
+            *index = i;
+            return APR_SUCCESS;
+        }
+
+        /* The length is needed to know whether the point is in there */
+        if (a->elts[i].length == (apr_size_t)(-1)) {
+            rv = entry_read(a, i, &s, &len, APR_BLOCK_READ);
+            if (rv != APR_SUCCESS) {
+                *index = i;
+                return rv;
+            }
+        }
+
+        if (point64 < (apr_uint64_t)a->elts[i].length) {
+            rv = entry_split(a, i, (apr_size_t)point64);
+            if (rv == APR_ENOTIMPL) {
+                /* if the bucket cannot be split, read it as a type
+                 * that can be */
+                rv = entry_read(a, i, &s, &len, APR_BLOCK_READ);
+                if (rv != APR_SUCCESS) {
+                    *index = i;
+                    return rv;
+                }
+                if (point64 < (apr_uint64_t)a->elts[i].length) {
+                    rv = entry_split(a, i, (apr_size_t)point64);
+                }
+            }
+            *index = i + 1;
+            return rv;
+        }
+        point64 -= (apr_uint64_t)a->elts[i].length;
+    }
+
+    *index = a->nelts;
+    return point64 ? APR_INCOMPLETE : APR_SUCCESS;
+}
+
+APU_DECLARE(apr_status_t) apr_brigade_array_length(apr_brigade_array_t *a,
+                                                   int read_all,
+                                                   apr_off_t *length)
+{
+    apr_off_t total = 0;
+    apr_status_t status = APR_SUCCESS;
+    int i;
+
+    for (i = 0; i < a->nelts; i++) {
+        if (a->elts[i].length == (apr_size_t)(-1)) {
+            const char *ignore;
+            apr_size_t len;
+
+            if (!read_all) {
+                total = -1;
+                break;
+            }
+
+            if ((status = entry_read(a, i, &ignore, &len,
+                                     APR_BLOCK_READ)) != APR_SUCCESS) {
+                break;
+            }
+        }
+
+        total += a->elts[i].length;
+    }
+
+    *length = total;
+    return status;
+}
+
+APU_DECLARE(apr_status_t) apr_brigade_array_to_iovec(apr_brigade_array_t *a,
+                                                     struct iovec *vec,
+                                                     int *nvec)
+{
+    int left = *nvec;
+    int i;
+    struct iovec *orig;
+    apr_size_t iov_len;
+    const char *iov_base;
+    apr_status_t rv;
+
+    orig = vec;
+
+    for (i = 0; i < a->nelts; i++) {
+        /* Skip metadata and empty buckets. */
+        if (!a->elts[i].length) continue;
+
+        if (left-- == 0)
+            break;
+
+        rv = entry_read(a, i, &iov_base, &iov_len, APR_NONBLOCK_READ);
+        if (rv != APR_SUCCESS)
+            return rv;
+        /* Set indirectly since types differ: */
+        vec->iov_len = iov_len;
+        vec->iov_base = (void *)iov_base;
+        ++vec;
+    }
+
+    *nvec = (int)(vec - orig);
+    return APR_SUCCESS;
+}
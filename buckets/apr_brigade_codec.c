@@ -0,0 +1,434 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "apr.h"
+#include "apr_pools.h"
+#include "apr_buckets.h"
+#include "apr_errno.h"
+
+#if APU_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#if APU_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+/*
+ * A codec runs the data through the compression library in steps, each
+ * step consuming some input and/or filling some of the output buffer.
+ * The buffer becomes a HEAP bucket once full, or when the output is
+ * flushed, and a new one is allocated on demand.
+ */
+
+typedef enum {
+    CODEC_CONTINUE,
+    CODEC_FLUSH,
+    CODEC_FINISH
+} codec_op_e;
+
+struct apr_brigade_codec_t {
+    apr_pool_t *pool;
+    apr_bucket_alloc_t *list;
+    apr_brigade_codec_e type;
+    int decompress;
+    /* The end of the stream was written or read */
+    int ended;
+    /* The output buffer, of APR_BUCKET_BUFF_SIZE bytes, and its use */
+    char *buf;
+    apr_size_t buf_len;
+    apr_status_t (*step)(apr_brigade_codec_t *codec,
+                         const char **data, apr_size_t *len,
+                         codec_op_e op, int *done);
+    void (*end)(apr_brigade_codec_t *codec);
+#if APU_HAVE_ZLIB
+    z_stream zs;
+#endif
+#if APU_HAVE_ZSTD
+    ZSTD_CCtx *zc;
+    ZSTD_DCtx *zd;
+#endif
+};
+
+#if APU_HAVE_ZLIB
+
+/* zlib's state is taken from the bucket allocator, whose size classes
+ * recycle it from one stream to the next.
+ */
+static voidpf codec_zalloc(voidpf opaque, uInt items, uInt size)
+{
+    if (size && items > APR_SIZE_MAX / size) {
+        return Z_NULL;
+    }
+    return apr_bucket_alloc((apr_size_t)items * size, opaque);
+}
+
+static void codec_zfree(voidpf opaque, voidpf address)
+{
+    apr_bucket_free(address);
+}
+
+static apr_status_t zlib_step(apr_brigade_codec_t *codec,
+                              const char **data, apr_size_t *len,
+                              codec_op_e op, int *done)
+{
+    z_stream *zs = &codec->zs;
+    uInt avail = (*len > (uInt)-1) ? (uInt)-1 : (uInt)*len;
+    int zrv;
+
+    if (codec->decompress && codec->ended && *len) {
+        /* concatenated gzip members form a single stream */
+        if (codec->type != APR_BRIGADE_CODEC_GZIP) {
+            return APR_EINVAL;
+        }
+        inflateReset(zs);
+        codec->ended = 0;
+    }
+
+    zs->next_in = (Bytef *)*data;
+    zs->avail_in = avail;
+    zs->next_out = (Bytef *)codec->buf + codec->buf_len;
+    zs->avail_out = (uInt)(APR_BUCKET_BUFF_SIZE - codec->buf_len);
+
+    if (!codec->decompress) {
+        zrv = deflate(zs, op == CODEC_FINISH ? Z_FINISH
+                        : op == CODEC_FLUSH ? Z_SYNC_FLUSH : Z_NO_FLUSH);
+        if (zrv == Z_STREAM_ERROR) {
+            return APR_EGENERAL;
+        }
+        if (zrv == Z_STREAM_END) {
+            codec->ended = 1;
+        }
+    }
+    else {
+        zrv = inflate(zs, Z_NO_FLUSH);
+        if (zrv == Z_DATA_ERROR || zrv == Z_NEED_DICT) {
+            return APR_EINVAL;
+        }
+        if (zrv == Z_MEM_ERROR) {
+            return APR_ENOMEM;
+        }
+        if (zrv == Z_STREAM_END) {
+            codec->ended = 1;
+        }
+    }
+
+    *data += avail - zs->avail_in;
+    *len -= avail - zs->avail_in;
+    codec->buf_len = APR_BUCKET_BUFF_SIZE - zs->avail_out;
+
+    if (op == CODEC_FINISH) {
+        *done = codec->ended && zs->avail_out;
+    }
+    else if (op == CODEC_FLUSH || codec->decompress) {
+        /* nothing is left inside zlib once it has room to spare */
+        *done = !*len && zs->avail_out;
+    }
+    else {
+        *done = !*len;
+    }
+    return APR_SUCCESS;
+}
+
+static void zlib_end(apr_brigade_codec_t *codec)
+{
+    if (codec->decompress) {
+        inflateEnd(&codec->zs);
+    }
+    else {
+        deflateEnd(&codec->zs);
+    }
+}
+
+static apr_status_t zlib_init(apr_brigade_codec_t *codec, int level)
+{
+    /* the window bits select the zlib or the gzip wrapper */
+    int bits = (codec->type == APR_BRIGADE_CODEC_GZIP) ? MAX_WBITS + 16
+                                                       : MAX_WBITS;
+    int zrv;
+
+    if (level < 0 || level > 9) {
+        return APR_EINVAL;
+    }
+
+    codec->zs.zalloc = codec_zalloc;
+    codec->zs.zfree = codec_zfree;
+    codec->zs.opaque = codec->list;
+    if (codec->decompress) {
+        zrv = inflateInit2(&codec->zs, bits);
+    }
+    else {
+        zrv = deflateInit2(&codec->zs, level ? level : Z_DEFAULT_COMPRESSION,
+                           Z_DEFLATED, bits, 8, Z_DEFAULT_STRATEGY);
+    }
+    if (zrv != Z_OK) {
+        return (zrv == Z_MEM_ERROR) ? APR_ENOMEM : APR_EGENERAL;
+    }
+
+    codec->step = zlib_step;
+    codec->end = zlib_end;
+    return APR_SUCCESS;
+}
+
+#endif /* APU_HAVE_ZLIB */
+
+#if APU_HAVE_ZSTD
+
+static apr_status_t zstd_step(apr_brigade_codec_t *codec,
+                              const char **data, apr_size_t *len,
+                              codec_op_e op, int *done)
+{
+    ZSTD_inBuffer in;
+    ZSTD_outBuffer out;
+    size_t zrv;
+
+    in.src = *data;
+    in.size = *len;
+    in.pos = 0;
+    out.dst = codec->buf;
+    out.size = APR_BUCKET_BUFF_SIZE;
+    out.pos = codec->buf_len;
+
+    if (!codec->decompress) {
+        zrv = ZSTD_compressStream2(codec->zc, &out, &in,
+                                   op == CODEC_FINISH ? ZSTD_e_end
+                                   : op == CODEC_FLUSH ? ZSTD_e_flush
+                                   : ZSTD_e_continue);
+        if (ZSTD_isError(zrv)) {
+            return APR_EGENERAL;
+        }
+        if (op == CODEC_FINISH && !zrv) {
+            codec->ended = 1;
+        }
+        /* zrv is the number of bytes left to flush */
+        *done = (op == CODEC_CONTINUE) ? (in.pos == in.size) : !zrv;
+    }
+    else {
+        zrv = ZSTD_decompressStream(codec->zd, &out, &in);
+        if (ZSTD_isError(zrv)) {
+            return (ZSTD_getErrorCode(zrv) == ZSTD_error_memory_allocation)
+                   ? APR_ENOMEM : APR_EINVAL;
+        }
+        /* zrv is zero at the end of a frame, the next one may follow */
+        codec->ended = !zrv;
+        *done = (in.pos == in.size) && (out.pos < out.size)
+                && (op != CODEC_FINISH || codec->ended);
+    }
+
+    *data += in.pos;
+    *len -= in.pos;
+    codec->buf_len = out.pos;
+    return APR_SUCCESS;
+}
+
+static void zstd_end(apr_brigade_codec_t *codec)
+{
+    if (codec->decompress) {
+        ZSTD_freeDCtx(codec->zd);
+    }
+    else {
+        ZSTD_freeCCtx(codec->zc);
+    }
+}
+
+static apr_status_t zstd_init(apr_brigade_codec_t *codec, int level)
+{
+    if (codec->decompress) {
+        codec->zd = ZSTD_createDCtx();
+        if (!codec->zd) {
+            return APR_ENOMEM;
+        }
+    }
+    else {
+        if (level < ZSTD_minCLevel() || level > ZSTD_maxCLevel()) {
+            return APR_EINVAL;
+        }
+        codec->zc = ZSTD_createCCtx();
+        if (!codec->zc) {
+            return APR_ENOMEM;
+        }
+        if (level) {
+            ZSTD_CCtx_setParameter(codec->zc, ZSTD_c_compressionLevel, level);
+        }
+    }
+
+    codec->step = zstd_step;
+    codec->end = zstd_end;
+    return APR_SUCCESS;
+}
+
+#endif /* APU_HAVE_ZSTD */
+
+static apr_status_t codec_cleanup(void *data)
+{
+    apr_brigade_codec_t *codec = data;
+
+    codec->end(codec);
+    if (codec->buf) {
+        apr_bucket_free(codec->buf);
+        codec->buf = NULL;
+    }
+    return APR_SUCCESS;
+}
+
+APU_DECLARE(apr_status_t) apr_brigade_codec_create(apr_brigade_codec_t **codec,
+                                                   apr_brigade_codec_e type,
+                                                   int decompress, int level,
+                                                   apr_pool_t *p,
+                                                   apr_bucket_alloc_t *list)
+{
+    apr_brigade_codec_t *c;
+    apr_status_t rv;
+
+    c = apr_pcalloc(p, sizeof(*c));
+    c->pool = p;
+    c->list = list;
+    c->type = type;
+    c->decompress = decompress;
+
+    switch (type) {
+#if APU_HAVE_ZLIB
+    case APR_BRIGADE_CODEC_DEFLATE:
+    case APR_BRIGADE_CODEC_GZIP:
+        rv = zlib_init(c, level);
+        break;
+#endif
+#if APU_HAVE_ZSTD
+    case APR_BRIGADE_CODEC_ZSTD:
+        rv = zstd_init(c, level);
+        break;
+#endif
+    default:
+        rv = APR_ENOTIMPL;
+        break;
+    }
+    if (rv != APR_SUCCESS) {
+        return rv;
+    }
+
+    apr_pool_cleanup_register(p, c, codec_cleanup, apr_pool_cleanup_null);
+
+    *codec = c;
+    return APR_SUCCESS;
+}
+
+/* Move the output buffer to the brigade.
+ */
+static void codec_emit(apr_brigade_codec_t *codec, apr_bucket_brigade *out)
+{
+    apr_bucket *e;
+
+    e = apr_bucket_heap_create(codec->buf, APR_BUCKET_BUFF_SIZE,
+                               apr_bucket_free, codec->list);
+    e->length = codec->buf_len;
+    APR_BRIGADE_INSERT_TAIL(out, e);
+
+    codec->buf = NULL;
+    codec->buf_len = 0;
+}
+
+/* Run len bytes of data through the codec, then flush or finish the
+ * stream as asked.
+ */
+static apr_status_t codec_run(apr_brigade_codec_t *codec,
+                              apr_bucket_brigade *out,
+                              const char *data, apr_size_t len,
+                              codec_op_e op)
+{
+    apr_status_t rv;
+    int done = 0;
+
+    while (!done) {
+        apr_size_t len_before;
+        apr_size_t buf_before;
+
+        if (!codec->buf) {
+            codec->buf = apr_bucket_alloc(APR_BUCKET_BUFF_SIZE, codec->list);
+            if (!codec->buf) {
+                return APR_ENOMEM;
+            }
+        }
+        len_before = len;
+        buf_before = codec->buf_len;
+
+        rv = codec->step(codec, &data, &len, op, &done);
+        if (rv != APR_SUCCESS) {
+            return rv;
+        }
+
+        if (codec->buf_len == APR_BUCKET_BUFF_SIZE) {
+            codec_emit(codec, out);
+        }
+        else if (!done && len == len_before && codec->buf_len == buf_before) {
+            /* no progress without more input, the stream is cut short */
+            return codec->decompress ? APR_INCOMPLETE : APR_EGENERAL;
+        }
+    }
+
+    if (op != CODEC_CONTINUE && codec->buf_len) {
+        codec_emit(codec, out);
+    }
+    return APR_SUCCESS;
+}
+
+APU_DECLARE(apr_status_t) apr_brigade_codec_process(apr_brigade_codec_t *codec,
+                                                    apr_bucket_brigade *out,
+                                                    apr_bucket_brigade *in,
+                                                    apr_read_type_e block)
+{
+    apr_status_t rv;
+
+    while (!APR_BRIGADE_EMPTY(in)) {
+        apr_bucket *e = APR_BRIGADE_FIRST(in);
+        const char *data;
+        apr_size_t len;
+
+        if (APR_BUCKET_IS_METADATA(e)) {
+            if (APR_BUCKET_IS_EOS(e) || APR_BUCKET_IS_FLUSH(e)) {
+                if (!codec->ended) {
+                    rv = codec_run(codec, out, NULL, 0,
+                                   APR_BUCKET_IS_EOS(e) ? CODEC_FINISH
+                                                        : CODEC_FLUSH);
+                    if (rv != APR_SUCCESS) {
+                        return rv;
+                    }
+                }
+                else if (codec->buf_len) {
+                    codec_emit(codec, out);
+                }
+            }
+            APR_BUCKET_REMOVE(e);
+            APR_BRIGADE_INSERT_TAIL(out, e);
+            continue;
+        }
+
+        rv = apr_bucket_read(e, &data, &len, block);
+        if (rv != APR_SUCCESS) {
+            return rv;
+        }
+        if (len) {
+            if (codec->ended && !codec->decompress) {
+                return APR_EINVAL;
+            }
+            rv = codec_run(codec, out, data, len, CODEC_CONTINUE);
+            if (rv != APR_SUCCESS) {
+                return rv;
+            }
+        }
+        apr_bucket_delete(e);
+    }
+
+    return APR_SUCCESS;
+}
@@ -0,0 +1,326 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "apr.h"
+#include "apr_pools.h"
+#include "apr_buckets.h"
+#include "apr_errno.h"
+#define APR_WANT_MEMFUNC
+#define APR_WANT_STRFUNC
+#include "apr_want.h"
+
+/*
+ * The cursor always reads from the start of the brigade: consuming data
+ * removes it from the brigade, so there is no position to keep besides
+ * how far a delimiter search got. Metadata buckets read as empty, so they
+ * need no special casing.
+ */
+
+APU_DECLARE(void) apr_brigade_cursor_init(apr_brigade_cursor_t *cur,
+                                          apr_bucket_brigade *bb,
+                                          apr_read_type_e block)
+{
+    cur->bb = bb;
+    cur->block = block;
+    cur->delim = NULL;
+    cur->delim_len = 0;
+    cur->scanned = 0;
+}
+
+/* Compare the delimiter with the data starting at str, in bucket e and
+ * the following ones. Sets match to 1 if it matches, 0 if not, or -1 if
+ * the brigade ends while still matching.
+ */
+static apr_status_t cursor_match(apr_brigade_cursor_t *cur, apr_bucket *e,
+                                 const char *str, apr_size_t len,
+                                 const char *delim, apr_size_t delim_len,
+                                 int *match)
+{
+    apr_status_t rv;
+
+    for (;;) {
+        apr_size_t n = (len < delim_len) ? len : delim_len;
+
+        if (memcmp(str, delim, n)) {
+            *match = 0;
+            return APR_SUCCESS;
+        }
+        delim += n;
+        delim_len -= n;
+        if (!delim_len) {
+            *match = 1;
+            return APR_SUCCESS;
+        }
+
+        e = APR_BUCKET_NEXT(e);
+        if (e == APR_BRIGADE_SENTINEL(cur->bb)) {
+            *match = -1;
+            return APR_SUCCESS;
+        }
+        rv = apr_bucket_read(e, &str, &len, cur->block);
+        if (rv != APR_SUCCESS) {
+            return rv;
+        }
+    }
+}
+
+APU_DECLARE(apr_status_t) apr_brigade_cursor_find(apr_brigade_cursor_t *cur,
+                                                  const char *delim,
+                                                  apr_size_t delim_len,
+                                                  apr_size_t *len)
+{
+    apr_bucket_brigade *bb = cur->bb;
+    apr_size_t pos = 0;
+    apr_bucket *e;
+    apr_status_t rv;
+
+    if (APR_BUCKETS_STRING == delim_len) {
+        delim_len = strlen(delim);
+    }
+    if (!delim_len) {
+        return APR_EINVAL;
+    }
+
+    if (delim != cur->delim || delim_len != cur->delim_len) {
+        cur->delim = delim;
+        cur->delim_len = delim_len;
+        cur->scanned = 0;
+    }
+
+    for (e = APR_BRIGADE_FIRST(bb);
+         e != APR_BRIGADE_SENTINEL(bb);
+         e = APR_BUCKET_NEXT(e))
+    {
+        const char *str, *p;
+        apr_size_t n, i;
+        int match;
+
+        rv = apr_bucket_read(e, &str, &n, cur->block);
+        if (rv != APR_SUCCESS) {
+            return rv;
+        }
+
+        /* searched already */
+        if (pos + n <= cur->scanned) {
+            pos += n;
+            continue;
+        }
+        i = (cur->scanned > pos) ? cur->scanned - pos : 0;
+
+        while (i < n && (p = memchr(str + i, delim[0], n - i)) != NULL) {
+            i = p - str;
+            cur->scanned = pos + i;
+
+            rv = cursor_match(cur, e, p, n - i, delim, delim_len, &match);
+            if (rv != APR_SUCCESS) {
+                return rv;
+            }
+            if (match > 0) {
+                *len = pos + i + delim_len;
+                return APR_SUCCESS;
+            }
+            if (match < 0) {
+                /* the rest of the brigade was read, and is the start
+                 * of the delimiter */
+                for (pos += n, e = APR_BUCKET_NEXT(e);
+                     e != APR_BRIGADE_SENTINEL(bb);
+                     e = APR_BUCKET_NEXT(e)) {
+                    pos += e->length;
+                }
+                *len = pos;
+                return APR_INCOMPLETE;
+            }
+            i++;
+        }
+
+        pos += n;
+        cur->scanned = pos;
+    }
+
+    *len = pos;
+    return APR_INCOMPLETE;
+}
+
+APU_DECLARE(apr_status_t) apr_brigade_cursor_peek(apr_brigade_cursor_t *cur,
+                                                  char *buf,
+                                                  apr_size_t *len)
+{
+    apr_bucket_brigade *bb = cur->bb;
+    apr_size_t want = *len, got = 0;
+    apr_bucket *e;
+    apr_status_t rv;
+
+    for (e = APR_BRIGADE_FIRST(bb);
+         e != APR_BRIGADE_SENTINEL(bb) && got < want;
+         e = APR_BUCKET_NEXT(e))
+    {
+        const char *str;
+        apr_size_t n;
+
+        rv = apr_bucket_read(e, &str, &n, cur->block);
+        if (rv != APR_SUCCESS) {
+            return rv;
+        }
+        if (n > want - got) {
+            n = want - got;
+        }
+        memcpy(buf + got, str, n);
+        got += n;
+    }
+
+    *len = got;
+    return (got == want) ? APR_SUCCESS : APR_INCOMPLETE;
+}
+
+APU_DECLARE(apr_status_t) apr_brigade_cursor_view(apr_brigade_cursor_t *cur,
+                                                  apr_size_t len,
+                                                  const char **data,
+                                                  apr_pool_t *p)
+{
+    apr_bucket_brigade *bb = cur->bb;
+    apr_size_t got = len;
+    apr_bucket *e;
+    apr_status_t rv;
+    char *buf;
+
+    if (!len) {
+        *data = "";
+        return APR_SUCCESS;
+    }
+
+    /* within the first bucket holding data, no copy */
+    for (e = APR_BRIGADE_FIRST(bb);
+         e != APR_BRIGADE_SENTINEL(bb);
+         e = APR_BUCKET_NEXT(e))
+    {
+        const char *str;
+        apr_size_t n;
+
+        rv = apr_bucket_read(e, &str, &n, cur->block);
+        if (rv != APR_SUCCESS) {
+            return rv;
+        }
+        if (n >= len) {
+            *data = str;
+            return APR_SUCCESS;
+        }
+        if (n) {
+            break;
+        }
+    }
+
+    buf = apr_palloc(p, len);
+    rv = apr_brigade_cursor_peek(cur, buf, &got);
+    if (rv != APR_SUCCESS) {
+        return rv;
+    }
+
+    *data = buf;
+    return APR_SUCCESS;
+}
+
+APU_DECLARE(apr_status_t) apr_brigade_cursor_iovec(apr_brigade_cursor_t *cur,
+                                                   apr_size_t len,
+                                                   struct iovec *vec,
+                                                   int *nvec)
+{
+    apr_bucket_brigade *bb = cur->bb;
+    apr_bucket *e;
+    apr_status_t rv;
+    int left = *nvec;
+
+    *nvec = 0;
+
+    for (e = APR_BRIGADE_FIRST(bb);
+         e != APR_BRIGADE_SENTINEL(bb) && len && left;
+         e = APR_BUCKET_NEXT(e))
+    {
+        const char *str;
+        apr_size_t n;
+
+        rv = apr_bucket_read(e, &str, &n, cur->block);
+        if (rv != APR_SUCCESS) {
+            return rv;
+        }
+        if (!n) {
+            continue;
+        }
+        if (n > len) {
+            n = len;
+        }
+        vec->iov_base = (void *)str;
+        vec->iov_len = n;
+        vec++;
+        left--;
+        (*nvec)++;
+        len -= n;
+    }
+
+    return len ? APR_INCOMPLETE : APR_SUCCESS;
+}
+
+APU_DECLARE(apr_status_t) apr_brigade_cursor_consume(apr_brigade_cursor_t *cur,
+                                                     apr_size_t len)
+{
+    apr_bucket_brigade *bb = cur->bb;
+    apr_size_t consumed = 0;
+    apr_status_t rv = APR_SUCCESS;
+
+    while (consumed < len) {
+        apr_bucket *e = APR_BRIGADE_FIRST(bb);
+        apr_size_t left = len - consumed;
+
+        if (e == APR_BRIGADE_SENTINEL(bb)) {
+            rv = APR_INCOMPLETE;
+            break;
+        }
+
+        if (e->length == (apr_size_t)(-1)) {
+            const char *str;
+            apr_size_t n;
+
+            rv = apr_bucket_read(e, &str, &n, cur->block);
+            if (rv != APR_SUCCESS) {
+                break;
+            }
+        }
+
+        if (e->length <= left) {
+            consumed += e->length;
+            apr_bucket_delete(e);
+            continue;
+        }
+
+        if (e->type->split == apr_bucket_simple_split
+            || e->type->split == apr_bucket_shared_split) {
+            /* what the split would leave us with, without the split */
+            e->start += left;
+            e->length -= left;
+        }
+        else {
+            rv = apr_bucket_split(e, left);
+            if (rv != APR_SUCCESS) {
+                break;
+            }
+            apr_bucket_delete(e);
+        }
+        consumed = len;
+    }
+
+    cur->scanned = (cur->scanned > consumed) ? cur->scanned - consumed : 0;
+
+    return rv;
+}
@@ -0,0 +1,109 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "apr.h"
+#include "apr_buckets.h"
+#include "apr_errno.h"
+#include "apr_md5.h"
+#include "apr_sha1.h"
+#include "apr_crypto.h"
+
+APU_DECLARE(void) apr_brigade_digest_init(apr_brigade_digest_t *digest,
+                                          apr_brigade_digest_fn update,
+                                          void *ctx)
+{
+    digest->update = update;
+    digest->ctx = ctx;
+    digest->length = 0;
+}
+
+APU_DECLARE(apr_status_t) apr_brigade_digest_pass(apr_brigade_digest_t *digest,
+                                                  apr_bucket_brigade *out,
+                                                  apr_bucket_brigade *in,
+                                                  apr_read_type_e block,
+                                                  apr_off_t readbytes)
+{
+    apr_status_t rv;
+
+    while (!APR_BRIGADE_EMPTY(in) && readbytes) {
+        apr_bucket *e = APR_BRIGADE_FIRST(in);
+        const char *data;
+        apr_size_t len;
+
+        if (!APR_BUCKET_IS_METADATA(e)) {
+            rv = apr_bucket_read(e, &data, &len, block);
+            if (rv != APR_SUCCESS) {
+                return rv;
+            }
+            if (readbytes > 0 && (apr_off_t)len > readbytes) {
+                len = (apr_size_t)readbytes;
+                rv = apr_bucket_split(e, len);
+                if (rv != APR_SUCCESS) {
+                    return rv;
+                }
+            }
+            if (len) {
+                rv = digest->update(digest->ctx, data, len);
+                if (rv != APR_SUCCESS) {
+                    return rv;
+                }
+                digest->length += len;
+                if (readbytes > 0) {
+                    readbytes -= len;
+                }
+            }
+        }
+
+        APR_BUCKET_REMOVE(e);
+        APR_BRIGADE_INSERT_TAIL(out, e);
+    }
+
+    return APR_SUCCESS;
+}
+
+APU_DECLARE_NONSTD(apr_status_t) apr_brigade_digest_md5(void *ctx,
+                                                        const char *data,
+                                                        apr_size_t len)
+{
+    return apr_md5_update(ctx, data, len);
+}
+
+APU_DECLARE_NONSTD(apr_status_t) apr_brigade_digest_sha1(void *ctx,
+                                                         const char *data,
+                                                         apr_size_t len)
+{
+    /* apr_sha1_update_binary() takes an unsigned int length */
+    while (len) {
+        unsigned int n = (len > APR_UINT32_MAX) ? APR_UINT32_MAX
+                                                : (unsigned int)len;
+
+        apr_sha1_update_binary(ctx, (const unsigned char *)data, n);
+        data += n;
+        len -= n;
+    }
+    return APR_SUCCESS;
+}
+
+APU_DECLARE_NONSTD(apr_status_t) apr_brigade_digest_crypto(void *ctx,
+                                                           const char *data,
+                                                           apr_size_t len)
+{
+#if APU_HAVE_CRYPTO
+    return apr_crypto_digest_update(ctx, (const unsigned char *)data, len);
+#else
+    return APR_ENOTIMPL;
+#endif
+}
@@ -15,6 +15,7 @@
  */
 
 #include "apr_buckets.h"
+#include "apr_buckets_internal.h"
 
 APU_DECLARE_NONSTD(apr_status_t) apr_bucket_setaside_noop(apr_bucket *data,
                                                           apr_pool_t *pool)
@@ -44,3 +45,71 @@ APU_DECLARE_NONSTD(void) apr_bucket_destroy_noop(void *data)
 {
     return;
 }
+
+/* A read size state holds the maximum read size, shifted left by
+ * READ_SIZE_BITS, and how many times APR_BUCKET_BUFF_SIZE is doubled for
+ * the next read. The maximum is limited so that it fits in a 32-bit
+ * apr_off_t.
+ */
+#define READ_SIZE_BITS  4
+#define READ_SIZE_MASK  ((1 << READ_SIZE_BITS) - 1)
+#define READ_SIZE_LIMIT ((apr_size_t)APR_INT32_MAX >> READ_SIZE_BITS)
+
+apr_off_t apr__bucket_read_size_set(apr_bucket_alloc_t *list,
+                                    apr_size_t size)
+{
+    apr_size_t floor;
+
+    if (size <= APR_BUCKET_BUFF_SIZE) {
+        return -1;
+    }
+    floor = apr_bucket_alloc_aligned_floor(list, size);
+    if (size > floor) {
+        size = floor;
+    }
+    if (size > READ_SIZE_LIMIT) {
+        size = READ_SIZE_LIMIT;
+    }
+    return (apr_off_t)size << READ_SIZE_BITS;
+}
+
+apr_size_t apr__bucket_read_size(apr_bucket_alloc_t *list, apr_off_t state)
+{
+    apr_size_t size, max;
+    int shift;
+
+    if (state < 0) {
+        return APR_BUCKET_BUFF_SIZE;
+    }
+    shift = (int)(state & READ_SIZE_MASK);
+    if (!shift) {
+        return APR_BUCKET_BUFF_SIZE;
+    }
+
+    /* Use all of the memnode the doubled size is allocated from */
+    max = (apr_size_t)(state >> READ_SIZE_BITS);
+    size = apr_bucket_alloc_aligned_floor(list, (apr_size_t)APR_BUCKET_BUFF_SIZE
+                                                << shift);
+    return (size < max) ? size : max;
+}
+
+apr_off_t apr__bucket_read_size_next(apr_off_t state, apr_size_t size,
+                                     apr_size_t len)
+{
+    apr_size_t max;
+    int shift;
+
+    if (state < 0) {
+        return -1;
+    }
+    max = (apr_size_t)(state >> READ_SIZE_BITS);
+    shift = (int)(state & READ_SIZE_MASK);
+
+    if (len == size && size < max && shift < READ_SIZE_MASK) {
+        shift++;
+    }
+    else if (len < size / 2 && shift > 0) {
+        shift--;
+    }
+    return (state & ~(apr_off_t)READ_SIZE_MASK) | shift;
+}
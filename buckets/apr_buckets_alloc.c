@@ -17,8 +17,11 @@
 #include <stdlib.h>
 
 #include "apr_buckets.h"
+#include "apr_buckets_internal.h"
 #include "apr_allocator.h"
 #include "apr_version.h"
+#define APR_WANT_MEMFUNC
+#include "apr_want.h"
 
 #define ALLOC_AMT (8192 - APR_MEMNODE_T_SIZE)
 
@@ -32,25 +35,104 @@ typedef struct node_header_t {
 #define SIZEOF_NODE_HEADER_T  APR_ALIGN_DEFAULT(sizeof(node_header_t))
 #define SMALL_NODE_SIZE       (APR_BUCKET_ALLOC_SIZE + SIZEOF_NODE_HEADER_T)
 
+/* Allocations larger than SMALL_NODE_SIZE get their own memnode from the
+ * apr_allocator_t.  Such memnodes are sorted into size classes of
+ * CLASS_BOUNDARY bytes (the allocator's own default boundary), so that a
+ * freed memnode can be handed out again to any later request of the same
+ * class without going back to the allocator.
+ */
+#define CLASS_BOUNDARY_INDEX  12
+#define CLASS_BOUNDARY        (1 << CLASS_BOUNDARY_INDEX)
+#define MIN_CLASS_INDEX       2     /* 8K, the allocator's minimum */
+#define MAX_CLASS_INDEX       16    /* 64K */
+
 /** A list of free memory from which new buckets or private bucket
  *  structures can be allocated.
  */
 struct apr_bucket_alloc_t {
+    /* the statistics, first for apr__bucket_alloc_stats() */
+    apr__bucket_alloc_head_t head;
     apr_pool_t *pool;
     apr_allocator_t *allocator;
+    int owns_allocator;         /* created here, destroyed with the list */
     node_header_t *freelist;
     apr_memnode_t *blocks;
+    /* memnodes freed into the size classes, and how many bytes they hold */
+    apr_memnode_t *classes[MAX_CLASS_INDEX + 1];
+    apr_size_t class_free;
+    /* high/low watermarks of class_free, zero max_free disables caching */
+    apr_size_t max_free;
+    apr_size_t min_free;
 };
 
+/* The size class of a memnode actually handed out by the allocator */
+#define MEMNODE_CLASS_INDEX(node) \
+    ((apr_size_t)((node)->endp - (char *)(node)) >> CLASS_BOUNDARY_INDEX)
+
+/* The size class able to satisfy an allocation of size bytes (node header
+ * included).
+ */
+static APR_INLINE apr_size_t size_class_index(apr_size_t size)
+{
+    apr_size_t index;
+
+    index = APR_ALIGN(size + APR_MEMNODE_T_SIZE, CLASS_BOUNDARY)
+                >> CLASS_BOUNDARY_INDEX;
+    if (index < MIN_CLASS_INDEX) {
+        index = MIN_CLASS_INDEX;
+    }
+    return index;
+}
+
+/* The statistics slot of an allocation of size bytes (node header
+ * included).
+ */
+static APR_INLINE apr_size_t stats_class_index(apr_size_t size)
+{
+    apr_size_t index;
+
+    if (size <= SMALL_NODE_SIZE) {
+        return 0;
+    }
+    index = size_class_index(size);
+    if (index >= APR_BUCKET_ALLOC_STATS_CLASSES) {
+        index = APR_BUCKET_ALLOC_STATS_CLASSES - 1;
+    }
+    return index;
+}
+
+/* Give cached memnodes back to the allocator, the largest first, until no
+ * more than max bytes remain in the size classes.
+ */
+static void classes_trim(apr_bucket_alloc_t *list, apr_size_t max)
+{
+    apr_size_t index = MAX_CLASS_INDEX;
+
+    while (list->class_free > max && index >= MIN_CLASS_INDEX) {
+        apr_memnode_t *memnode = list->classes[index];
+
+        if (!memnode) {
+            index--;
+            continue;
+        }
+        list->classes[index] = memnode->next;
+        list->class_free -= index << CLASS_BOUNDARY_INDEX;
+
+        memnode->next = NULL;
+        apr_allocator_free(list->allocator, memnode);
+    }
+}
+
 static apr_status_t alloc_cleanup(void *data)
 {
     apr_bucket_alloc_t *list = data;
     apr_allocator_t *allocator = NULL;
 
-    if (list->pool && list->allocator != apr_pool_allocator_get(list->pool)) {
+    if (list->owns_allocator) {
         allocator = list->allocator;
     }
 
+    classes_trim(list, 0);
     apr_allocator_free(list->allocator, list->blocks);
 
     if (allocator) {
@@ -62,64 +144,129 @@ static apr_status_t alloc_cleanup(void *data)
 
 APU_DECLARE_NONSTD(apr_bucket_alloc_t *) apr_bucket_alloc_create(apr_pool_t *p)
 {
-    apr_allocator_t *allocator = apr_pool_allocator_get(p);
-    apr_bucket_alloc_t *list;
-
-    /* May be NULL in APR_POOL_DEBUG mode. */
-    if (allocator == NULL) {
-        if (apr_allocator_create(&allocator) != APR_SUCCESS) {
-            apr_abortfunc_t fn = apr_pool_abort_get(p);
-            if (fn)
-                (fn)(APR_ENOMEM);
-            abort();
-        }
-    }
-
-    list = apr_bucket_alloc_create_ex(allocator);
-    if (list == NULL) {
-            apr_abortfunc_t fn = apr_pool_abort_get(p);
-            if (fn)
-                (fn)(APR_ENOMEM);
-            abort();
-    }
-    list->pool = p;
-    apr_pool_cleanup_register(list->pool, list, alloc_cleanup,
-                              apr_pool_cleanup_null);
-
-    return list;
+    return apr_bucket_alloc_create_ex2(NULL, p, NULL);
 }
 
 APU_DECLARE_NONSTD(apr_bucket_alloc_t *) apr_bucket_alloc_create_ex(
                                              apr_allocator_t *allocator)
+{
+    return apr_bucket_alloc_create_ex2(allocator, NULL, NULL);
+}
+
+APU_DECLARE_NONSTD(apr_bucket_alloc_t *) apr_bucket_alloc_create_ex2(
+                                             apr_allocator_t *allocator,
+                                             apr_pool_t *p,
+                                             const apr_bucket_alloc_opts_t *opts)
 {
     apr_bucket_alloc_t *list;
     apr_memnode_t *block;
+    int owns_allocator = 0;
+
+    if (!allocator) {
+        allocator = apr_pool_allocator_get(p);
+
+        /* May be NULL in APR_POOL_DEBUG mode. */
+        if (allocator == NULL) {
+            if (apr_allocator_create(&allocator) != APR_SUCCESS) {
+                apr_abortfunc_t fn = apr_pool_abort_get(p);
+                if (fn)
+                    (fn)(APR_ENOMEM);
+                abort();
+            }
+            owns_allocator = 1;
+        }
+    }
 
     block = apr_allocator_alloc(allocator, ALLOC_AMT);
     if (!block) {
+        if (owns_allocator) {
+            apr_allocator_destroy(allocator);
+        }
+        if (p) {
+            apr_abortfunc_t fn = apr_pool_abort_get(p);
+            if (fn)
+                (fn)(APR_ENOMEM);
+            abort();
+        }
         return NULL;
     }
     list = (apr_bucket_alloc_t *)block->first_avail;
-    list->pool = NULL;
+    memset(list, 0, sizeof(*list));
     list->allocator = allocator;
-    list->freelist = NULL;
+    list->owns_allocator = owns_allocator;
     list->blocks = block;
     block->first_avail += APR_ALIGN_DEFAULT(sizeof(*list));
 
+    if (opts) {
+        list->max_free = opts->max_free;
+        list->min_free = (opts->min_free < opts->max_free) ? opts->min_free
+                                                           : opts->max_free;
+        if (opts->stats) {
+            list->head.stats = (apr_bucket_alloc_stats_t *)block->first_avail;
+            memset(list->head.stats, 0, sizeof(*list->head.stats));
+            block->first_avail += APR_ALIGN_DEFAULT(sizeof(*list->head.stats));
+        }
+    }
+
+    if (p) {
+        list->pool = p;
+        apr_pool_cleanup_register(list->pool, list, alloc_cleanup,
+                                  apr_pool_cleanup_null);
+    }
+
     return list;
 }
 
 APU_DECLARE_NONSTD(void) apr_bucket_alloc_destroy(apr_bucket_alloc_t *list)
 {
+    apr_allocator_t *allocator = NULL;
+
     if (list->pool) {
         apr_pool_cleanup_kill(list->pool, list, alloc_cleanup);
     }
+    if (list->owns_allocator) {
+        allocator = list->allocator;
+    }
 
+    classes_trim(list, 0);
     apr_allocator_free(list->allocator, list->blocks);
 
-    if (list->pool && list->allocator != apr_pool_allocator_get(list->pool)) {
-        apr_allocator_destroy(list->allocator);
+    if (allocator) {
+        apr_allocator_destroy(allocator);
+    }
+}
+
+APU_DECLARE(apr_status_t) apr_bucket_alloc_stats_get(apr_bucket_alloc_t *list,
+                                                     apr_bucket_alloc_stats_t *stats)
+{
+    apr_memnode_t *memnode;
+    node_header_t *node;
+    apr_size_t index;
+
+    if (!list->head.stats) {
+        return APR_EINVAL;
     }
+
+    *stats = *list->head.stats;
+
+    /* the lists are only walked here, to keep allocations cheap */
+    stats->blocks = 0;
+    for (memnode = list->blocks; memnode; memnode = memnode->next) {
+        stats->blocks++;
+    }
+    stats->freelist = 0;
+    for (node = list->freelist; node; node = node->next) {
+        stats->freelist++;
+    }
+    stats->class_nodes = 0;
+    for (index = MIN_CLASS_INDEX; index <= MAX_CLASS_INDEX; index++) {
+        for (memnode = list->classes[index]; memnode; memnode = memnode->next) {
+            stats->class_nodes++;
+        }
+    }
+    stats->class_free = list->class_free;
+
+    return APR_SUCCESS;
 }
 
 APU_DECLARE_NONSTD(apr_size_t) apr_bucket_alloc_aligned_floor(apr_bucket_alloc_t *list,
@@ -186,15 +333,38 @@ APU_DECLARE_NONSTD(void *) apr_bucket_alloc(apr_size_t size,
         }
     }
     else {
-        apr_memnode_t *memnode = apr_allocator_alloc(list->allocator, size);
-        if (!memnode) {
-            return NULL;
+        apr_memnode_t *memnode = NULL;
+        apr_size_t index = size_class_index(size);
+
+        if (index <= MAX_CLASS_INDEX && list->classes[index]) {
+            memnode = list->classes[index];
+            list->classes[index] = memnode->next;
+            list->class_free -= index << CLASS_BOUNDARY_INDEX;
+            memnode->next = NULL;
+            if (list->head.stats) {
+                list->head.stats->class_hits++;
+            }
+        }
+        else {
+            memnode = apr_allocator_alloc(list->allocator, size);
+            if (!memnode) {
+                return NULL;
+            }
         }
         node = (node_header_t *)memnode->first_avail;
         node->alloc = list;
         node->memnode = memnode;
         node->size = size;
     }
+    if (list->head.stats) {
+        apr_bucket_alloc_stats_t *stats = list->head.stats;
+
+        stats->allocs[stats_class_index(node->size)]++;
+        stats->in_use += node->size;
+        if (stats->in_use > stats->peak) {
+            stats->peak = stats->in_use;
+        }
+    }
     return ((char *)node) + SIZEOF_NODE_HEADER_T;
 }
 
@@ -223,12 +393,32 @@ APU_DECLARE_NONSTD(void) apr_bucket_free(void *mem)
     node_header_t *node = (node_header_t *)((char *)mem - SIZEOF_NODE_HEADER_T);
     apr_bucket_alloc_t *list = node->alloc;
 
+    if (list->head.stats) {
+        list->head.stats->frees[stats_class_index(node->size)]++;
+        list->head.stats->in_use -= node->size;
+    }
+
     if (node->size == SMALL_NODE_SIZE) {
         check_not_already_free(node);
         node->next = list->freelist;
         list->freelist = node;
     }
     else {
-        apr_allocator_free(list->allocator, node->memnode);
+        apr_memnode_t *memnode = node->memnode;
+        apr_size_t index = MEMNODE_CLASS_INDEX(memnode);
+
+        if (list->max_free && index >= MIN_CLASS_INDEX
+                && index <= MAX_CLASS_INDEX) {
+            memnode->next = list->classes[index];
+            list->classes[index] = memnode;
+            list->class_free += index << CLASS_BOUNDARY_INDEX;
+
+            if (list->class_free > list->max_free) {
+                classes_trim(list, list->min_free);
+            }
+        }
+        else {
+            apr_allocator_free(list->allocator, memnode);
+        }
     }
 }
@@ -0,0 +1,158 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "apr_buckets.h"
+#include "apr_atomic.h"
+#define APR_WANT_MEMFUNC
+#include "apr_want.h"
+
+#include <stdlib.h>
+
+/*
+ * The data of ATOMIC buckets may be referenced by buckets of any bucket
+ * allocator, used by any thread. The shared structure is therefore not
+ * allocated from a bucket allocator but with malloc(), its reference
+ * count is updated atomically, and whichever thread drops the last
+ * reference frees the data.
+ */
+
+static apr_status_t atomic_bucket_read(apr_bucket *b, const char **str,
+                                       apr_size_t *len,
+                                       apr_read_type_e block)
+{
+    apr_bucket_atomic *a = b->data;
+
+    *str = a->base + b->start;
+    *len = b->length;
+    return APR_SUCCESS;
+}
+
+static void atomic_bucket_destroy(void *data)
+{
+    apr_bucket_atomic *a = data;
+
+    if (!apr_atomic_dec32(&a->refcount)) {
+        (*a->free_func)(a->base);
+        free(a);
+    }
+}
+
+static apr_status_t atomic_bucket_split(apr_bucket *b, apr_size_t point)
+{
+    apr_bucket_atomic *a = b->data;
+    apr_status_t rv;
+
+    if ((rv = apr_bucket_simple_split(b, point)) != APR_SUCCESS) {
+        return rv;
+    }
+    apr_atomic_inc32(&a->refcount);
+
+    return APR_SUCCESS;
+}
+
+static apr_status_t atomic_bucket_copy(apr_bucket *b, apr_bucket **c)
+{
+    apr_bucket_atomic *a = b->data;
+
+    apr_bucket_simple_copy(b, c);
+    apr_atomic_inc32(&a->refcount);
+
+    return APR_SUCCESS;
+}
+
+APU_DECLARE(apr_status_t) apr_bucket_atomic_copy(apr_bucket *e,
+                                                 apr_bucket_alloc_t *list,
+                                                 apr_bucket **c)
+{
+    apr_bucket_atomic *a = e->data;
+    apr_bucket *b;
+
+    if (!APR_BUCKET_IS_ATOMIC(e)) {
+        return APR_EINVAL;
+    }
+
+    b = apr_bucket_alloc(sizeof(*b), list);
+    *b = *e;
+    APR_BUCKET_INIT(b);
+    b->free = apr_bucket_free;
+    b->list = list;
+    apr_atomic_inc32(&a->refcount);
+
+    *c = b;
+    return APR_SUCCESS;
+}
+
+APU_DECLARE(apr_bucket *) apr_bucket_atomic_make(apr_bucket *b,
+                                                 const char *buf,
+                                                 apr_size_t length,
+                                                 void (*free_func)(void *data))
+{
+    apr_bucket_atomic *a;
+
+    a = malloc(sizeof(*a));
+    if (a == NULL) {
+        return NULL;
+    }
+
+    if (!free_func) {
+        a->base = malloc(length ? length : 1);
+        if (a->base == NULL) {
+            free(a);
+            return NULL;
+        }
+        a->free_func = free;
+        memcpy(a->base, buf, length);
+    }
+    else {
+        a->base = (char *) buf;
+        a->free_func = free_func;
+    }
+    a->alloc_len = length;
+    apr_atomic_set32(&a->refcount, 1);
+
+    b->data   = a;
+    b->start  = 0;
+    b->length = length;
+    b->type   = &apr_bucket_type_atomic;
+
+    return b;
+}
+
+APU_DECLARE(apr_bucket *) apr_bucket_atomic_create(const char *buf,
+                                                   apr_size_t length,
+                                                   void (*free_func)(void *data),
+                                                   apr_bucket_alloc_t *list)
+{
+    apr_bucket *b = apr_bucket_alloc(sizeof(*b), list);
+
+    APR_BUCKET_INIT(b);
+    b->free = apr_bucket_free;
+    b->list = list;
+    if (!apr_bucket_atomic_make(b, buf, length, free_func)) {
+        apr_bucket_free(b);
+        return NULL;
+    }
+    return b;
+}
+
+APU_DECLARE_DATA const apr_bucket_type_t apr_bucket_type_atomic = {
+    "ATOMIC", 5, APR_BUCKET_DATA,
+    atomic_bucket_destroy,
+    atomic_bucket_read,
+    apr_bucket_setaside_noop,
+    atomic_bucket_split,
+    atomic_bucket_copy
+};
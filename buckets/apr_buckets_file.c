@@ -14,10 +14,27 @@
  * limitations under the License.
  */
 
+#include "apu_config.h"
 #include "apr.h"
 #include "apr_general.h"
 #include "apr_file_io.h"
+#include "apr_portable.h"
 #include "apr_buckets.h"
+#include "apr_buckets_internal.h"
+
+#if APR_HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#if APR_HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+#if APR_HAVE_ERRNO_H
+#include <errno.h>
+#endif
+
+#if defined(HAVE_PREAD) && APR_HAVE_UNISTD_H
+#define FILE_POSITIONAL_READ 1
+#endif
 
 #if APR_HAS_MMAP
 #include "apr_mmap.h"
@@ -27,6 +44,11 @@
  * <http://www.isi.edu/~johnh/SOFTWARE/APACHE/index.html>.
  */
 
+/* The largest granularity of mapping offsets (Windows' allocation
+ * granularity), which the pieces of a file are mapped at multiples of.
+ */
+#define MMAP_GRANULARITY 65536
+
 #endif /* APR_HAS_MMAP */
 
 static void file_bucket_destroy(void *data)
@@ -45,22 +67,37 @@ static int file_make_mmap(apr_bucket *e, apr_size_t filelength,
                            apr_off_t fileoffset, apr_pool_t *p)
 {
     apr_bucket_file *a = e->data;
+    const apr_bucket_mmap_policy_t *policy = a->mmap_policy;
+    apr_size_t min_size = APR_MMAP_THRESHOLD, max_size = APR_MMAP_LIMIT;
     apr_mmap_t *mm;
 
     if (!a->can_mmap) {
         return 0;
     }
 
-    if (filelength > APR_MMAP_LIMIT) {
-        if (apr_mmap_create(&mm, a->fd, fileoffset, APR_MMAP_LIMIT,
+    if (policy) {
+        if (policy->min_size) {
+            min_size = policy->min_size;
+        }
+        if (policy->max_size) {
+            /* keep the offset of the next piece mappable */
+            max_size = policy->max_size & ~(apr_size_t)(MMAP_GRANULARITY - 1);
+            if (!max_size) {
+                max_size = MMAP_GRANULARITY;
+            }
+        }
+    }
+
+    if (filelength > max_size) {
+        if (apr_mmap_create(&mm, a->fd, fileoffset, max_size,
                             APR_MMAP_READ, p) != APR_SUCCESS)
         {
             return 0;
         }
-        apr_bucket_split(e, APR_MMAP_LIMIT);
-        filelength = APR_MMAP_LIMIT;
+        apr_bucket_split(e, max_size);
+        filelength = max_size;
     }
-    else if ((filelength < APR_MMAP_THRESHOLD) ||
+    else if ((filelength < min_size) ||
              (apr_mmap_create(&mm, a->fd, fileoffset, filelength,
                               APR_MMAP_READ, p) != APR_SUCCESS))
     {
@@ -68,10 +105,67 @@ static int file_make_mmap(apr_bucket *e, apr_size_t filelength,
     }
     apr_bucket_mmap_make(e, mm, 0, filelength);
     file_bucket_destroy(a);
+    if (policy) {
+        apr_bucket_mmap_set_policy(e, policy);
+    }
+    APR__BUCKET_STATS_READ(e->list, 0, 0);
     return 1;
 }
 #endif
 
+#if FILE_POSITIONAL_READ
+/* Read at the given offset, without using or moving the file offset. */
+static apr_status_t file_pread(apr_file_t *f, char *buf, apr_size_t *len,
+                               apr_off_t offset)
+{
+    apr_os_file_t fd;
+    ssize_t n;
+
+    apr_os_file_get(&fd, f);
+
+    do {
+        n = pread(fd, buf, *len, offset);
+    } while (n < 0 && errno == EINTR);
+
+    if (n < 0) {
+        *len = 0;
+        return errno;
+    }
+
+    *len = n;
+    return n ? APR_SUCCESS : APR_EOF;
+}
+
+/* Ask the system to read the next blocks ahead of offset, unless most of
+ * them were already requested.
+ */
+static void file_read_ahead(apr_bucket_file *a, apr_off_t offset,
+                            apr_off_t end)
+{
+#if defined(HAVE_POSIX_FADVISE) && defined(POSIX_FADV_WILLNEED)
+    apr_off_t window = (apr_off_t)a->read_ahead * a->read_size;
+    apr_os_file_t fd;
+
+    if (a->read_ahead_end - offset > window / 2) {
+        return;
+    }
+    if (a->read_ahead_end > offset) {
+        offset = a->read_ahead_end;
+    }
+    if (end > offset + window) {
+        end = offset + window;
+    }
+    if (end <= offset) {
+        return;
+    }
+
+    apr_os_file_get(&fd, a->fd);
+    posix_fadvise(fd, offset, end - offset, POSIX_FADV_WILLNEED);
+    a->read_ahead_end = end;
+#endif
+}
+#endif
+
 static apr_status_t file_bucket_read(apr_bucket *e, const char **str,
                                      apr_size_t *len, apr_read_type_e block)
 {
@@ -85,6 +179,10 @@ static apr_status_t file_bucket_read(apr_bucket *e, const char **str,
 #if APR_HAS_THREADS && !APR_HAS_XTHREAD_FILES
     apr_int32_t flags;
 #endif
+#if FILE_POSITIONAL_READ
+    int positional = a->read_ahead
+                     && !(apr_file_flags_get(f) & APR_FOPEN_BUFFERED);
+#endif
 
 #if APR_HAS_MMAP
     if (file_make_mmap(e, filelength, fileoffset, a->readpool)) {
@@ -93,7 +191,11 @@ static apr_status_t file_bucket_read(apr_bucket *e, const char **str,
 #endif
 
 #if APR_HAS_THREADS && !APR_HAS_XTHREAD_FILES
-    if ((flags = apr_file_flags_get(f)) & APR_FOPEN_XTHREAD) {
+    if (
+#if FILE_POSITIONAL_READ
+        !positional &&
+#endif
+        ((flags = apr_file_flags_get(f)) & APR_FOPEN_XTHREAD)) {
         /* this file descriptor is shared across multiple threads and
          * this OS doesn't support that natively, so as a workaround
          * we must reopen the file into a->readpool */
@@ -112,13 +214,22 @@ static apr_status_t file_bucket_read(apr_bucket *e, const char **str,
     *len = (filelength > a->read_size) ? a->read_size : filelength;
     buf = apr_bucket_alloc(*len, e->list);
 
-    /* Handle offset ... */
-    rv = apr_file_seek(f, APR_SET, &fileoffset);
-    if (rv != APR_SUCCESS) {
-        apr_bucket_free(buf);
-        return rv;
+#if FILE_POSITIONAL_READ
+    if (positional) {
+        file_read_ahead(a, fileoffset + *len, fileoffset + filelength);
+        rv = file_pread(f, buf, len, fileoffset);
+    }
+    else
+#endif
+    {
+        /* Handle offset ... */
+        rv = apr_file_seek(f, APR_SET, &fileoffset);
+        if (rv != APR_SUCCESS) {
+            apr_bucket_free(buf);
+            return rv;
+        }
+        rv = apr_file_read(f, buf, len);
     }
-    rv = apr_file_read(f, buf, len);
     if (rv != APR_SUCCESS && rv != APR_EOF) {
         apr_bucket_free(buf);
         return rv;
@@ -129,6 +240,7 @@ static apr_status_t file_bucket_read(apr_bucket *e, const char **str,
      * even if we read nothing because we hit EOF.
      */
     apr_bucket_heap_make(e, buf, *len, apr_bucket_free);
+    APR__BUCKET_STATS_READ(e->list, 1, *len);
 
     /* If we have more to read from the file, then create another bucket */
     if (filelength > 0 && rv != APR_EOF) {
@@ -162,8 +274,11 @@ APU_DECLARE(apr_bucket *) apr_bucket_file_make(apr_bucket *b, apr_file_t *fd,
     f->readpool = p;
 #if APR_HAS_MMAP
     f->can_mmap = 1;
+    f->mmap_policy = NULL;
 #endif
     f->read_size = APR_BUCKET_BUFF_SIZE;
+    f->read_ahead = 0;
+    f->read_ahead_end = 0;
 
     b = apr_bucket_shared_make(b, f, offset, len);
     b->type = &apr_bucket_type_file;
@@ -212,6 +327,19 @@ APU_DECLARE(apr_status_t) apr_bucket_file_set_buf_size(apr_bucket *e,
     return APR_SUCCESS;
 }
 
+APU_DECLARE(apr_status_t) apr_bucket_file_set_read_ahead(apr_bucket *e,
+                                                         apr_size_t blocks)
+{
+#if FILE_POSITIONAL_READ
+    apr_bucket_file *a = e->data;
+
+    a->read_ahead = blocks;
+    return APR_SUCCESS;
+#else
+    return APR_ENOTIMPL;
+#endif
+}
+
 static apr_status_t file_bucket_setaside(apr_bucket *b, apr_pool_t *reqpool)
 {
     apr_bucket_file *a = b->data;
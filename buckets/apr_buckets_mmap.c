@@ -14,10 +14,94 @@
  * limitations under the License.
  */
 
+#include "apu_config.h"
 #include "apr_buckets.h"
 
 #if APR_HAS_MMAP
 
+#if APR_HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+#if APR_HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#if defined(HAVE_MADVISE) && APR_HAVE_SYS_MMAN_H && APR_HAVE_UNISTD_H
+#define MMAP_ADVISE 1
+
+#include <errno.h>
+
+#ifdef MADV_POPULATE_READ
+/* Cleared once the running kernel rejected MADV_POPULATE_READ (older than
+ * the headers we were built with).
+ */
+static volatile int mmap_populate_read = 1;
+#endif
+
+/* Give the system some advice about len bytes of a mapping from offset,
+ * extended to the start of the page.
+ */
+static int mmap_advise(apr_mmap_t *mm, apr_off_t offset, apr_size_t len,
+                       int advice)
+{
+    apr_size_t pagemask = (apr_size_t)sysconf(_SC_PAGESIZE) - 1;
+    apr_size_t start = (apr_size_t)offset & ~pagemask;
+
+    if (offset < 0 || (apr_size_t)offset >= mm->size) {
+        return 0;
+    }
+    if (len > mm->size - (apr_size_t)offset) {
+        len = mm->size - (apr_size_t)offset;
+    }
+    return madvise((char *)mm->mm + start, (apr_size_t)offset + len - start,
+                   advice);
+}
+
+/* Have the system read the window of the policy ahead of offset, unless
+ * most of it was already requested.
+ */
+static void mmap_prefetch(apr_bucket_mmap *m, apr_off_t offset)
+{
+    apr_off_t window = (apr_off_t)m->policy->prefetch;
+
+    if (m->prefetch_end - offset > window / 2) {
+        return;
+    }
+    if (m->prefetch_end > offset) {
+        window -= m->prefetch_end - offset;
+        offset = m->prefetch_end;
+    }
+    mmap_advise(m->mmap, offset, (apr_size_t)window, MADV_WILLNEED);
+    m->prefetch_end = offset + window;
+}
+
+/* Advise the system about the whole mapping, when the policy is set. */
+static void mmap_apply_policy(apr_bucket_mmap *m)
+{
+    const apr_bucket_mmap_policy_t *policy = m->policy;
+    apr_mmap_t *mm = m->mmap;
+
+    if (policy->sequential) {
+        mmap_advise(mm, 0, mm->size, MADV_SEQUENTIAL);
+    }
+    if (mm->size <= policy->populate_size) {
+#ifdef MADV_POPULATE_READ
+        /* fault the pages in now, as MAP_POPULATE would have */
+        if (mmap_populate_read) {
+            if (mmap_advise(mm, 0, mm->size, MADV_POPULATE_READ) == 0
+                || errno != EINVAL) {
+                m->prefetch_end = (apr_off_t)mm->size;
+                return;
+            }
+            mmap_populate_read = 0;
+        }
+#endif
+        mmap_advise(mm, 0, mm->size, MADV_WILLNEED);
+        m->prefetch_end = (apr_off_t)mm->size;
+    }
+}
+#endif /* HAVE_MADVISE */
+
 static apr_status_t mmap_bucket_read(apr_bucket *b, const char **str, 
                                      apr_size_t *length, apr_read_type_e block)
 {
@@ -34,6 +118,11 @@ static apr_status_t mmap_bucket_read(apr_bucket *b, const char **str,
     if (ok != APR_SUCCESS) {
         return ok;
     }
+#if MMAP_ADVISE
+    if (m->policy && m->policy->prefetch) {
+        mmap_prefetch(m, b->start);
+    }
+#endif
     *str = addr;
     *length = b->length;
     return APR_SUCCESS;
@@ -76,6 +165,8 @@ APU_DECLARE(apr_bucket *) apr_bucket_mmap_make(apr_bucket *b, apr_mmap_t *mm,
 
     m = apr_bucket_alloc(sizeof(*m), b->list);
     m->mmap = mm;
+    m->policy = NULL;
+    m->prefetch_end = 0;
 
     apr_pool_cleanup_register(mm->cntxt, m, mmap_bucket_cleanup,
                               apr_pool_cleanup_null);
@@ -105,6 +196,8 @@ static apr_status_t mmap_bucket_setaside(apr_bucket *b, apr_pool_t *p)
     apr_bucket_mmap *m = b->data;
     apr_mmap_t *mm = m->mmap;
     apr_mmap_t *new_mm;
+    const apr_bucket_mmap_policy_t *policy = m->policy;
+    apr_off_t prefetch_end = m->prefetch_end;
     apr_status_t ok;
 
     if (!mm) {
@@ -129,6 +222,11 @@ static apr_status_t mmap_bucket_setaside(apr_bucket *b, apr_pool_t *p)
     /* create new apr_bucket_mmap pointing to new apr_mmap_t */
     apr_bucket_mmap_make(b, new_mm, b->start, b->length);
 
+    /* which maps the same memory, already advised */
+    m = b->data;
+    m->policy = policy;
+    m->prefetch_end = prefetch_end;
+
     return APR_SUCCESS;
 }
 
@@ -142,3 +240,33 @@ APU_DECLARE_DATA const apr_bucket_type_t apr_bucket_type_mmap = {
 };
 
 #endif
+
+APU_DECLARE(apr_status_t) apr_bucket_mmap_set_policy(apr_bucket *e,
+                                     const apr_bucket_mmap_policy_t *policy)
+{
+#if APR_HAS_MMAP
+    if (APR_BUCKET_IS_FILE(e)) {
+        apr_bucket_file *a = e->data;
+
+        a->mmap_policy = policy;
+        return APR_SUCCESS;
+    }
+    if (APR_BUCKET_IS_MMAP(e)) {
+        apr_bucket_mmap *m = e->data;
+
+        if (!m->mmap) {
+            return APR_EINVAL;
+        }
+        m->policy = policy;
+#if MMAP_ADVISE
+        if (policy) {
+            mmap_apply_policy(m);
+        }
+#endif
+        return APR_SUCCESS;
+    }
+    return APR_EINVAL;
+#else
+    return APR_ENOTIMPL;
+#endif
+}
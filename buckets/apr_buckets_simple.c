@@ -15,6 +15,7 @@
  */
 
 #include "apr_buckets.h"
+#include "apr_buckets_internal.h"
 
 APU_DECLARE_NONSTD(apr_status_t) apr_bucket_simple_copy(apr_bucket *a,
                                                         apr_bucket **b)
@@ -92,6 +93,7 @@ static apr_status_t transient_bucket_setaside(apr_bucket *b, apr_pool_t *pool)
     if (b == NULL) {
         return APR_ENOMEM;
     }
+    APR__BUCKET_STATS_COPY(b->list, setaside_copied, b->length);
     return APR_SUCCESS;
 }
 
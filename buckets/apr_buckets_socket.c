@@ -15,6 +15,7 @@
  */
 
 #include "apr_buckets.h"
+#include "apr_buckets_internal.h"
 
 static apr_status_t socket_bucket_read(apr_bucket *a, const char **str,
                                        apr_size_t *len, apr_read_type_e block)
@@ -23,6 +24,8 @@ static apr_status_t socket_bucket_read(apr_bucket *a, const char **str,
     char *buf;
     apr_status_t rv;
     apr_interval_time_t timeout;
+    apr_off_t state = a->start;
+    apr_size_t size = apr__bucket_read_size(a->list, state);
 
     if (block == APR_NONBLOCK_READ) {
         apr_socket_timeout_get(p, &timeout);
@@ -30,7 +33,7 @@ static apr_status_t socket_bucket_read(apr_bucket *a, const char **str,
     }
 
     *str = NULL;
-    *len = APR_BUCKET_BUFF_SIZE;
+    *len = size;
     buf = apr_bucket_alloc(*len, a->list); /* XXX: check for failure? */
 
     rv = apr_socket_recv(p, buf, len);
@@ -63,14 +66,19 @@ static apr_status_t socket_bucket_read(apr_bucket *a, const char **str,
         /* Change the current bucket to refer to what we read */
         a = apr_bucket_heap_make(a, buf, *len, apr_bucket_free);
         h = a->data;
-        h->alloc_len = APR_BUCKET_BUFF_SIZE; /* note the real buffer size */
+        h->alloc_len = size; /* note the real buffer size */
         *str = buf;
         APR_BUCKET_INSERT_AFTER(a, apr_bucket_socket_create(p, a->list));
+        /* the rest of the socket reads with the size adapted to this read */
+        APR_BUCKET_NEXT(a)->start = apr__bucket_read_size_next(state, size,
+                                                               *len);
+        APR__BUCKET_STATS_READ(a->list, 1, *len);
     }
     else {
         apr_bucket_free(buf);
         a = apr_bucket_immortal_make(a, "", 0);
         *str = a->data;
+        APR__BUCKET_STATS_READ(a->list, 0, 0);
     }
     return APR_SUCCESS;
 }
@@ -104,6 +112,16 @@ APU_DECLARE(apr_bucket *) apr_bucket_socket_create(apr_socket_t *p,
     return apr_bucket_socket_make(b, p);
 }
 
+APU_DECLARE(apr_status_t) apr_bucket_socket_set_buf_size(apr_bucket *e,
+                                                    apr_size_t size)
+{
+    if (!APR_BUCKET_IS_SOCKET(e)) {
+        return APR_EINVAL;
+    }
+    e->start = apr__bucket_read_size_set(e->list, size);
+    return APR_SUCCESS;
+}
+
 APU_DECLARE_DATA const apr_bucket_type_t apr_bucket_type_socket = {
     "SOCKET", 5, APR_BUCKET_DATA,
     apr_bucket_destroy_noop,
@@ -0,0 +1,309 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "apu_config.h"
+#include "apr_buckets.h"
+
+#if defined(HAVE_SPLICE) && APR_HAVE_FCNTL_H && APR_HAVE_UNISTD_H
+
+#include "apr_portable.h"
+#include "apr_strings.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+
+/* The most we push through the intermediate pipe at once, which is the
+ * default capacity of a pipe on Linux.
+ */
+#define SPLICE_PIPE_SIZE 65536
+
+#define SPLICE_PIPE_KEY "apr_bucket_splice_pipe:%pp"
+
+typedef struct splice_pipe_t {
+    int fds[2];
+} splice_pipe_t;
+
+static apr_status_t splice_pipe_cleanup(void *data)
+{
+    splice_pipe_t *sp = data;
+
+    close(sp->fds[0]);
+    close(sp->fds[1]);
+    free(sp);
+
+    return APR_SUCCESS;
+}
+
+/* The intermediate pipe used to splice from a socket to the given socket,
+ * created on first use and closed along with the socket's pool. The socket
+ * data live in the pool's userdata, hence the socket in the key.
+ */
+static apr_status_t splice_pipe_get(splice_pipe_t **psp, apr_socket_t *sock)
+{
+    splice_pipe_t *sp = NULL;
+    char key[64];
+    apr_status_t rv;
+
+    apr_snprintf(key, sizeof(key), SPLICE_PIPE_KEY, sock);
+    apr_socket_data_get((void **)&sp, key, sock);
+    if (!sp) {
+        sp = malloc(sizeof(*sp));
+        if (!sp) {
+            return APR_ENOMEM;
+        }
+        if (pipe(sp->fds) < 0) {
+            rv = errno;
+            free(sp);
+            return rv;
+        }
+        fcntl(sp->fds[0], F_SETFD, FD_CLOEXEC);
+        fcntl(sp->fds[1], F_SETFD, FD_CLOEXEC);
+
+        rv = apr_socket_data_set(sock, sp, key, splice_pipe_cleanup);
+        if (rv != APR_SUCCESS) {
+            splice_pipe_cleanup(sp);
+            return rv;
+        }
+    }
+
+    *psp = sp;
+    return APR_SUCCESS;
+}
+
+/* Wait for a descriptor to become readable or writable, within the
+ * timeout of the APR object it belongs to.
+ */
+static apr_status_t splice_wait(int fd, short events,
+                                apr_interval_time_t timeout)
+{
+    struct pollfd pfd;
+    int rc, msec = -1;
+
+    if (timeout == 0) {
+        return APR_EAGAIN;
+    }
+    if (timeout > 0) {
+        /* rounded up, a shorter timeout must still wait */
+        apr_interval_time_t ms = (timeout + 999) / 1000;
+
+        msec = (ms < INT_MAX) ? (int)ms : INT_MAX;
+    }
+
+    pfd.fd = fd;
+    pfd.events = events;
+    pfd.revents = 0;
+
+    do {
+        rc = poll(&pfd, 1, msec);
+    } while (rc < 0 && errno == EINTR);
+
+    if (rc < 0) {
+        return errno;
+    }
+    if (rc == 0) {
+        return APR_TIMEUP;
+    }
+    return APR_SUCCESS;
+}
+
+/* Move up to len bytes from descriptor in to descriptor out (one of them
+ * being a pipe), waiting as allowed by the given timeouts.  Zero bytes
+ * moved means end of stream.  SPLICE_F_MORE is only given when more data
+ * follows, or the socket would hold back the last packet.
+ */
+static apr_status_t splice_move(int in, apr_interval_time_t in_timeout,
+                                int out, apr_interval_time_t out_timeout,
+                                apr_size_t len, int more, apr_size_t *moved)
+{
+    unsigned int flags = SPLICE_F_MOVE | SPLICE_F_NONBLOCK;
+    apr_status_t rv;
+    ssize_t n;
+
+    if (more) {
+        flags |= SPLICE_F_MORE;
+    }
+
+    for (;;) {
+        n = splice(in, NULL, out, NULL, len, flags);
+        if (n >= 0) {
+            *moved = (apr_size_t)n;
+            return APR_SUCCESS;
+        }
+
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EINVAL || errno == ENOSYS) {
+            /* not supported for these descriptors */
+            return APR_ENOTIMPL;
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            return errno;
+        }
+
+        /* we cannot tell which side would block, so wait for both */
+        rv = splice_wait(in, POLLIN, in_timeout);
+        if (rv == APR_SUCCESS) {
+            rv = splice_wait(out, POLLOUT, out_timeout);
+        }
+        if (rv != APR_SUCCESS) {
+            return rv;
+        }
+    }
+}
+
+/* Data stuck in the intermediate pipe because the destination would not
+ * take it is read back and inserted as a heap bucket before the socket
+ * bucket, so that nothing is lost.
+ */
+static apr_status_t splice_pipe_drain(apr_bucket *e, splice_pipe_t *sp,
+                                      apr_size_t len)
+{
+    while (len) {
+        apr_size_t size = (len < APR_BUCKET_BUFF_SIZE) ? len
+                                                       : APR_BUCKET_BUFF_SIZE;
+        char *buf = apr_bucket_alloc(size, e->list);
+        ssize_t n;
+
+        if (!buf) {
+            return APR_ENOMEM;
+        }
+        do {
+            n = read(sp->fds[0], buf, size);
+        } while (n < 0 && errno == EINTR);
+        if (n <= 0) {
+            apr_bucket_free(buf);
+            return (n < 0) ? errno : APR_EGENERAL;
+        }
+
+        APR_BUCKET_INSERT_BEFORE(e, apr_bucket_heap_create(buf, (apr_size_t)n,
+                                                           apr_bucket_free,
+                                                           e->list));
+        len -= (apr_size_t)n;
+    }
+
+    return APR_SUCCESS;
+}
+
+static apr_status_t pipe_splice(apr_bucket *e, apr_socket_t *sock, int out,
+                                apr_interval_time_t out_timeout,
+                                apr_size_t max, int more, apr_size_t *nbytes)
+{
+    apr_file_t *p = e->data;
+    apr_interval_time_t in_timeout;
+    apr_os_file_t in;
+    apr_status_t rv;
+
+    apr_os_file_get(&in, p);
+    apr_file_pipe_timeout_get(p, &in_timeout);
+
+    rv = splice_move(in, in_timeout, out, out_timeout, max, more, nbytes);
+    if (rv == APR_SUCCESS && *nbytes == 0) {
+        /* same as pipe_bucket_read() at the end of the pipe */
+        apr_bucket_immortal_make(e, "", 0);
+        apr_file_close(p);
+        rv = APR_EOF;
+    }
+
+    return rv;
+}
+
+static apr_status_t socket_splice(apr_bucket *e, apr_socket_t *sock, int out,
+                                  apr_interval_time_t out_timeout,
+                                  apr_size_t max, int more,
+                                  apr_size_t *nbytes)
+{
+    apr_socket_t *s = e->data;
+    apr_interval_time_t in_timeout;
+    apr_os_sock_t in;
+    splice_pipe_t *sp;
+    apr_size_t len, moved;
+    apr_status_t rv;
+
+    rv = splice_pipe_get(&sp, sock);
+    if (rv != APR_SUCCESS) {
+        return rv;
+    }
+
+    apr_os_sock_get(&in, s);
+    apr_socket_timeout_get(s, &in_timeout);
+
+    /* from the socket into the pipe */
+    rv = splice_move(in, in_timeout, sp->fds[1], -1,
+                     (max < SPLICE_PIPE_SIZE) ? max : SPLICE_PIPE_SIZE, 0,
+                     &len);
+    if (rv != APR_SUCCESS) {
+        return rv;
+    }
+    if (len == 0) {
+        /* same as socket_bucket_read() at the end of the stream */
+        apr_bucket_immortal_make(e, "", 0);
+        return APR_EOF;
+    }
+
+    /* and from the pipe into the other socket, all of it */
+    while (len) {
+        rv = splice_move(sp->fds[0], -1, out, out_timeout, len, more,
+                         &moved);
+        if (rv != APR_SUCCESS) {
+            apr_status_t drv = splice_pipe_drain(e, sp, len);
+            return (drv == APR_SUCCESS) ? rv : drv;
+        }
+        *nbytes += moved;
+        len -= moved;
+    }
+
+    return APR_SUCCESS;
+}
+
+APU_DECLARE(apr_status_t) apr_bucket_splice(apr_bucket *e,
+                                            apr_socket_t *sock,
+                                            apr_size_t max, int more,
+                                            apr_size_t *nbytes)
+{
+    apr_interval_time_t out_timeout;
+    apr_os_sock_t out;
+
+    *nbytes = 0;
+
+    if (!APR_BUCKET_IS_PIPE(e) && !APR_BUCKET_IS_SOCKET(e)) {
+        return APR_ENOTIMPL;
+    }
+
+    apr_os_sock_get(&out, sock);
+    apr_socket_timeout_get(sock, &out_timeout);
+
+    if (APR_BUCKET_IS_PIPE(e)) {
+        return pipe_splice(e, sock, out, out_timeout, max, more, nbytes);
+    }
+    return socket_splice(e, sock, out, out_timeout, max, more, nbytes);
+}
+
+#else /* !HAVE_SPLICE */
+
+APU_DECLARE(apr_status_t) apr_bucket_splice(apr_bucket *e,
+                                            apr_socket_t *sock,
+                                            apr_size_t max, int more,
+                                            apr_size_t *nbytes)
+{
+    *nbytes = 0;
+    return APR_ENOTIMPL;
+}
+
+#endif /* HAVE_SPLICE */
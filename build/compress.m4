@@ -0,0 +1,88 @@
+dnl -------------------------------------------------------- -*- autoconf -*-
+dnl Licensed to the Apache Software Foundation (ASF) under one or more
+dnl contributor license agreements.  See the NOTICE file distributed with
+dnl this work for additional information regarding copyright ownership.
+dnl The ASF licenses this file to You under the Apache License, Version 2.0
+dnl (the "License"); you may not use this file except in compliance with
+dnl the License.  You may obtain a copy of the License at
+dnl
+dnl     http://www.apache.org/licenses/LICENSE-2.0
+dnl
+dnl Unless required by applicable law or agreed to in writing, software
+dnl distributed under the License is distributed on an "AS IS" BASIS,
+dnl WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+dnl See the License for the specific language governing permissions and
+dnl limitations under the License.
+
+dnl
+dnl Compression libraries of the brigade codecs
+dnl
+
+dnl
+dnl APU_CHECK_COMPRESS_LIB(name, header, lib, function, DIR)
+dnl
+dnl Look for a compression library, setting apu_have_<name> to 1 and
+dnl linking APR-util with it when found.
+dnl
+AC_DEFUN([APU_CHECK_COMPRESS_LIB], [
+  apu_have_$1=0
+  compress_have_headers=0
+  compress_have_libs=0
+  compress_CPPFLAGS=""
+  compress_LDFLAGS=""
+
+  old_libs="$LIBS"
+  old_cppflags="$CPPFLAGS"
+  old_ldflags="$LDFLAGS"
+
+  if test "$5" != "yes"; then
+    compress_CPPFLAGS="-I$5/include"
+    compress_LDFLAGS="-L$5/lib -L$5/lib64"
+    APR_ADDTO(CPPFLAGS, [$compress_CPPFLAGS])
+    APR_ADDTO(LDFLAGS, [$compress_LDFLAGS])
+    AC_MSG_NOTICE(checking for $1 in $5)
+  fi
+
+  AC_CHECK_HEADERS($2, [compress_have_headers=1])
+  AC_CHECK_LIB($3, $4, [compress_have_libs=1])
+  if test "$compress_have_headers" = "1" && test "$compress_have_libs" = "1"; then
+    apu_have_$1=1
+    APR_ADDTO(APRUTIL_INCLUDES, [$compress_CPPFLAGS])
+    APR_ADDTO(APRUTIL_LDFLAGS, [$compress_LDFLAGS])
+    APR_ADDTO(APRUTIL_EXPORT_LIBS, [-l$3])
+    APR_ADDTO(APRUTIL_LIBS, [-l$3])
+  else
+    AC_MSG_ERROR([$1 was requested but could not be found])
+  fi
+
+  LIBS="$old_libs"
+  CPPFLAGS="$old_cppflags"
+  LDFLAGS="$old_ldflags"
+])
+
+dnl
+dnl APU_CHECK_COMPRESS: look for zlib and libzstd
+dnl
+AC_DEFUN([APU_CHECK_COMPRESS], [
+  apu_have_zlib=0
+  apu_have_zstd=0
+
+  AC_ARG_WITH([zlib],
+  [APR_HELP_STRING([--with-zlib=DIR], [enable the deflate and gzip brigade codecs, using zlib])],
+  [
+    if test "$withval" != "no"; then
+      APU_CHECK_COMPRESS_LIB(zlib, zlib.h, z, deflateInit2_, $withval)
+    fi
+  ])
+
+  AC_ARG_WITH([zstd],
+  [APR_HELP_STRING([--with-zstd=DIR], [enable the zstd brigade codec, using libzstd 1.4 or later])],
+  [
+    if test "$withval" != "no"; then
+      APU_CHECK_COMPRESS_LIB(zstd, zstd.h, zstd, ZSTD_compressStream2, $withval)
+    fi
+  ])
+
+  AC_SUBST(apu_have_zlib)
+  AC_SUBST(apu_have_zstd)
+])
@@ -25,6 +25,8 @@
 #include "apr_hash.h"
 #include "apr_thread_mutex.h"
 #include "apr_lib.h"
+#define APR_WANT_MEMFUNC
+#include "apr_want.h"
 
 #if APU_HAVE_CRYPTO
 
@@ -791,6 +793,176 @@ APU_DECLARE(apr_status_t) apr_crypto_block_decrypt_finish(unsigned char *out,
     return ctx->provider->block_decrypt_finish(out, outlen, ctx);
 }
 
+/* The largest cipher block carried over between buckets */
+#define BRIGADE_CARRY_MAX 64
+
+typedef apr_status_t (*crypto_block_fn)(unsigned char **out,
+        apr_size_t *outlen, const unsigned char *in, apr_size_t inlen,
+        apr_crypto_block_t *ctx);
+typedef apr_status_t (*crypto_block_finish_fn)(unsigned char *out,
+        apr_size_t *outlen, apr_crypto_block_t *ctx);
+
+/* Run inlen bytes through the cipher, then the final block if finish is
+ * given, appending the result to the brigade as a heap bucket.
+ */
+static apr_status_t crypto_brigade_emit(apr_bucket_brigade *out,
+        const unsigned char *in, apr_size_t inlen, crypto_block_fn crypt,
+        crypto_block_finish_fn finish, apr_crypto_block_t *ctx)
+{
+    apr_bucket *e;
+    unsigned char *buf;
+    apr_size_t size, len = 0, flen;
+    apr_status_t rv;
+
+    /* the maximum size of the output, final block included */
+    rv = crypt(NULL, &size, in, inlen, ctx);
+    if (rv != APR_SUCCESS) {
+        return rv;
+    }
+    buf = apr_bucket_alloc(size, out->bucket_alloc);
+    if (!buf) {
+        return APR_ENOMEM;
+    }
+
+    if (inlen) {
+        len = size;
+        rv = crypt(&buf, &len, in, inlen, ctx);
+    }
+    if (rv == APR_SUCCESS && finish) {
+        flen = size - len;
+        rv = finish(buf + len, &flen, ctx);
+        len += flen;
+    }
+    if (rv != APR_SUCCESS || !len) {
+        apr_bucket_free(buf);
+        return rv;
+    }
+
+    e = apr_bucket_heap_create((char *)buf, size, apr_bucket_free,
+                               out->bucket_alloc);
+    e->length = len;
+    APR_BRIGADE_INSERT_TAIL(out, e);
+    return APR_SUCCESS;
+}
+
+static apr_status_t crypto_block_brigade(apr_bucket_brigade *out,
+        apr_bucket_brigade *in, apr_size_t blockSize, apr_read_type_e mode,
+        apr_crypto_block_t *ctx, crypto_block_fn crypt,
+        crypto_block_finish_fn finish)
+{
+    unsigned char carry[BRIGADE_CARRY_MAX];
+    apr_size_t carry_len = 0;
+    apr_size_t chunk;
+    apr_status_t rv = APR_SUCCESS;
+
+    if (!blockSize || blockSize > sizeof(carry)) {
+        return APR_EINVAL;
+    }
+    chunk = APR_BUCKET_BUFF_SIZE - APR_BUCKET_BUFF_SIZE % blockSize;
+
+    while (!APR_BRIGADE_EMPTY(in)) {
+        apr_bucket *e = APR_BRIGADE_FIRST(in);
+        const unsigned char *data, *start;
+        apr_size_t len;
+
+        if (APR_BUCKET_IS_METADATA(e)) {
+            if (APR_BUCKET_IS_EOS(e)) {
+                rv = crypto_brigade_emit(out, carry, carry_len, crypt,
+                                         finish, ctx);
+                if (rv != APR_SUCCESS) {
+                    break;
+                }
+                carry_len = 0;
+            }
+            APR_BUCKET_REMOVE(e);
+            APR_BRIGADE_INSERT_TAIL(out, e);
+            continue;
+        }
+
+        rv = apr_bucket_read(e, (const char **)&data, &len, mode);
+        if (rv != APR_SUCCESS) {
+            break;
+        }
+        start = data;
+
+        /* complete the block started by the previous buckets */
+        if (carry_len) {
+            apr_size_t n = blockSize - carry_len;
+
+            if (n > len) {
+                n = len;
+            }
+            memcpy(carry + carry_len, data, n);
+            carry_len += n;
+            data += n;
+            len -= n;
+            if (carry_len == blockSize) {
+                rv = crypto_brigade_emit(out, carry, blockSize, crypt, NULL,
+                                         ctx);
+                if (rv == APR_SUCCESS) {
+                    carry_len = 0;
+                }
+            }
+        }
+
+        while (rv == APR_SUCCESS && len >= blockSize) {
+            apr_size_t n = (len > chunk) ? chunk : len - len % blockSize;
+
+            rv = crypto_brigade_emit(out, data, n, crypt, NULL, ctx);
+            if (rv != APR_SUCCESS) {
+                break;
+            }
+            data += n;
+            len -= n;
+        }
+        if (rv != APR_SUCCESS) {
+            /* drop what was emitted or carried already, which a retry
+             * would otherwise process twice */
+            if (data != start) {
+                if ((apr_size_t)(data - start) < e->length) {
+                    apr_bucket_split(e, data - start);
+                }
+                apr_bucket_delete(e);
+            }
+            break;
+        }
+
+        /* what is left is less than a block, and carry_len is zero
+         * unless this bucket did not even complete the carried block
+         */
+        memcpy(carry + carry_len, data, len);
+        carry_len += len;
+        apr_bucket_delete(e);
+    }
+
+    /* the incomplete block waits in the input for the next call */
+    if (carry_len) {
+        apr_bucket *e = apr_bucket_heap_create((const char *)carry, carry_len,
+                                               NULL, in->bucket_alloc);
+        APR_BRIGADE_INSERT_HEAD(in, e);
+    }
+
+    return rv;
+}
+
+APU_DECLARE(apr_status_t) apr_crypto_block_encrypt_brigade(
+        apr_bucket_brigade *out, apr_bucket_brigade *in,
+        apr_size_t blockSize, apr_read_type_e mode, apr_crypto_block_t *ctx)
+{
+    return crypto_block_brigade(out, in, blockSize, mode, ctx,
+                                apr_crypto_block_encrypt,
+                                apr_crypto_block_encrypt_finish);
+}
+
+APU_DECLARE(apr_status_t) apr_crypto_block_decrypt_brigade(
+        apr_bucket_brigade *out, apr_bucket_brigade *in,
+        apr_size_t blockSize, apr_read_type_e mode, apr_crypto_block_t *ctx)
+{
+    return crypto_block_brigade(out, in, blockSize, mode, ctx,
+                                apr_crypto_block_decrypt,
+                                apr_crypto_block_decrypt_finish);
+}
+
 APU_DECLARE(apr_status_t) apr_crypto_digest_init(apr_crypto_digest_t **d,
         const apr_crypto_key_t *key, apr_crypto_digest_rec_t *rec, apr_pool_t *p)
 {
@@ -286,6 +286,72 @@ struct apr_bucket_brigade {
  */
 typedef apr_status_t (*apr_brigade_flush)(apr_bucket_brigade *bb, void *ctx);
 
+/** @see apr_brigade_cursor_t */
+typedef struct apr_brigade_cursor_t apr_brigade_cursor_t;
+
+/**
+ * A cursor reading a brigade in place, from its start, for parsers.
+ * @see apr_brigade_cursor_init
+ */
+struct apr_brigade_cursor_t {
+    /** The brigade read */
+    apr_bucket_brigade *bb;
+    /** Whether reading buckets may block */
+    apr_read_type_e block;
+    /** The delimiter last searched for */
+    const char *delim;
+    /** The length of the delimiter last searched for */
+    apr_size_t delim_len;
+    /** The number of bytes from the start known not to begin the
+     *  delimiter, where the next search resumes */
+    apr_size_t scanned;
+};
+
+/** @see apr_brigade_codec_create */
+typedef struct apr_brigade_codec_t apr_brigade_codec_t;
+
+/**
+ * The compression formats of brigade codecs.
+ */
+typedef enum {
+    APR_BRIGADE_CODEC_DEFLATE,  /**< zlib format (RFC 1950), needs zlib */
+    APR_BRIGADE_CODEC_GZIP,     /**< gzip format (RFC 1952), needs zlib */
+    APR_BRIGADE_CODEC_ZSTD      /**< Zstandard (RFC 8878), needs libzstd */
+} apr_brigade_codec_e;
+
+/**
+ * Function called with the data to add to a digest.
+ * @param ctx The digest context
+ * @param data The data
+ * @param len The length of the data
+ * @return APR_SUCCESS, or an error stopping the brigade function
+ */
+typedef apr_status_t (*apr_brigade_digest_fn)(void *ctx, const char *data,
+                                              apr_size_t len);
+
+/** @see apr_brigade_digest_t */
+typedef struct apr_brigade_digest_t apr_brigade_digest_t;
+
+/**
+ * A digest updated with the data of the buckets passing through it.
+ * @see apr_brigade_digest_init
+ */
+struct apr_brigade_digest_t {
+    /** The function updating the digest */
+    apr_brigade_digest_fn update;
+    /** The digest context, given to the function */
+    void *ctx;
+    /** The number of bytes digested */
+    apr_off_t length;
+};
+
+/**
+ * A compact brigade, holding its buckets in a contiguous array rather
+ * than a ring, with small data stored in the array itself.
+ * @see apr_brigade_array_create
+ */
+typedef struct apr_brigade_array_t apr_brigade_array_t;
+
 /*
  * define APR_BUCKET_DEBUG if you want your brigades to be checked for
  * validity at every possible instant.  this will slow your code down
@@ -514,6 +580,12 @@ typedef apr_status_t (*apr_brigade_flush)(apr_bucket_brigade *bb, void *ctx);
  * @return true or false
  */
 #define APR_BUCKET_IS_POOL(e)        ((e)->type == &apr_bucket_type_pool)
+/**
+ * Determine if a bucket is an ATOMIC bucket
+ * @param e The bucket to inspect
+ * @return true or false
+ */
+#define APR_BUCKET_IS_ATOMIC(e)      ((e)->type == &apr_bucket_type_atomic)
 
 /*
  * General-purpose reference counting for the various bucket types.
@@ -558,6 +630,25 @@ struct apr_bucket_heap {
     void (*free_func)(void *data);
 };
 
+/** @see apr_bucket_atomic */
+typedef struct apr_bucket_atomic apr_bucket_atomic;
+/**
+ * A bucket referring to heap data that may be shared by buckets of
+ * different bucket allocators, used by different threads.
+ */
+struct apr_bucket_atomic {
+    /** Number of buckets using this memory, updated atomically */
+    volatile apr_uint32_t refcount;
+    /** The start of the data actually allocated.  This should never be
+     * modified, it is only used to free the bucket.
+     */
+    char    *base;
+    /** how much memory was allocated */
+    apr_size_t  alloc_len;
+    /** function to use to delete the data, from any thread */
+    void (*free_func)(void *data);
+};
+
 /** @see apr_bucket_pool */
 typedef struct apr_bucket_pool apr_bucket_pool;
 /**
@@ -595,6 +686,32 @@ struct apr_bucket_pool {
     apr_bucket_alloc_t *list;
 };
 
+/** @see apr_bucket_mmap_policy_t */
+typedef struct apr_bucket_mmap_policy_t apr_bucket_mmap_policy_t;
+
+/**
+ * How FILE buckets are memory mapped, and how the system is advised about
+ * the access to the mappings of MMAP buckets.
+ * @see apr_bucket_mmap_set_policy
+ */
+struct apr_bucket_mmap_policy_t {
+    /** Files shorter than this are read rather than mapped, zero for
+     *  @a APR_MMAP_THRESHOLD */
+    apr_size_t min_size;
+    /** The maximum size of a mapping, longer files being mapped in
+     *  pieces, zero for @a APR_MMAP_LIMIT. It is rounded down to a
+     *  multiple of 64K, the largest granularity of mapping offsets. */
+    apr_size_t max_size;
+    /** Have the system read this many bytes of a mapping ahead of the
+     *  data read from it, or zero */
+    apr_size_t prefetch;
+    /** Mappings up to this size are populated entirely when created,
+     *  rather than faulted in page by page, or zero */
+    apr_size_t populate_size;
+    /** Whether to advise the system that mappings are read sequentially */
+    int sequential;
+};
+
 #if APR_HAS_MMAP
 /** @see apr_bucket_mmap */
 typedef struct apr_bucket_mmap apr_bucket_mmap;
@@ -606,6 +723,10 @@ struct apr_bucket_mmap {
     apr_bucket_refcount  refcount;
     /** The mmap this sub_bucket refers to */
     apr_mmap_t *mmap;
+    /** The policy advising the system about the mapping, or NULL */
+    const apr_bucket_mmap_policy_t *policy;
+    /** Offset in the mapping up to which prefetching was requested */
+    apr_off_t prefetch_end;
 };
 #endif
 
@@ -629,6 +750,15 @@ struct apr_bucket_file {
 #endif /* APR_HAS_MMAP */
     /** File read block size */
     apr_size_t read_size;
+    /** Number of read blocks to have the system read ahead, reading
+     *  at positions (pread) rather than seeking, or zero */
+    apr_size_t read_ahead;
+    /** Offset up to which read ahead was requested */
+    apr_off_t read_ahead_end;
+#if APR_HAS_MMAP
+    /** How this bucket is memory-mapped, or NULL for the defaults */
+    const apr_bucket_mmap_policy_t *mmap_policy;
+#endif /* APR_HAS_MMAP */
 };
 
 /** @see apr_bucket_structs */
@@ -640,6 +770,7 @@ typedef union apr_bucket_structs apr_bucket_structs;
 union apr_bucket_structs {
     apr_bucket      b;      /**< Bucket */
     apr_bucket_heap heap;   /**< Heap */
+    apr_bucket_atomic atomic; /**< Atomic */
     apr_bucket_pool pool;   /**< Pool */
 #if APR_HAS_MMAP
     apr_bucket_mmap mmap;   /**< MMap */
@@ -814,6 +945,119 @@ APU_DECLARE(apr_status_t) apr_brigade_split_boundary(apr_bucket_brigade *bbOut,
                                                      apr_off_t maxbytes)
                           __attribute__((nonnull(1,2)));
 
+/**
+ * Initialize a cursor reading a bucket brigade from its start.
+ *
+ * A cursor lets a parser look at the data of a brigade, find delimiters
+ * across buckets and consume what it parsed, without splitting buckets
+ * or moving them to other brigades. Buckets are read only as far as
+ * needed. Metadata buckets are passed over as if empty.
+ * @param cur The cursor to initialize
+ * @param bb The bucket brigade to read
+ * @param block Whether reading buckets may block
+ */
+APU_DECLARE(void) apr_brigade_cursor_init(apr_brigade_cursor_t *cur,
+                                          apr_bucket_brigade *bb,
+                                          apr_read_type_e block);
+
+/**
+ * Find a delimiter in the data of the brigade.
+ * @param cur The cursor
+ * @param delim The delimiter to find
+ * @param delim_len The length of the delimiter, or APR_BUCKETS_STRING
+ * @param len Returns the number of bytes up to and including the
+ *            delimiter, or the number of bytes available if not found
+ * @return APR_SUCCESS if found, APR_INCOMPLETE if the brigade ends before,
+ *         or the error reading a bucket (APR_EAGAIN for a non blocking
+ *         read), in which case @a len is not set
+ * @remark A search that was incomplete resumes where it stopped when the
+ *         same delimiter is looked for again, typically once more data
+ *         was added to the brigade.
+ */
+APU_DECLARE(apr_status_t) apr_brigade_cursor_find(apr_brigade_cursor_t *cur,
+                                                  const char *delim,
+                                                  apr_size_t delim_len,
+                                                  apr_size_t *len);
+
+/**
+ * Copy the first bytes of the brigade, without consuming them.
+ * @param cur The cursor
+ * @param buf The buffer to copy into
+ * @param len The number of bytes wanted; returns the number copied
+ * @return APR_SUCCESS if all were copied, APR_INCOMPLETE if the brigade
+ *         is shorter, or the error reading a bucket
+ */
+APU_DECLARE(apr_status_t) apr_brigade_cursor_peek(apr_brigade_cursor_t *cur,
+                                                  char *buf,
+                                                  apr_size_t *len);
+
+/**
+ * Get a contiguous view of the first bytes of the brigade, without
+ * consuming them.
+ * @param cur The cursor
+ * @param len The number of bytes wanted
+ * @param data Returns the data, pointing into the bucket if it holds all
+ *             of it, or copied into @a p otherwise
+ * @param p The pool to copy into when the data spans buckets
+ * @return APR_SUCCESS, APR_INCOMPLETE if the brigade is shorter, or the
+ *         error reading a bucket
+ * @remark The view is valid until the brigade is next modified.
+ */
+APU_DECLARE(apr_status_t) apr_brigade_cursor_view(apr_brigade_cursor_t *cur,
+                                                  apr_size_t len,
+                                                  const char **data,
+                                                  apr_pool_t *p);
+
+/**
+ * Describe the first bytes of the brigade as an iovec, without copying
+ * or consuming them.
+ * @param cur The cursor
+ * @param len The number of bytes wanted
+ * @param vec The iovec to fill
+ * @param nvec The number of elements of the iovec; returns the number of
+ *             elements filled
+ * @return APR_SUCCESS, APR_INCOMPLETE if the brigade is shorter or there
+ *         are not enough elements, or the error reading a bucket
+ */
+APU_DECLARE(apr_status_t) apr_brigade_cursor_iovec(apr_brigade_cursor_t *cur,
+                                                   apr_size_t len,
+                                                   struct iovec *vec,
+                                                   int *nvec);
+
+/**
+ * Consume the first bytes of the brigade.
+ *
+ * The buckets consumed entirely are deleted, along with the metadata
+ * buckets among them. The first bucket left is trimmed in place when its
+ * type uses the generic split functions, and split otherwise.
+ * @param cur The cursor
+ * @param len The number of bytes to consume
+ * @return APR_SUCCESS, APR_INCOMPLETE if the brigade was shorter (and is
+ *         now empty of data), or the error reading or splitting a bucket
+ */
+APU_DECLARE(apr_status_t) apr_brigade_cursor_consume(apr_brigade_cursor_t *cur,
+                                                     apr_size_t len);
+
+/**
+ * Merge runs of small in-memory buckets of a bucket brigade into heap
+ * buckets, so that writing the brigade out takes fewer iovecs.
+ *
+ * HEAP, TRANSIENT, IMMORTAL, POOL, ATOMIC and MMAP buckets shorter than
+ * @a min_chunk are candidates; two or more adjacent candidates are
+ * copied into a new heap bucket of at most @a max_chunk bytes. Larger
+ * buckets, other bucket types and metadata buckets are left untouched
+ * and end a run.
+ * @param bb The bucket brigade to coalesce
+ * @param min_chunk Buckets shorter than this are merged
+ * @param max_chunk The largest heap bucket to create (at least
+ *                  @a min_chunk)
+ * @return APR_SUCCESS, or the error reading a bucket, in which case the
+ *         buckets of that run are left as they were
+ */
+APU_DECLARE(apr_status_t) apr_brigade_coalesce(apr_bucket_brigade *bb,
+                                               apr_size_t min_chunk,
+                                               apr_size_t max_chunk);
+
 /**
  * Create an iovec of the elements in a bucket_brigade... return number 
  * of elements used.  This is useful for writing to a file or to the
@@ -826,6 +1070,34 @@ APU_DECLARE(apr_status_t) apr_brigade_split_boundary(apr_bucket_brigade *bbOut,
 APU_DECLARE(apr_status_t) apr_brigade_to_iovec(apr_bucket_brigade *b, 
                                                struct iovec *vec, int *nvec);
 
+/**
+ * Send the contents of a bucket brigade to a socket.
+ *
+ * Runs of in-memory buckets are gathered into iovecs and written with a
+ * single apr_socket_sendv(). Where sendfile is supported, FILE buckets
+ * whose file was opened with APR_FOPEN_SENDFILE_ENABLED are passed to
+ * apr_socket_sendfile() along with the surrounding in-memory buckets as
+ * header and trailer iovecs, so that the file data is never copied into
+ * user space. Other bucket types are read and sent as in-memory data.
+ *
+ * The data sent is removed from the brigade as it goes: fully sent
+ * buckets are deleted, and a partially sent bucket is split at the exact
+ * byte where the write stopped. Metadata buckets are deleted as they are
+ * passed over. PIPE and SOCKET buckets are moved with apr_bucket_splice()
+ * where possible, and read otherwise.
+ * @param sock The socket to write to
+ * @param bb The bucket brigade to send
+ * @param nbytes Returns the number of bytes sent, also on error
+ * @return APR_SUCCESS once the brigade is empty, or the error returned
+ *         by the socket (APR_EAGAIN, APR_TIMEUP, ...) or by a bucket read,
+ *         in which case the unsent data remains in the brigade.
+ * @remark The socket's timeout applies as usual: with a timeout of zero,
+ *         APR_EAGAIN is returned as soon as the socket would block.
+ */
+APU_DECLARE(apr_status_t) apr_brigade_send(apr_socket_t *sock,
+                                           apr_bucket_brigade *bb,
+                                           apr_off_t *nbytes);
+
 /**
  * This function writes a list of strings into a bucket brigade. 
  * @param b The bucket brigade to add to
@@ -881,6 +1153,42 @@ APU_DECLARE(apr_status_t) apr_brigade_writev(apr_bucket_brigade *b,
                                              const struct iovec *vec,
                                              apr_size_t nvec);
 
+/**
+ * Get space to write into at the end of a bucket brigade, so that data
+ * can be produced in place rather than copied in by apr_brigade_write().
+ *
+ * If the brigade ends with a heap bucket with at least @a min bytes left
+ * in its buffer (and not shared with another bucket), that space is
+ * returned. Otherwise an empty heap bucket is added, its buffer sized to
+ * the larger of @a min and APR_BUCKET_BUFF_SIZE, rounded up to what the
+ * bucket allocator would hand out anyway.
+ * @param b The bucket brigade to write into
+ * @param min The minimum number of contiguous bytes wanted
+ * @param ptr Returns where to write
+ * @param avail Returns the number of bytes available at @a ptr, at least
+ *              @a min
+ * @return APR_SUCCESS
+ * @remark The brigade's length does not change until apr_brigade_commit()
+ *         is called, though the empty heap bucket (if any) is part of it
+ *         already. The space is only valid until the brigade is next
+ *         modified.
+ */
+APU_DECLARE(apr_status_t) apr_brigade_reserve(apr_bucket_brigade *b,
+                                              apr_size_t min,
+                                              char **ptr,
+                                              apr_size_t *avail);
+
+/**
+ * Add the data written into the space returned by apr_brigade_reserve()
+ * to the bucket brigade.
+ * @param b The bucket brigade written into
+ * @param used The number of bytes written, at most the space available
+ * @return APR_SUCCESS, or APR_EINVAL if the brigade does not end with the
+ *         reserved space or @a used exceeds it
+ */
+APU_DECLARE(apr_status_t) apr_brigade_commit(apr_bucket_brigade *b,
+                                             apr_size_t used);
+
 /**
  * This function writes a string into a bucket brigade.
  * @param bb The bucket brigade to add to
@@ -966,9 +1274,355 @@ APU_DECLARE(apr_bucket *) apr_brigade_insert_file(apr_bucket_brigade *bb,
                                                   apr_off_t len,
                                                   apr_pool_t *p);
 
+/**
+ * Bound the memory held by a bucket brigade by writing the data of its
+ * memory buckets (HEAP, POOL and TRANSIENT) past a threshold into a
+ * temporary file, replacing them by FILE buckets.
+ *
+ * The memory buckets are left alone as long as they fit in @a threshold
+ * bytes, then the first one which doesn't and all the following ones are
+ * spooled whole, keeping the data in order. Other buckets are left in place.
+ * @param bb The bucket brigade to spool
+ * @param threshold The number of bytes to keep in memory
+ * @param tmpdir The directory to create the temporary file in, or NULL
+ *               for the system's (@see apr_temp_dir_get)
+ * @return APR_SUCCESS, or the error creating or writing the file, in
+ *         which case the buckets not spooled yet are left in memory
+ * @remark The temporary file is created in the brigade's pool, only once
+ *         something needs spooling, and is deleted when closed. It can
+ *         be memory mapped or sent with sendfile by the reader.
+ * @remark Later calls for the same brigade append to the same file while
+ *         FILE buckets of the previous ones still exist, otherwise the file
+ *         is deleted and a new one is started. The file is also deleted
+ *         when the brigade is destroyed and no FILE bucket refers to it.
+ * @remark Spooling before apr_brigade_setaside() keeps the data set
+ *         aside for a slow client on disk rather than in the pool.
+ */
+APU_DECLARE(apr_status_t) apr_brigade_spool(apr_bucket_brigade *bb,
+                                            apr_off_t threshold,
+                                            const char *tmpdir);
+
+/**
+ * Create a streaming compressor or decompressor for bucket brigades.
+ * @param codec Returns the codec
+ * @param type The compression format
+ * @param decompress Non zero to decompress, zero to compress
+ * @param level The compression level, zero for the format's default
+ *              (ignored when decompressing)
+ * @param p The pool the codec lives in, its state is released when
+ *          the pool is cleared
+ * @param list The bucket allocator of the output buckets, which must
+ *             outlive the codec
+ * @return APR_SUCCESS, APR_ENOTIMPL if APR-util was built without the
+ *         library for the format, or APR_EINVAL for an invalid level
+ */
+APU_DECLARE(apr_status_t) apr_brigade_codec_create(apr_brigade_codec_t **codec,
+                                                   apr_brigade_codec_e type,
+                                                   int decompress, int level,
+                                                   apr_pool_t *p,
+                                                   apr_bucket_alloc_t *list);
+
+/**
+ * Run the buckets of a brigade through a codec, moving the result to
+ * another brigade.
+ *
+ * The data buckets of @a in are read and deleted one at a time, so FILE,
+ * PIPE or SOCKET buckets are transformed as they are read rather than
+ * held in memory. The output is appended to @a out as HEAP buckets of
+ * APR_BUCKET_BUFF_SIZE once full. A FLUSH bucket flushes the output
+ * pending in the codec and an EOS bucket ends the stream, both being
+ * moved to @a out after that output, as are other metadata buckets.
+ * @param codec The codec
+ * @param out The brigade to append the output to
+ * @param in The brigade to transform, emptied on success
+ * @param block Whether reading the buckets of @a in may block
+ * @return APR_SUCCESS, the error reading a bucket (APR_EAGAIN in
+ *         nonblocking mode) in which case that bucket and the following
+ *         ones are left in @a in, APR_EINVAL if the data to decompress is
+ *         invalid or follows the end of the stream, or APR_INCOMPLETE if
+ *         that stream ends before its EOS bucket.
+ * @remark The memory held by a codec is bounded by the state of the
+ *         compression library and one output buffer, whatever the size
+ *         of the data.
+ */
+APU_DECLARE(apr_status_t) apr_brigade_codec_process(apr_brigade_codec_t *codec,
+                                                    apr_bucket_brigade *out,
+                                                    apr_bucket_brigade *in,
+                                                    apr_read_type_e block);
+
+/**
+ * Initialize a brigade digest.
+ * @param digest The digest to initialize
+ * @param update The function updating the digest, like
+ *               apr_brigade_digest_md5(), apr_brigade_digest_sha1() or
+ *               apr_brigade_digest_crypto()
+ * @param ctx The digest context given to @a update, which must have been
+ *            initialized for the digest algorithm already
+ */
+APU_DECLARE(void) apr_brigade_digest_init(apr_brigade_digest_t *digest,
+                                          apr_brigade_digest_fn update,
+                                          void *ctx);
+
+/**
+ * Move buckets from the start of a brigade to the end of another,
+ * updating a digest with their data on the way.
+ *
+ * This computes a checksum or ETag as the data is handed to the next
+ * consumer, while it is in the cache, rather than in a separate pass over
+ * the data.
+ * @param digest The digest
+ * @param out The brigade to append the buckets to
+ * @param in The brigade to take the buckets from
+ * @param block Whether reading the buckets of @a in may block
+ * @param readbytes The maximum number of bytes to move, the last bucket
+ *                  being split if needed, or -1 to move all the buckets.
+ *                  Limiting it bounds the memory that FILE or PIPE
+ *                  buckets read into @a out can take.
+ * @return APR_SUCCESS, the error reading a bucket (APR_EAGAIN in
+ *         nonblocking mode), in which case that bucket and the following
+ *         ones are left in @a in, or the error of the digest function.
+ * @remark Metadata buckets are moved as is.
+ */
+APU_DECLARE(apr_status_t) apr_brigade_digest_pass(apr_brigade_digest_t *digest,
+                                                  apr_bucket_brigade *out,
+                                                  apr_bucket_brigade *in,
+                                                  apr_read_type_e block,
+                                                  apr_off_t readbytes);
+
+/**
+ * Digest update function for apr_brigade_digest_init(), with an
+ * apr_md5_ctx_t as context.
+ */
+APU_DECLARE_NONSTD(apr_status_t) apr_brigade_digest_md5(void *ctx,
+                                                        const char *data,
+                                                        apr_size_t len);
+
+/**
+ * Digest update function for apr_brigade_digest_init(), with an
+ * apr_sha1_ctx_t as context.
+ */
+APU_DECLARE_NONSTD(apr_status_t) apr_brigade_digest_sha1(void *ctx,
+                                                         const char *data,
+                                                         apr_size_t len);
+
+/**
+ * Digest update function for apr_brigade_digest_init(), with an
+ * apr_crypto_digest_t as context (hash, sign or verify).
+ * @remark Returns APR_ENOTIMPL when APR-util is built without crypto
+ *         support.
+ */
+APU_DECLARE_NONSTD(apr_status_t) apr_brigade_digest_crypto(void *ctx,
+                                                           const char *data,
+                                                           apr_size_t len);
+
+/**
+ * Create a compact brigade.
+ *
+ * A compact brigade keeps the lengths of its buckets, and the data of
+ * those known to stay in memory, in a contiguous array, so walking it
+ * touches neither the bucket structures nor their ring links. Writes of
+ * a few bytes are copied into the array itself instead of allocating a
+ * bucket. It is meant for brigades of many small buckets which are
+ * built, measured, partitioned and written out with writev(), and is
+ * converted to and from a classic brigade for everything else.
+ * @param p The pool to associate with the compact brigade. Data is not
+ *          allocated out of the pool, but a cleanup is registered.
+ * @param list The bucket allocator to use
+ * @return The new compact brigade
+ */
+APU_DECLARE(apr_brigade_array_t *) apr_brigade_array_create(apr_pool_t *p,
+                                                   apr_bucket_alloc_t *list);
+
+/**
+ * Destroy a compact brigade, destroying all of its buckets.
+ * @param a The compact brigade to destroy
+ */
+APU_DECLARE(apr_status_t) apr_brigade_array_destroy(apr_brigade_array_t *a);
+
+/**
+ * Empty a compact brigade, destroying all of its buckets.
+ * @param data The compact brigade to clean up
+ * @remark The data is a void * so this can be used as a pool cleanup.
+ */
+APU_DECLARE(apr_status_t) apr_brigade_array_cleanup(void *data);
+
+/**
+ * Return the number of buckets in a compact brigade, each run of data
+ * written in the array counting as one.
+ * @param a The compact brigade
+ */
+APU_DECLARE(int) apr_brigade_array_count(const apr_brigade_array_t *a);
+
+/**
+ * Append a bucket to a compact brigade.
+ * @param a The compact brigade
+ * @param e The bucket, which must not be in a brigade
+ */
+APU_DECLARE(void) apr_brigade_array_insert(apr_brigade_array_t *a,
+                                           apr_bucket *e);
+
+/**
+ * Append a copy of some data to a compact brigade. Small writes are
+ * stored in the array, larger ones in a heap bucket.
+ * @param a The compact brigade
+ * @param str The data to write
+ * @param nbyte The number of bytes to write
+ */
+APU_DECLARE(apr_status_t) apr_brigade_array_write(apr_brigade_array_t *a,
+                                                  const char *str,
+                                                  apr_size_t nbyte);
+
+/**
+ * Move all the buckets of a brigade to the end of a compact brigade.
+ * @param a The compact brigade
+ * @param b The brigade, left empty
+ */
+APU_DECLARE(void) apr_brigade_array_from_brigade(apr_brigade_array_t *a,
+                                                 apr_bucket_brigade *b);
+
+/**
+ * Move all the buckets of a compact brigade to the end of a brigade,
+ * the data stored in the array becoming heap buckets.
+ * @param a The compact brigade, left empty
+ * @param b The brigade
+ */
+APU_DECLARE(void) apr_brigade_array_to_brigade(apr_brigade_array_t *a,
+                                               apr_bucket_brigade *b);
+
+/**
+ * Split a compact brigade at the given index, as apr_brigade_split_ex().
+ * @param a The compact brigade to split
+ * @param index The index of the first bucket to move
+ * @param rest The compact brigade to move the buckets from @a index on
+ *             to, emptied first, or NULL to create a new one
+ * @return The compact brigade holding the moved buckets
+ */
+APU_DECLARE(apr_brigade_array_t *) apr_brigade_array_split(
+                                                    apr_brigade_array_t *a,
+                                                    int index,
+                                                    apr_brigade_array_t *rest);
+
+/**
+ * Partition a compact brigade at the given offset, as
+ * apr_brigade_partition(): the bucket holding the offset is split, so
+ * that a bucket starts there.
+ * @param a The compact brigade to partition
+ * @param point The offset at which to partition the compact brigade
+ * @param index Returns the index of the first bucket after the offset,
+ *              or the number of buckets if the offset is at the end
+ * @return APR_SUCCESS, APR_INCOMPLETE if the compact brigade is shorter
+ *         than @a point, or the error reading or splitting a bucket
+ */
+APU_DECLARE(apr_status_t) apr_brigade_array_partition(apr_brigade_array_t *a,
+                                                      apr_off_t point,
+                                                      int *index);
+
+/**
+ * Return the total length of a compact brigade, as apr_brigade_length().
+ * @param a The compact brigade
+ * @param read_all Read buckets of unknown length to find their length
+ * @param length Returns the length of the compact brigade, or -1 if it
+ *               holds a bucket of unknown length and @a read_all is 0
+ */
+APU_DECLARE(apr_status_t) apr_brigade_array_length(apr_brigade_array_t *a,
+                                                   int read_all,
+                                                   apr_off_t *length);
+
+/**
+ * Create an iovec of the data of a compact brigade, as
+ * apr_brigade_to_iovec(). The iovec points into the compact brigade,
+ * and is valid until it is next modified.
+ * @param a The compact brigade
+ * @param vec The iovec to fill
+ * @param nvec The number of elements in the iovec. On return, the number
+ *             of iovec elements actually filled out.
+ */
+APU_DECLARE(apr_status_t) apr_brigade_array_to_iovec(apr_brigade_array_t *a,
+                                                     struct iovec *vec,
+                                                     int *nvec);
+
 
 
 /*  *****  Bucket freelist functions *****  */
+
+/** @see apr_bucket_alloc_opts_t */
+typedef struct apr_bucket_alloc_opts_t apr_bucket_alloc_opts_t;
+
+/**
+ * Options controlling the behaviour of a bucket allocator.
+ *
+ * Allocations too large to be carved out of the allocator's small node
+ * freelist are given a memory node of their own by the underlying
+ * apr_allocator_t.  When max_free is not zero, those nodes (up to 64KB)
+ * are kept in per size class freelists once freed, and are handed out
+ * again to later allocations of the same size class without involving
+ * the apr_allocator_t.
+ */
+struct apr_bucket_alloc_opts_t {
+    /** The maximum number of bytes kept in the size class freelists (the
+     *  high watermark).  Zero disables the size class freelists, which is
+     *  the behaviour of apr_bucket_alloc_create() and
+     *  apr_bucket_alloc_create_ex().
+     */
+    apr_size_t max_free;
+    /** The number of bytes the size class freelists are trimmed down to,
+     *  by giving memory back to the apr_allocator_t, once max_free is
+     *  exceeded (the low watermark).
+     */
+    apr_size_t min_free;
+    /** Non zero to collect statistics, @see apr_bucket_alloc_stats_get() */
+    int stats;
+};
+
+/**
+ * The number of allocation size slots in apr_bucket_alloc_stats_t.
+ */
+#define APR_BUCKET_ALLOC_STATS_CLASSES 18
+
+/** @see apr_bucket_alloc_stats_t */
+typedef struct apr_bucket_alloc_stats_t apr_bucket_alloc_stats_t;
+
+/**
+ * Statistics of a bucket allocator and of the buckets and brigades using
+ * it, collected when enabled with apr_bucket_alloc_opts_t.
+ *
+ * The allocation counts are indexed by size: slot 0 counts the small
+ * allocations (up to APR_BUCKET_ALLOC_SIZE) carved out of the allocator's
+ * own blocks, slot n the allocations given a memory node of n times 4KB
+ * (so slot 1 is never used, nodes being at least 8KB), and the last slot
+ * those larger than 64KB.
+ */
+struct apr_bucket_alloc_stats_t {
+    /** Number of blocks held for small allocations */
+    apr_size_t blocks;
+    /** Number of small allocations free for reuse */
+    apr_size_t freelist;
+    /** Number of memory nodes kept in the size class freelists */
+    apr_size_t class_nodes;
+    /** Bytes kept in the size class freelists */
+    apr_size_t class_free;
+    /** Bytes currently allocated, headers included */
+    apr_size_t in_use;
+    /** Highest value of in_use */
+    apr_size_t peak;
+    /** Allocations by size */
+    apr_uint64_t allocs[APR_BUCKET_ALLOC_STATS_CLASSES];
+    /** Frees by size */
+    apr_uint64_t frees[APR_BUCKET_ALLOC_STATS_CLASSES];
+    /** Allocations served from the size class freelists */
+    apr_uint64_t class_hits;
+    /** Reads of FILE, PIPE and SOCKET buckets */
+    apr_uint64_t reads;
+    /** Of these reads, the ones that morphed the bucket into a HEAP bucket */
+    apr_uint64_t morphs;
+    /** Bytes read into the HEAP buckets so created */
+    apr_uint64_t morph_bytes;
+    /** Bytes copied by apr_brigade_write() and friends */
+    apr_uint64_t write_copied;
+    /** Bytes copied when setting aside buckets */
+    apr_uint64_t setaside_copied;
+};
+
 /**
  * Create a bucket allocator.
  * @param p This pool's underlying apr_allocator_t is used to allocate memory
@@ -994,12 +1648,43 @@ APU_DECLARE_NONSTD(apr_bucket_alloc_t *) apr_bucket_alloc_create(apr_pool_t *p);
  */
 APU_DECLARE_NONSTD(apr_bucket_alloc_t *) apr_bucket_alloc_create_ex(apr_allocator_t *allocator);
 
+/**
+ * Create a bucket allocator with options.
+ * @param allocator This apr_allocator_t is used to allocate both the bucket
+ *          allocator and all memory handed out by the bucket allocator.  If
+ *          NULL, the apr_allocator_t of the pool @a p is used.
+ * @param p If not NULL, the bucket allocator is destroyed along with this
+ *          pool, as with apr_bucket_alloc_create().  Otherwise the caller
+ *          is responsible for destroying the bucket allocator, as with
+ *          apr_bucket_alloc_create_ex().
+ * @param opts The options of the allocator, or NULL for the defaults.
+ * @return The bucket allocator, or NULL if allocation failed and @a p is
+ *         NULL (otherwise the pool's abort function is called).
+ * @warning The allocator must never be used by more than one thread at a time.
+ */
+APU_DECLARE_NONSTD(apr_bucket_alloc_t *) apr_bucket_alloc_create_ex2(
+                                             apr_allocator_t *allocator,
+                                             apr_pool_t *p,
+                                             const apr_bucket_alloc_opts_t *opts);
+
 /**
  * Destroy a bucket allocator.
  * @param list The allocator to be destroyed
  */
 APU_DECLARE_NONSTD(void) apr_bucket_alloc_destroy(apr_bucket_alloc_t *list);
 
+/**
+ * Get the statistics of a bucket allocator.
+ * @param list The allocator
+ * @param stats Returns a copy of the current statistics
+ * @return APR_SUCCESS, or APR_EINVAL if statistics were not enabled when
+ *         creating the allocator (@see apr_bucket_alloc_create_ex2)
+ * @remark When not enabled, collecting statistics costs a test of a
+ *         pointer on each allocation.
+ */
+APU_DECLARE(apr_status_t) apr_bucket_alloc_stats_get(apr_bucket_alloc_t *list,
+                                                     apr_bucket_alloc_stats_t *stats);
+
 /**
  * Get the aligned size corresponding to the requested size, but minus the
  * allocator(s) overhead such that the allocation would remain in the
@@ -1152,6 +1837,35 @@ APU_DECLARE_NONSTD(void) apr_bucket_free(void *block);
  */
 #define apr_bucket_copy(e,c) (e)->type->copy(e, c)
 
+/**
+ * Move data from a PIPE or SOCKET bucket straight to a socket, without
+ * copying it through user space.
+ *
+ * The bucket is left in place to represent the rest of the stream. At the
+ * end of the stream it becomes a zero length bucket (closing the pipe, as
+ * reading it would) and APR_EOF is returned.
+ * @param e The PIPE or SOCKET bucket to move data from
+ * @param sock The socket to write to
+ * @param max The most bytes to move
+ * @param more Whether more data follows e, in which case the socket may
+ *             hold back a partial packet (as with TCP_CORK)
+ * @param nbytes Returns the number of bytes written to the socket
+ * @return APR_SUCCESS, APR_EOF, the error of either descriptor, or
+ *         APR_ENOTIMPL if the bucket type or the platform cannot splice,
+ *         in which case nothing was done and the bucket should be read.
+ * @remark The timeouts of the pipe or socket and of the destination socket
+ *         are honoured. When splicing from a socket the data goes through a
+ *         kernel pipe kept with the destination socket (in its pool's
+ *         userdata, until the pool is cleared); anything the
+ *         destination would not take is read back into a heap bucket
+ *         inserted before e, so nothing is lost.
+ * @remark Only implemented with splice() on Linux.
+ */
+APU_DECLARE(apr_status_t) apr_bucket_splice(apr_bucket *e,
+                                            apr_socket_t *sock,
+                                            apr_size_t max, int more,
+                                            apr_size_t *nbytes);
+
 /* Bucket type handling */
 
 /**
@@ -1250,6 +1964,12 @@ APU_DECLARE_DATA extern const apr_bucket_type_t apr_bucket_type_mmap;
  * the data is copied on to the heap.
  */
 APU_DECLARE_DATA extern const apr_bucket_type_t apr_bucket_type_pool;
+/**
+ * The ATOMIC bucket type.  This bucket represents data on the heap which
+ * may be shared with buckets of other bucket allocators, and so used by
+ * several threads at once.
+ */
+APU_DECLARE_DATA extern const apr_bucket_type_t apr_bucket_type_atomic;
 /**
  * The PIPE bucket type.  This bucket represents a pipe to another program.
  */
@@ -1481,6 +2201,56 @@ APU_DECLARE(apr_bucket *) apr_bucket_heap_make(apr_bucket *b, const char *buf,
                                                apr_size_t nbyte,
                                                void (*free_func)(void *data));
 
+/**
+ * Create a bucket referring to memory on the heap which can be shared by
+ * buckets of other bucket allocators, and so used by other threads. The
+ * bucket takes over responsibility for freeing the memory, which is done
+ * by the thread destroying the last bucket referring to it.
+ * @param buf The buffer to insert into the bucket
+ * @param nbyte The size of the buffer to insert.
+ * @param free_func Function to use to free the data, which must be safe
+ *                  to call from any thread; NULL indicates that the bucket
+ *                  should make a copy of the data (freed with free())
+ * @param list The freelist from which this bucket should be allocated
+ * @return The new bucket, or NULL if allocation failed
+ * @remark Use apr_bucket_atomic_copy() to hand the data to a brigade of
+ *         another bucket allocator; apr_bucket_copy() and
+ *         apr_bucket_split() give buckets of the same allocator, as usual.
+ */
+APU_DECLARE(apr_bucket *) apr_bucket_atomic_create(const char *buf,
+                                                   apr_size_t nbyte,
+                                                   void (*free_func)(void *data),
+                                                   apr_bucket_alloc_t *list);
+
+/**
+ * Make the bucket passed in a bucket refer to shareable heap data
+ * @param b The bucket to make into an ATOMIC bucket
+ * @param buf The buffer to insert into the bucket
+ * @param nbyte The size of the buffer to insert.
+ * @param free_func Function to use to free the data, which must be safe
+ *                  to call from any thread; NULL indicates that the bucket
+ *                  should make a copy of the data (freed with free())
+ * @return The new bucket, or NULL if allocation failed
+ */
+APU_DECLARE(apr_bucket *) apr_bucket_atomic_make(apr_bucket *b,
+                                                 const char *buf,
+                                                 apr_size_t nbyte,
+                                                 void (*free_func)(void *data));
+
+/**
+ * Copy an ATOMIC bucket into another bucket allocator, typically one used
+ * by another thread. The data is shared, not copied.
+ * @param e The ATOMIC bucket to copy
+ * @param list The freelist from which the copy should be allocated
+ * @param c Returns a pointer to the new bucket
+ * @return APR_SUCCESS, or APR_EINVAL if the bucket is not an ATOMIC bucket
+ * @remark The bucket @a e itself must not be used concurrently; make one
+ *         copy per thread from the thread owning it.
+ */
+APU_DECLARE(apr_status_t) apr_bucket_atomic_copy(apr_bucket *e,
+                                                 apr_bucket_alloc_t *list,
+                                                 apr_bucket **c);
+
 /**
  * Create a bucket referring to memory allocated from a pool.
  *
@@ -1536,6 +2306,23 @@ APU_DECLARE(apr_bucket *) apr_bucket_mmap_make(apr_bucket *b, apr_mmap_t *mm,
                                                apr_size_t length);
 #endif
 
+/**
+ * Set the policy of a FILE bucket's memory mapping, or of the access to
+ * an MMAP bucket's mapping.
+ *
+ * The prefetching follows the buckets as they are split and read, so a
+ * mapping being sent is faulted in ahead of the writes rather than page
+ * by page.
+ * @param e The FILE or MMAP bucket
+ * @param policy The policy, which is not copied and must outlive the
+ *               bucket and those made from it, or NULL for the defaults
+ * @return APR_SUCCESS, APR_EINVAL if @a e is neither a FILE nor an MMAP
+ *         bucket, or APR_ENOTIMPL if mmap is not supported
+ * @remark The advice is only given where madvise() is available.
+ */
+APU_DECLARE(apr_status_t) apr_bucket_mmap_set_policy(apr_bucket *e,
+                                     const apr_bucket_mmap_policy_t *policy);
+
 /**
  * Create a bucket referring to a socket.
  * @param thissock The socket to put in the bucket
@@ -1553,6 +2340,21 @@ APU_DECLARE(apr_bucket *) apr_bucket_socket_create(apr_socket_t *thissock,
 APU_DECLARE(apr_bucket *) apr_bucket_socket_make(apr_bucket *b, 
                                                  apr_socket_t *thissock);
 
+/**
+ * Set the maximum size of the read buffers allocated by a SOCKET bucket
+ * (default is @a APR_BUCKET_BUFF_SIZE). Reads then start at
+ * @a APR_BUCKET_BUFF_SIZE, double up to @a size while they fill the
+ * buffer, and halve back when they return less than half of it, so a
+ * bulk transfer is read in fewer and larger buckets.
+ * @param e The bucket
+ * @param size The maximum size of the allocated buffers
+ * @return APR_SUCCESS, or APR_EINVAL if @a e is not a SOCKET bucket
+ * @remark The setting carries over to the bucket holding the rest of
+ * the socket after each read.
+ */
+APU_DECLARE(apr_status_t) apr_bucket_socket_set_buf_size(apr_bucket *e,
+                                                         apr_size_t size);
+
 /**
  * Create a bucket referring to a pipe.
  * @param thispipe The pipe to put in the bucket
@@ -1571,6 +2373,17 @@ APU_DECLARE(apr_bucket *) apr_bucket_pipe_create(apr_file_t *thispipe,
 APU_DECLARE(apr_bucket *) apr_bucket_pipe_make(apr_bucket *b, 
                                                apr_file_t *thispipe);
 
+/**
+ * Set the maximum size of the read buffers allocated by a PIPE bucket
+ * (default is @a APR_BUCKET_BUFF_SIZE), adapting the size of the reads
+ * as apr_bucket_socket_set_buf_size() does.
+ * @param e The bucket
+ * @param size The maximum size of the allocated buffers
+ * @return APR_SUCCESS, or APR_EINVAL if @a e is not a PIPE bucket
+ */
+APU_DECLARE(apr_status_t) apr_bucket_pipe_set_buf_size(apr_bucket *e,
+                                                       apr_size_t size);
+
 /**
  * Create a bucket referring to a file.
  * @param fd The file to put in the bucket
@@ -1629,6 +2442,24 @@ APU_DECLARE(apr_status_t) apr_bucket_file_enable_mmap(apr_bucket *b,
 APU_DECLARE(apr_status_t) apr_bucket_file_set_buf_size(apr_bucket *e,
                                                        apr_size_t size);
 
+/**
+ * Read a FILE bucket at positions rather than by seeking, and have the
+ * system read the next blocks ahead so that a streaming reader does not
+ * wait on the disk (default is disabled)
+ * @param e The bucket
+ * @param blocks The number of read buffers (@see apr_bucket_file_set_buf_size)
+ *               to read ahead, zero to disable
+ * @return APR_SUCCESS normally, APR_ENOTIMPL if positional reads are not
+ *         supported on this platform
+ * @remark Relevant/used only when memory-mapping is disabled (@see
+ * apr_bucket_file_enable_mmap), and for unbuffered files. As the file
+ * offset is neither used nor changed, APR_FOPEN_XTHREAD files are not
+ * reopened.
+ * @remark Read ahead is requested with posix_fadvise() where available.
+ */
+APU_DECLARE(apr_status_t) apr_bucket_file_set_read_ahead(apr_bucket *e,
+                                                         apr_size_t blocks);
+
 /** @} */
 #ifdef __cplusplus
 }
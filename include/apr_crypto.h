@@ -23,6 +23,7 @@
 #include "apr_hash.h"
 #include "apu_errno.h"
 #include "apr_thread_proc.h"
+#include "apr_buckets.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -860,6 +861,62 @@ APU_DECLARE(apr_status_t) apr_crypto_block_decrypt(unsigned char **out,
 APU_DECLARE(apr_status_t) apr_crypto_block_decrypt_finish(unsigned char *out,
         apr_size_t *outlen, apr_crypto_block_t *ctx);
 
+/**
+ * @brief Encrypt the buckets of a brigade, moving the result to another.
+ * @note The data buckets of in are read and deleted one at a time, and
+ *       the ciphertext is appended to out as heap buckets, so a brigade
+ *       of any size is encrypted with little memory. Data that does not
+ *       fill a cipher block is carried over to the next bucket, and is
+ *       left at the start of in when the brigade ends before its EOS
+ *       bucket, to be completed by the data appended for the next call.
+ *       The EOS bucket encrypts the final (padded) block, as done by
+ *       apr_crypto_block_encrypt_finish(), and other metadata buckets
+ *       are moved to out as is.
+ * @param out The brigade to append the encrypted data to.
+ * @param in The brigade to encrypt.
+ * @param blockSize The block size of the cipher, as returned by
+ *        apr_crypto_block_encrypt_init().
+ * @param mode Whether reading the buckets of in may block.
+ * @param ctx The block context to use.
+ * @return APR_ECRYPT if an error occurred.
+ * @return APR_EPADDING if padding was enabled and the block was incorrectly
+ *         formatted.
+ * @return APR_ENOTIMPL if not implemented.
+ * @return APR_EINVAL if the key type does not support the given operation.
+ * @return The error reading a bucket (APR_EAGAIN in nonblocking mode), in
+ *         which case that bucket and the following ones are left in in.
+ * @remark Whatever the error, in is left holding the data not processed
+ *         yet only (the carried data first), so it's never processed twice.
+ */
+APU_DECLARE(apr_status_t) apr_crypto_block_encrypt_brigade(
+        apr_bucket_brigade *out, apr_bucket_brigade *in,
+        apr_size_t blockSize, apr_read_type_e mode, apr_crypto_block_t *ctx);
+
+/**
+ * @brief Decrypt the buckets of a brigade, moving the result to another.
+ * @note This works as apr_crypto_block_encrypt_brigade(), the EOS bucket
+ *       decrypting the final block as done by
+ *       apr_crypto_block_decrypt_finish().
+ * @param out The brigade to append the decrypted data to.
+ * @param in The brigade to decrypt.
+ * @param blockSize The block size of the cipher, as returned by
+ *        apr_crypto_block_decrypt_init().
+ * @param mode Whether reading the buckets of in may block.
+ * @param ctx The block context to use.
+ * @return APR_ECRYPT if an error occurred.
+ * @return APR_EPADDING if padding was enabled and the block was incorrectly
+ *         formatted.
+ * @return APR_ENOTIMPL if not implemented.
+ * @return APR_EINVAL if the key type does not support the given operation.
+ * @return The error reading a bucket (APR_EAGAIN in nonblocking mode), in
+ *         which case that bucket and the following ones are left in in.
+ * @remark Whatever the error, in is left holding the data not processed
+ *         yet only (the carried data first), so it's never processed twice.
+ */
+APU_DECLARE(apr_status_t) apr_crypto_block_decrypt_brigade(
+        apr_bucket_brigade *out, apr_bucket_brigade *in,
+        apr_size_t blockSize, apr_read_type_e mode, apr_crypto_block_t *ctx);
+
 /**
  * @brief Clean encryption / decryption context.
  * @note After cleanup, a context is free to be reused if necessary.
@@ -56,6 +56,45 @@ APU_DECLARE(apr_status_t) apr_queue_create(apr_queue_t **queue,
                                            unsigned int queue_capacity, 
                                            apr_pool_t *a);
 
+/**
+ * Flag for apr_queue_create_ex(): back the queue by a lock-free ring
+ * of sequence-numbered cells, so pushes and pops only contend on an
+ * atomic compare-and-swap. The mutex and condition variables are used
+ * only by threads which have to block because the queue is actually
+ * full or empty.
+ * @note The capacity is rounded up to the next power of two (and at
+ * least 2), and apr_queue_size() is an estimate.
+ */
+#define APR_QUEUE_LOCKFREE 0x01
+
+/**
+ * Flag for apr_queue_create_ex(): back the queue by a ring for a single
+ * pushing and a single popping thread, whose fast path is a plain store
+ * and an atomic exchange, with the positions of either side on their
+ * own cache line. Like APR_QUEUE_LOCKFREE, threads take the mutex only
+ * to block on a full or empty queue, so apr_queue_push() and
+ * apr_queue_pop() may still be used to wait.
+ * @warning The caller must make sure that at most one thread pushes and
+ * one thread pops at any time, and apr_queue_interrupt_all() and
+ * apr_queue_term() remain the only calls safe from any thread.
+ * @note The capacity is rounded up as for APR_QUEUE_LOCKFREE, which is
+ * ignored if both flags are given.
+ */
+#define APR_QUEUE_SPSC 0x02
+
+/**
+ * create a FIFO queue, with flags
+ * @param queue The new queue
+ * @param queue_capacity maximum size of the queue
+ * @param flags zero, APR_QUEUE_LOCKFREE or APR_QUEUE_SPSC
+ * @param a pool to allocate queue from
+ * @returns APR_EINVAL if the capacity is not supported by the flags
+ */
+APU_DECLARE(apr_status_t) apr_queue_create_ex(apr_queue_t **queue,
+                                              unsigned int queue_capacity,
+                                              apr_uint32_t flags,
+                                              apr_pool_t *a);
+
 /**
  * push/add an object to the queue, blocking if the queue is already full
  *
@@ -102,6 +141,77 @@ APU_DECLARE(apr_status_t) apr_queue_trypush(apr_queue_t *queue, void *data);
  */
 APU_DECLARE(apr_status_t) apr_queue_trypop(apr_queue_t *queue, void **data);
 
+/**
+ * push/add up to nelts objects to the queue under a single lock, blocking
+ * only if the queue is already full. As many objects as there is room
+ * for are pushed, in order.
+ *
+ * @param queue the queue
+ * @param data the array of objects
+ * @param nelts the number of objects in data
+ * @param pushed set to the number of objects pushed, at least one on
+ *        success unless nelts is zero
+ * @returns APR_EINTR the blocking was interrupted (try again)
+ * @returns APR_EOF the queue has been terminated
+ * @returns APR_SUCCESS on a successful push
+ */
+APU_DECLARE(apr_status_t) apr_queue_push_batch(apr_queue_t *queue,
+                                               void **data,
+                                               unsigned int nelts,
+                                               unsigned int *pushed);
+
+/**
+ * pop/get up to nelts objects from the queue under a single lock,
+ * blocking only if the queue is already empty.
+ *
+ * @param queue the queue
+ * @param data the array receiving the objects, in order
+ * @param nelts the number of objects data can hold
+ * @param popped set to the number of objects popped, at least one on
+ *        success unless nelts is zero
+ * @returns APR_EINTR the blocking was interrupted (try again)
+ * @returns APR_EOF if the queue has been terminated
+ * @returns APR_SUCCESS on a successful pop
+ */
+APU_DECLARE(apr_status_t) apr_queue_pop_batch(apr_queue_t *queue,
+                                              void **data,
+                                              unsigned int nelts,
+                                              unsigned int *popped);
+
+/**
+ * push/add up to nelts objects to the queue under a single lock,
+ * returning immediately if the queue is full
+ *
+ * @param queue the queue
+ * @param data the array of objects
+ * @param nelts the number of objects in data
+ * @param pushed set to the number of objects pushed
+ * @returns APR_EAGAIN the queue is full
+ * @returns APR_EOF the queue has been terminated
+ * @returns APR_SUCCESS on a successful push
+ */
+APU_DECLARE(apr_status_t) apr_queue_trypush_batch(apr_queue_t *queue,
+                                                  void **data,
+                                                  unsigned int nelts,
+                                                  unsigned int *pushed);
+
+/**
+ * pop/get up to nelts objects from the queue under a single lock,
+ * returning immediately if the queue is empty
+ *
+ * @param queue the queue
+ * @param data the array receiving the objects, in order
+ * @param nelts the number of objects data can hold
+ * @param popped set to the number of objects popped
+ * @returns APR_EAGAIN the queue is empty
+ * @returns APR_EOF the queue has been terminated
+ * @returns APR_SUCCESS on a successful pop
+ */
+APU_DECLARE(apr_status_t) apr_queue_trypop_batch(apr_queue_t *queue,
+                                                 void **data,
+                                                 unsigned int nelts,
+                                                 unsigned int *popped);
+
 /**
  * returns the size of the queue.
  *
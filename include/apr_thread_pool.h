@@ -79,6 +79,37 @@ APU_DECLARE(apr_status_t) apr_thread_pool_create(apr_thread_pool_t **me,
                                                  apr_size_t max_threads,
                                                  apr_pool_t *pool);
 
+/**
+ * Flag for apr_thread_pool_create_ex(): give each thread its own deque.
+ * The tasks pushed by a task running in the pool go to the deque of its
+ * thread rather than to the pool's queue, and idle threads steal the
+ * tasks of the others' deques, so that only tasks pushed from outside the
+ * pool (or scheduled) take the pool's lock. Tasks are still taken by
+ * priority from each deque and the pool's queue, and
+ * apr_thread_pool_tasks_cancel() finds them wherever they are.
+ * @remark The maximum number of threads can't be raised above the one
+ * given at creation time.
+ */
+#define APR_THREAD_POOL_WORK_STEALING 0x01
+
+/**
+ * Create a thread pool, with flags
+ * @param me The pointer in which to return the newly created apr_thread_pool
+ * object, or NULL if thread pool creation fails.
+ * @param init_threads The number of threads to be created initially, this number
+ * will also be used as the initial value for the maximum number of idle threads.
+ * @param max_threads The maximum number of threads that can be created
+ * @param flags Zero or APR_THREAD_POOL_WORK_STEALING
+ * @param pool The pool to use
+ * @return APR_SUCCESS if the thread pool was created successfully. Otherwise,
+ * the error code.
+ */
+APU_DECLARE(apr_status_t) apr_thread_pool_create_ex(apr_thread_pool_t **me,
+                                                    apr_size_t init_threads,
+                                                    apr_size_t max_threads,
+                                                    apr_uint32_t flags,
+                                                    apr_pool_t *pool);
+
 /**
  * Destroy the thread pool and stop all the threads
  * @return APR_SUCCESS if all threads are stopped.
@@ -114,6 +145,47 @@ APU_DECLARE(apr_status_t) apr_thread_pool_schedule(apr_thread_pool_t *me,
                                                    apr_interval_time_t time,
                                                    void *owner);
 
+/**
+ * Handle of a task scheduled by apr_thread_pool_schedule_ex(), which can be
+ * given to apr_thread_pool_schedule_cancel(). Its fields are private.
+ */
+typedef struct apr_thread_pool_timer_t {
+    void *task;
+    apr_uint64_t id;
+} apr_thread_pool_timer_t;
+
+/**
+ * Schedule a task to be run after a delay, returning a handle to cancel it
+ * @param me The thread pool
+ * @param func The task function
+ * @param param The parameter for the task function
+ * @param time Time in microseconds
+ * @param owner Owner of this task.
+ * @param timer Where to store the handle of the task, or NULL
+ * @return APR_SUCCESS if the task had been scheduled successfully
+ * @remark Scheduling and cancelling a task are O(log n) in the number of
+ * scheduled tasks.
+ */
+APU_DECLARE(apr_status_t) apr_thread_pool_schedule_ex(apr_thread_pool_t *me,
+                                                      apr_thread_start_t func,
+                                                      void *param,
+                                                      apr_interval_time_t time,
+                                                      void *owner,
+                                                      apr_thread_pool_timer_t *timer);
+
+/**
+ * Cancel a task scheduled by apr_thread_pool_schedule_ex(), unless it
+ * already started.
+ * @param me The thread pool
+ * @param timer The handle of the task, which is reset
+ * @return APR_SUCCESS if the task was cancelled, APR_NOTFOUND if it started,
+ * was cancelled already or the handle was reset.
+ * @remark Unlike apr_thread_pool_tasks_cancel(), this does not wait for the
+ * task if it is running.
+ */
+APU_DECLARE(apr_status_t) apr_thread_pool_schedule_cancel(apr_thread_pool_t *me,
+                                                          apr_thread_pool_timer_t *timer);
+
 /**
  * Schedule a task to the top of the tasks of same priority.
  * @param me The thread pool
@@ -129,6 +201,177 @@ APU_DECLARE(apr_status_t) apr_thread_pool_top(apr_thread_pool_t *me,
                                               apr_byte_t priority,
                                               void *owner);
 
+/** Opaque handle of a task pushed by apr_thread_pool_push_ex(). */
+typedef struct apr_thread_pool_handle_t apr_thread_pool_handle_t;
+
+/**
+ * Schedule a task to the bottom of the tasks of same priority, once the tasks
+ * it depends on are done, possibly returning a handle to wait for it.
+ * @param me The thread pool
+ * @param func The task function, whose return value is the task's result
+ * @param param The parameter for the task function
+ * @param priority The priority of the task.
+ * @param owner Owner of this task.
+ * @param deps The handles of the tasks to complete before this one runs,
+ * from the same thread pool, or NULL
+ * @param ndeps The number of handles in deps
+ * @param handle Where to store the handle of the task, or NULL. It must be
+ * released with apr_thread_pool_handle_release().
+ * @return APR_SUCCESS if the task had been scheduled successfully, APR_EINVAL
+ * if one of deps is from another thread pool
+ * @remark If one of its dependencies is cancelled, the task is not run and
+ * completes with the same status, as do the tasks depending on it in turn.
+ * @remark The tasks waiting for their dependencies are not accounted by
+ * apr_thread_pool_tasks_count().
+ */
+APU_DECLARE(apr_status_t) apr_thread_pool_push_ex(apr_thread_pool_t *me,
+                                                  apr_thread_start_t func,
+                                                  void *param,
+                                                  apr_byte_t priority,
+                                                  void *owner,
+                                                  apr_thread_pool_handle_t *const *deps,
+                                                  apr_size_t ndeps,
+                                                  apr_thread_pool_handle_t **handle);
+
+/**
+ * Wait for the task of a handle to complete.
+ * @param handle The handle of the task
+ * @param result Where to store the return value of the task function, or NULL
+ * @return APR_SUCCESS if the task was run, APR_NOTFOUND if it was cancelled
+ * (or one of its dependencies was) or the thread pool was destroyed before.
+ * @note The task function should not be waiting for a task which is not
+ * running yet, otherwise all the threads of the pool may get stuck.
+ */
+APU_DECLARE(apr_status_t) apr_thread_pool_handle_wait(apr_thread_pool_handle_t *handle,
+                                                      void **result);
+
+/**
+ * Wait for the task of a handle to complete, for at most some time.
+ * @param handle The handle of the task
+ * @param timeout The time to wait for, in microseconds
+ * @param result Where to store the return value of the task function, or NULL
+ * @return APR_TIMEUP if the task is still not completed after timeout,
+ * otherwise as apr_thread_pool_handle_wait().
+ */
+APU_DECLARE(apr_status_t) apr_thread_pool_handle_timedwait(apr_thread_pool_handle_t *handle,
+                                                           apr_interval_time_t timeout,
+                                                           void **result);
+
+/**
+ * Check whether the task of a handle is completed, without blocking.
+ * @param handle The handle of the task
+ * @param result Where to store the return value of the task function, or NULL
+ * @return APR_EAGAIN if the task is not completed yet, otherwise as
+ * apr_thread_pool_handle_wait().
+ */
+APU_DECLARE(apr_status_t) apr_thread_pool_handle_poll(apr_thread_pool_handle_t *handle,
+                                                      void **result);
+
+/**
+ * Release a handle returned by apr_thread_pool_push_ex(), which should not be
+ * used anymore (the task itself is not cancelled).
+ * @param handle The handle of the task
+ * @remark The handles must be released before the thread pool is destroyed.
+ */
+APU_DECLARE(void) apr_thread_pool_handle_release(apr_thread_pool_handle_t *handle);
+
+/**
+ * Function processing the iterations [begin, end) of a parallel loop.
+ * @param baton The baton given to apr_thread_pool_parallel_for()
+ * @param begin The first iteration
+ * @param end The iteration after the last one
+ * @return APR_SUCCESS, otherwise the loop stops and returns this error
+ */
+typedef apr_status_t (*apr_thread_pool_range_fn_t)(void *baton,
+                                                   apr_size_t begin,
+                                                   apr_size_t end);
+
+/**
+ * Function accumulating the iterations [begin, end) of a parallel reduction
+ * into a partial result.
+ * @param baton The baton given to apr_thread_pool_parallel_reduce()
+ * @param partial The partial result of the calling participant
+ * @param begin The first iteration
+ * @param end The iteration after the last one
+ * @return APR_SUCCESS, otherwise the loop stops and returns this error
+ */
+typedef apr_status_t (*apr_thread_pool_reduce_fn_t)(void *baton,
+                                                    void *partial,
+                                                    apr_size_t begin,
+                                                    apr_size_t end);
+
+/**
+ * Function combining a partial result of a parallel reduction into the
+ * final result.
+ * @param baton The baton given to apr_thread_pool_parallel_reduce()
+ * @param result The final result
+ * @param partial The partial result to combine
+ */
+typedef void (*apr_thread_pool_combine_fn_t)(void *baton, void *result,
+                                             const void *partial);
+
+/**
+ * Run a loop over the iterations [begin, end) in parallel, and wait for it.
+ * @param me The thread pool
+ * @param begin The first iteration
+ * @param end The iteration after the last one
+ * @param grain The minimum number of iterations given to fn at once, or
+ * zero for one
+ * @param fn The function processing the iterations
+ * @param baton The baton to give to fn
+ * @return APR_SUCCESS if all the iterations were processed, otherwise the
+ * first error returned by fn.
+ * @remark The calling thread processes iterations too, along with up to
+ * apr_thread_pool_thread_max_get() tasks pushed to the pool. It only waits
+ * for those which started, the others return immediately if they run after
+ * the loop ended.
+ * The iterations are given in chunks which shrink as the loop progresses,
+ * down to grain, to balance uneven iterations.
+ * @note Unlike apr_thread_pool_tasks_cancel(), this can be called from a
+ * task function, even when all the threads of the pool are busy.
+ */
+APU_DECLARE(apr_status_t) apr_thread_pool_parallel_for(apr_thread_pool_t *me,
+                                                       apr_size_t begin,
+                                                       apr_size_t end,
+                                                       apr_size_t grain,
+                                                       apr_thread_pool_range_fn_t fn,
+                                                       void *baton);
+
+/**
+ * Run a reduction over the iterations [begin, end) in parallel, and wait
+ * for its result.
+ * @param me The thread pool
+ * @param begin The first iteration
+ * @param end The iteration after the last one
+ * @param grain The minimum number of iterations given to reduce at once, or
+ * zero for one
+ * @param reduce The function accumulating the iterations into a partial
+ * result
+ * @param combine The function combining the partial results
+ * @param baton The baton to give to reduce and combine
+ * @param identity The initial value of the partial results and of the result
+ * @param result Where to store the result
+ * @param size The size of identity, result and the partial results
+ * @param pool The pool to allocate the partial results from
+ * @return APR_SUCCESS if all the iterations were processed, otherwise the
+ * first error returned by reduce.
+ * @remark Each participant (see apr_thread_pool_parallel_for()) accumulates
+ * into its own partial result, so reduce needs no locking. The partial
+ * results are then combined by the calling thread, in the same order for
+ * a same number of participants.
+ */
+APU_DECLARE(apr_status_t) apr_thread_pool_parallel_reduce(apr_thread_pool_t *me,
+                                                          apr_size_t begin,
+                                                          apr_size_t end,
+                                                          apr_size_t grain,
+                                                          apr_thread_pool_reduce_fn_t reduce,
+                                                          apr_thread_pool_combine_fn_t combine,
+                                                          void *baton,
+                                                          const void *identity,
+                                                          void *result,
+                                                          apr_size_t size,
+                                                          apr_pool_t *pool);
+
 /**
  * Cancel tasks submitted by the owner. If there is any task from the owner that
  * is currently running, the function will spin until the task finished.
@@ -0,0 +1,88 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef APR_BUCKETS_INTERNAL_H
+#define APR_BUCKETS_INTERNAL_H
+
+#include "apr_buckets.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The head of apr_bucket_alloc_t, the members the buckets access inline */
+typedef struct apr__bucket_alloc_head_t {
+    /* NULL unless statistics are collected */
+    apr_bucket_alloc_stats_t *stats;
+} apr__bucket_alloc_head_t;
+
+/* The statistics of a bucket allocator, NULL unless they were enabled
+ * with apr_bucket_alloc_opts_t. This is a single load, so that counting
+ * costs no more than a branch when statistics are disabled.
+ */
+static APR_INLINE
+apr_bucket_alloc_stats_t *apr__bucket_alloc_stats(apr_bucket_alloc_t *list)
+{
+    return ((apr__bucket_alloc_head_t *)list)->stats;
+}
+
+/* Account for a bucket being read from a FILE, PIPE or SOCKET, which
+ * morphed into a HEAP bucket of len bytes if morphed is set.
+ */
+#define APR__BUCKET_STATS_READ(list, morphed, len) do { \
+    apr_bucket_alloc_stats_t *stats__ = apr__bucket_alloc_stats(list); \
+    if (stats__) { \
+        stats__->reads++; \
+        if (morphed) { \
+            stats__->morphs++; \
+            stats__->morph_bytes += (len); \
+        } \
+    } \
+} while (0)
+
+/* Account for len bytes copied into the heap, field being one of
+ * write_copied and setaside_copied.
+ */
+#define APR__BUCKET_STATS_COPY(list, field, len) do { \
+    apr_bucket_alloc_stats_t *stats__ = apr__bucket_alloc_stats(list); \
+    if (stats__) { \
+        stats__->field += (len); \
+    } \
+} while (0)
+
+/* SOCKET and PIPE buckets keep the size of their reads in their
+ * (otherwise unused) start offset, -1 reading APR_BUCKET_BUFF_SIZE
+ * bytes at a time. The read size state is made by
+ * apr__bucket_read_size_set() from the maximum size of the reads.
+ */
+apr_off_t apr__bucket_read_size_set(apr_bucket_alloc_t *list,
+                                    apr_size_t size);
+
+/* The number of bytes to read for the given read size state. */
+apr_size_t apr__bucket_read_size(apr_bucket_alloc_t *list, apr_off_t state);
+
+/* The read size state following a read of len bytes out of size: the
+ * size doubles when the read filled the buffer, and halves back when
+ * it returned less than half of it.
+ */
+apr_off_t apr__bucket_read_size_next(apr_off_t state, apr_size_t size,
+                                     apr_size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !APR_BUCKETS_INTERNAL_H */
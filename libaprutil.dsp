@@ -179,6 +179,22 @@ SOURCE=.\buckets\apr_brigade.c
 # End Source File
 # Begin Source File
 
+SOURCE=.\buckets\apr_brigade_array.c
+# End Source File
+# Begin Source File
+
+SOURCE=.\buckets\apr_brigade_codec.c
+# End Source File
+# Begin Source File
+
+SOURCE=.\buckets\apr_brigade_cursor.c
+# End Source File
+# Begin Source File
+
+SOURCE=.\buckets\apr_brigade_digest.c
+# End Source File
+# Begin Source File
+
 SOURCE=.\buckets\apr_buckets.c
 # End Source File
 # Begin Source File
@@ -187,6 +203,10 @@ SOURCE=.\buckets\apr_buckets_alloc.c
 # End Source File
 # Begin Source File
 
+SOURCE=.\buckets\apr_buckets_atomic.c
+# End Source File
+# Begin Source File
+
 SOURCE=.\buckets\apr_buckets_eos.c
 # End Source File
 # Begin Source File
@@ -225,6 +245,10 @@ SOURCE=.\buckets\apr_buckets_simple.c
 
 SOURCE=.\buckets\apr_buckets_socket.c
 # End Source File
+# Begin Source File
+
+SOURCE=.\buckets\apr_buckets_splice.c
+# End Source File
 # End Group
 # Begin Group "crypto"
 
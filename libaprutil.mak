@@ -59,8 +59,13 @@ CLEAN :
 !ENDIF 
 	-@erase "$(INTDIR)\apr_base64.obj"
 	-@erase "$(INTDIR)\apr_brigade.obj"
+	-@erase "$(INTDIR)\apr_brigade_array.obj"
+	-@erase "$(INTDIR)\apr_brigade_codec.obj"
+	-@erase "$(INTDIR)\apr_brigade_cursor.obj"
+	-@erase "$(INTDIR)\apr_brigade_digest.obj"
 	-@erase "$(INTDIR)\apr_buckets.obj"
 	-@erase "$(INTDIR)\apr_buckets_alloc.obj"
+	-@erase "$(INTDIR)\apr_buckets_atomic.obj"
 	-@erase "$(INTDIR)\apr_buckets_eos.obj"
 	-@erase "$(INTDIR)\apr_buckets_file.obj"
 	-@erase "$(INTDIR)\apr_buckets_flush.obj"
@@ -71,6 +76,7 @@ CLEAN :
 	-@erase "$(INTDIR)\apr_buckets_refcount.obj"
 	-@erase "$(INTDIR)\apr_buckets_simple.obj"
 	-@erase "$(INTDIR)\apr_buckets_socket.obj"
+	-@erase "$(INTDIR)\apr_buckets_splice.obj"
 	-@erase "$(INTDIR)\apr_crypto.obj"
 	-@erase "$(INTDIR)\apr_date.obj"
 	-@erase "$(INTDIR)\apr_dbd.obj"
@@ -160,8 +166,13 @@ LINK32=link.exe
 LINK32_FLAGS=$(XML_PARSER).lib kernel32.lib advapi32.lib ws2_32.lib mswsock.lib ole32.lib /nologo /base:"0x6EE60000" /subsystem:windows /dll /incremental:no /pdb:"$(OUTDIR)\libaprutil-1.pdb" /debug /out:"$(OUTDIR)\libaprutil-1.dll" /implib:"$(OUTDIR)\libaprutil-1.lib"  /opt:ref 
 LINK32_OBJS= \
 	"$(INTDIR)\apr_brigade.obj" \
+	"$(INTDIR)\apr_brigade_array.obj" \
+	"$(INTDIR)\apr_brigade_codec.obj" \
+	"$(INTDIR)\apr_brigade_cursor.obj" \
+	"$(INTDIR)\apr_brigade_digest.obj" \
 	"$(INTDIR)\apr_buckets.obj" \
 	"$(INTDIR)\apr_buckets_alloc.obj" \
+	"$(INTDIR)\apr_buckets_atomic.obj" \
 	"$(INTDIR)\apr_buckets_eos.obj" \
 	"$(INTDIR)\apr_buckets_file.obj" \
 	"$(INTDIR)\apr_buckets_flush.obj" \
@@ -172,6 +183,7 @@ LINK32_OBJS= \
 	"$(INTDIR)\apr_buckets_refcount.obj" \
 	"$(INTDIR)\apr_buckets_simple.obj" \
 	"$(INTDIR)\apr_buckets_socket.obj" \
+	"$(INTDIR)\apr_buckets_splice.obj" \
 	"$(INTDIR)\apr_crypto.obj" \
 	"$(INTDIR)\apr_md4.obj" \
 	"$(INTDIR)\apr_md5.obj" \
@@ -253,8 +265,13 @@ CLEAN :
 !ENDIF 
 	-@erase "$(INTDIR)\apr_base64.obj"
 	-@erase "$(INTDIR)\apr_brigade.obj"
+	-@erase "$(INTDIR)\apr_brigade_array.obj"
+	-@erase "$(INTDIR)\apr_brigade_codec.obj"
+	-@erase "$(INTDIR)\apr_brigade_cursor.obj"
+	-@erase "$(INTDIR)\apr_brigade_digest.obj"
 	-@erase "$(INTDIR)\apr_buckets.obj"
 	-@erase "$(INTDIR)\apr_buckets_alloc.obj"
+	-@erase "$(INTDIR)\apr_buckets_atomic.obj"
 	-@erase "$(INTDIR)\apr_buckets_eos.obj"
 	-@erase "$(INTDIR)\apr_buckets_file.obj"
 	-@erase "$(INTDIR)\apr_buckets_flush.obj"
@@ -265,6 +282,7 @@ CLEAN :
 	-@erase "$(INTDIR)\apr_buckets_refcount.obj"
 	-@erase "$(INTDIR)\apr_buckets_simple.obj"
 	-@erase "$(INTDIR)\apr_buckets_socket.obj"
+	-@erase "$(INTDIR)\apr_buckets_splice.obj"
 	-@erase "$(INTDIR)\apr_crypto.obj"
 	-@erase "$(INTDIR)\apr_date.obj"
 	-@erase "$(INTDIR)\apr_dbd.obj"
@@ -358,8 +376,13 @@ LINK32=link.exe
 LINK32_FLAGS=$(XML_PARSER).lib kernel32.lib advapi32.lib ws2_32.lib mswsock.lib ole32.lib /nologo /base:"0x6EE60000" /subsystem:windows /dll /incremental:no /pdb:"$(OUTDIR)\libaprutil-1.pdb" /debug /out:"$(OUTDIR)\libaprutil-1.dll" /implib:"$(OUTDIR)\libaprutil-1.lib"  
 LINK32_OBJS= \
 	"$(INTDIR)\apr_brigade.obj" \
+	"$(INTDIR)\apr_brigade_array.obj" \
+	"$(INTDIR)\apr_brigade_codec.obj" \
+	"$(INTDIR)\apr_brigade_cursor.obj" \
+	"$(INTDIR)\apr_brigade_digest.obj" \
 	"$(INTDIR)\apr_buckets.obj" \
 	"$(INTDIR)\apr_buckets_alloc.obj" \
+	"$(INTDIR)\apr_buckets_atomic.obj" \
 	"$(INTDIR)\apr_buckets_eos.obj" \
 	"$(INTDIR)\apr_buckets_file.obj" \
 	"$(INTDIR)\apr_buckets_flush.obj" \
@@ -370,6 +393,7 @@ LINK32_OBJS= \
 	"$(INTDIR)\apr_buckets_refcount.obj" \
 	"$(INTDIR)\apr_buckets_simple.obj" \
 	"$(INTDIR)\apr_buckets_socket.obj" \
+	"$(INTDIR)\apr_buckets_splice.obj" \
 	"$(INTDIR)\apr_crypto.obj" \
 	"$(INTDIR)\apr_md4.obj" \
 	"$(INTDIR)\apr_md5.obj" \
@@ -451,8 +475,13 @@ CLEAN :
 !ENDIF 
 	-@erase "$(INTDIR)\apr_base64.obj"
 	-@erase "$(INTDIR)\apr_brigade.obj"
+	-@erase "$(INTDIR)\apr_brigade_array.obj"
+	-@erase "$(INTDIR)\apr_brigade_codec.obj"
+	-@erase "$(INTDIR)\apr_brigade_cursor.obj"
+	-@erase "$(INTDIR)\apr_brigade_digest.obj"
 	-@erase "$(INTDIR)\apr_buckets.obj"
 	-@erase "$(INTDIR)\apr_buckets_alloc.obj"
+	-@erase "$(INTDIR)\apr_buckets_atomic.obj"
 	-@erase "$(INTDIR)\apr_buckets_eos.obj"
 	-@erase "$(INTDIR)\apr_buckets_file.obj"
 	-@erase "$(INTDIR)\apr_buckets_flush.obj"
@@ -463,6 +492,7 @@ CLEAN :
 	-@erase "$(INTDIR)\apr_buckets_refcount.obj"
 	-@erase "$(INTDIR)\apr_buckets_simple.obj"
 	-@erase "$(INTDIR)\apr_buckets_socket.obj"
+	-@erase "$(INTDIR)\apr_buckets_splice.obj"
 	-@erase "$(INTDIR)\apr_crypto.obj"
 	-@erase "$(INTDIR)\apr_date.obj"
 	-@erase "$(INTDIR)\apr_dbd.obj"
@@ -556,8 +586,13 @@ LINK32=link.exe
 LINK32_FLAGS=$(XML_PARSER).lib kernel32.lib advapi32.lib ws2_32.lib mswsock.lib ole32.lib /nologo /base:"0x6EE60000" /subsystem:windows /dll /incremental:no /pdb:"$(OUTDIR)\libaprutil-1.pdb" /debug /out:"$(OUTDIR)\libaprutil-1.dll" /implib:"$(OUTDIR)\libaprutil-1.lib"  /opt:ref 
 LINK32_OBJS= \
 	"$(INTDIR)\apr_brigade.obj" \
+	"$(INTDIR)\apr_brigade_array.obj" \
+	"$(INTDIR)\apr_brigade_codec.obj" \
+	"$(INTDIR)\apr_brigade_cursor.obj" \
+	"$(INTDIR)\apr_brigade_digest.obj" \
 	"$(INTDIR)\apr_buckets.obj" \
 	"$(INTDIR)\apr_buckets_alloc.obj" \
+	"$(INTDIR)\apr_buckets_atomic.obj" \
 	"$(INTDIR)\apr_buckets_eos.obj" \
 	"$(INTDIR)\apr_buckets_file.obj" \
 	"$(INTDIR)\apr_buckets_flush.obj" \
@@ -568,6 +603,7 @@ LINK32_OBJS= \
 	"$(INTDIR)\apr_buckets_refcount.obj" \
 	"$(INTDIR)\apr_buckets_simple.obj" \
 	"$(INTDIR)\apr_buckets_socket.obj" \
+	"$(INTDIR)\apr_buckets_splice.obj" \
 	"$(INTDIR)\apr_crypto.obj" \
 	"$(INTDIR)\apr_md4.obj" \
 	"$(INTDIR)\apr_md5.obj" \
@@ -649,8 +685,13 @@ CLEAN :
 !ENDIF 
 	-@erase "$(INTDIR)\apr_base64.obj"
 	-@erase "$(INTDIR)\apr_brigade.obj"
+	-@erase "$(INTDIR)\apr_brigade_array.obj"
+	-@erase "$(INTDIR)\apr_brigade_codec.obj"
+	-@erase "$(INTDIR)\apr_brigade_cursor.obj"
+	-@erase "$(INTDIR)\apr_brigade_digest.obj"
 	-@erase "$(INTDIR)\apr_buckets.obj"
 	-@erase "$(INTDIR)\apr_buckets_alloc.obj"
+	-@erase "$(INTDIR)\apr_buckets_atomic.obj"
 	-@erase "$(INTDIR)\apr_buckets_eos.obj"
 	-@erase "$(INTDIR)\apr_buckets_file.obj"
 	-@erase "$(INTDIR)\apr_buckets_flush.obj"
@@ -661,6 +702,7 @@ CLEAN :
 	-@erase "$(INTDIR)\apr_buckets_refcount.obj"
 	-@erase "$(INTDIR)\apr_buckets_simple.obj"
 	-@erase "$(INTDIR)\apr_buckets_socket.obj"
+	-@erase "$(INTDIR)\apr_buckets_splice.obj"
 	-@erase "$(INTDIR)\apr_crypto.obj"
 	-@erase "$(INTDIR)\apr_date.obj"
 	-@erase "$(INTDIR)\apr_dbd.obj"
@@ -754,8 +796,13 @@ LINK32=link.exe
 LINK32_FLAGS=$(XML_PARSER).lib kernel32.lib advapi32.lib ws2_32.lib mswsock.lib ole32.lib /nologo /base:"0x6EE60000" /subsystem:windows /dll /incremental:no /pdb:"$(OUTDIR)\libaprutil-1.pdb" /debug /out:"$(OUTDIR)\libaprutil-1.dll" /implib:"$(OUTDIR)\libaprutil-1.lib"  
 LINK32_OBJS= \
 	"$(INTDIR)\apr_brigade.obj" \
+	"$(INTDIR)\apr_brigade_array.obj" \
+	"$(INTDIR)\apr_brigade_codec.obj" \
+	"$(INTDIR)\apr_brigade_cursor.obj" \
+	"$(INTDIR)\apr_brigade_digest.obj" \
 	"$(INTDIR)\apr_buckets.obj" \
 	"$(INTDIR)\apr_buckets_alloc.obj" \
+	"$(INTDIR)\apr_buckets_atomic.obj" \
 	"$(INTDIR)\apr_buckets_eos.obj" \
 	"$(INTDIR)\apr_buckets_file.obj" \
 	"$(INTDIR)\apr_buckets_flush.obj" \
@@ -766,6 +813,7 @@ LINK32_OBJS= \
 	"$(INTDIR)\apr_buckets_refcount.obj" \
 	"$(INTDIR)\apr_buckets_simple.obj" \
 	"$(INTDIR)\apr_buckets_socket.obj" \
+	"$(INTDIR)\apr_buckets_splice.obj" \
 	"$(INTDIR)\apr_crypto.obj" \
 	"$(INTDIR)\apr_md4.obj" \
 	"$(INTDIR)\apr_md5.obj" \
@@ -840,6 +888,30 @@ SOURCE=.\buckets\apr_brigade.c
 	$(CPP) $(CPP_PROJ) $(SOURCE)
 
 
+SOURCE=.\buckets\apr_brigade_array.c
+
+"$(INTDIR)\apr_brigade_array.obj" : $(SOURCE) "$(INTDIR)" ".\include\apu.h"
+	$(CPP) $(CPP_PROJ) $(SOURCE)
+
+
+SOURCE=.\buckets\apr_brigade_codec.c
+
+"$(INTDIR)\apr_brigade_codec.obj" : $(SOURCE) "$(INTDIR)" ".\include\apu.h"
+	$(CPP) $(CPP_PROJ) $(SOURCE)
+
+
+SOURCE=.\buckets\apr_brigade_cursor.c
+
+"$(INTDIR)\apr_brigade_cursor.obj" : $(SOURCE) "$(INTDIR)" ".\include\apu.h"
+	$(CPP) $(CPP_PROJ) $(SOURCE)
+
+
+SOURCE=.\buckets\apr_brigade_digest.c
+
+"$(INTDIR)\apr_brigade_digest.obj" : $(SOURCE) "$(INTDIR)" ".\include\apu.h"
+	$(CPP) $(CPP_PROJ) $(SOURCE)
+
+
 SOURCE=.\buckets\apr_buckets.c
 
 "$(INTDIR)\apr_buckets.obj" : $(SOURCE) "$(INTDIR)" ".\include\apu.h"
@@ -852,6 +924,12 @@ SOURCE=.\buckets\apr_buckets_alloc.c
 	$(CPP) $(CPP_PROJ) $(SOURCE)
 
 
+SOURCE=.\buckets\apr_buckets_atomic.c
+
+"$(INTDIR)\apr_buckets_atomic.obj" : $(SOURCE) "$(INTDIR)" ".\include\apu.h"
+	$(CPP) $(CPP_PROJ) $(SOURCE)
+
+
 SOURCE=.\buckets\apr_buckets_eos.c
 
 "$(INTDIR)\apr_buckets_eos.obj" : $(SOURCE) "$(INTDIR)" ".\include\apu.h"
@@ -912,6 +990,12 @@ SOURCE=.\buckets\apr_buckets_socket.c
 	$(CPP) $(CPP_PROJ) $(SOURCE)
 
 
+SOURCE=.\buckets\apr_buckets_splice.c
+
+"$(INTDIR)\apr_buckets_splice.obj" : $(SOURCE) "$(INTDIR)" ".\include\private\apu_config.h" ".\include\apu.h"
+	$(CPP) $(CPP_PROJ) $(SOURCE)
+
+
 SOURCE=.\crypto\apr_crypto.c
 
 "$(INTDIR)\apr_crypto.obj" : $(SOURCE) "$(INTDIR)" ".\include\private\apu_config.h" ".\include\apu.h"
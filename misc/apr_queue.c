@@ -31,6 +31,7 @@
 #include "apr_thread_mutex.h"
 #include "apr_thread_cond.h"
 #include "apr_errno.h"
+#include "apr_atomic.h"
 #include "apr_queue.h"
 
 #if APR_HAS_THREADS
@@ -40,18 +41,42 @@
 #define QUEUE_DEBUG
  */
 
+/* keeps the lock-free producer and consumer positions apart */
+#define QUEUE_CACHE_LINE 64
+
+/**
+ * A cell of the lock-free ring. The sequence number tells whether the
+ * cell is free for the producer at position seq, or holds the element
+ * of the consumer at position seq - 1.
+ */
+typedef struct queue_cell_t {
+    volatile apr_uint32_t seq;
+    void                 *data;
+} queue_cell_t;
+
 struct apr_queue_t {
     void              **data;
     unsigned int        nelts; /**< # elements */
     unsigned int        in;    /**< next empty location */
     unsigned int        out;   /**< next filled location */
     unsigned int        bounds;/**< max size of queue */
-    unsigned int        full_waiters;
-    unsigned int        empty_waiters;
+    volatile apr_uint32_t full_waiters;
+    volatile apr_uint32_t empty_waiters;
     apr_thread_mutex_t *one_big_mutex;
     apr_thread_cond_t  *not_empty;
     apr_thread_cond_t  *not_full;
     int                 terminated;
+    apr_uint32_t        flags;
+    unsigned int        interrupts; /**< # of apr_queue_interrupt_all() */
+    queue_cell_t       *cells; /**< lock-free ring, bounds cells */
+    apr_uint32_t        mask;  /**< bounds - 1 */
+    char                pad_in[QUEUE_CACHE_LINE];
+    volatile apr_uint32_t enq_pos; /**< next lock-free push position */
+    apr_uint32_t        deq_cache; /**< SPSC pusher's copy of deq_pos */
+    char                pad_out[QUEUE_CACHE_LINE];
+    volatile apr_uint32_t deq_pos; /**< next lock-free pop position */
+    apr_uint32_t        enq_cache; /**< SPSC popper's copy of enq_pos */
+    char                pad_end[QUEUE_CACHE_LINE];
 };
 
 #ifdef QUEUE_DEBUG
@@ -78,6 +103,13 @@ static void Q_DBG(char*msg, apr_queue_t *q) {
  */
 #define apr_queue_empty(queue) ((queue)->nelts == 0)
 
+/**
+ * Detects when the apr_queue_t is backed by a ring rather than by the
+ * mutex protected array.
+ */
+#define apr_queue_ring(queue) \
+    ((queue)->flags & (APR_QUEUE_LOCKFREE | APR_QUEUE_SPSC))
+
 /**
  * Callback routine that is called to destroy this
  * apr_queue_t when its pool is destroyed.
@@ -101,10 +133,32 @@ static apr_status_t queue_destroy(void *data)
 APU_DECLARE(apr_status_t) apr_queue_create(apr_queue_t **q, 
                                            unsigned int queue_capacity, 
                                            apr_pool_t *a)
+{
+    return apr_queue_create_ex(q, queue_capacity, 0, a);
+}
+
+APU_DECLARE(apr_status_t) apr_queue_create_ex(apr_queue_t **q,
+                                              unsigned int queue_capacity,
+                                              apr_uint32_t flags,
+                                              apr_pool_t *a)
 {
     apr_status_t rv;
     apr_queue_t *queue;
-    queue = apr_palloc(a, sizeof(apr_queue_t));
+
+    if (flags & (APR_QUEUE_LOCKFREE | APR_QUEUE_SPSC)) {
+        unsigned int size = 2;
+
+        if (queue_capacity == 0 || queue_capacity > 0x40000000U) {
+            return APR_EINVAL;
+        }
+        /* the ring needs two cells at least to tell full from empty */
+        while (size < queue_capacity) {
+            size <<= 1;
+        }
+        queue_capacity = size;
+    }
+
+    queue = apr_pcalloc(a, sizeof(apr_queue_t));
     *q = queue;
 
     /* nested doesn't work ;( */
@@ -125,9 +179,31 @@ APU_DECLARE(apr_status_t) apr_queue_create(apr_queue_t **q,
         return rv;
     }
 
-    /* Set all the data in the queue to NULL */
-    queue->data = apr_pcalloc(a, queue_capacity * sizeof(void*));
+    if (flags & APR_QUEUE_SPSC) {
+        queue->data = apr_pcalloc(a, queue_capacity * sizeof(void*));
+        queue->mask = queue_capacity - 1;
+        queue->enq_pos = queue->deq_cache = 0;
+        queue->deq_pos = queue->enq_cache = 0;
+    }
+    else if (flags & APR_QUEUE_LOCKFREE) {
+        unsigned int i;
+
+        queue->cells = apr_palloc(a, queue_capacity * sizeof(queue_cell_t));
+        for (i = 0; i < queue_capacity; i++) {
+            queue->cells[i].seq = i;
+            queue->cells[i].data = NULL;
+        }
+        queue->mask = queue_capacity - 1;
+        queue->enq_pos = 0;
+        queue->deq_pos = 0;
+    }
+    else {
+        /* Set all the data in the queue to NULL */
+        queue->data = apr_pcalloc(a, queue_capacity * sizeof(void*));
+    }
     queue->bounds = queue_capacity;
+    queue->flags = flags;
+    queue->interrupts = 0;
     queue->nelts = 0;
     queue->in = 0;
     queue->out = 0;
@@ -140,6 +216,291 @@ APU_DECLARE(apr_status_t) apr_queue_create(apr_queue_t **q,
     return APR_SUCCESS;
 }
 
+/**
+ * Reads the position published by the other side of a single producer,
+ * single consumer ring. apr_atomic_read32() is a plain load with some
+ * implementations of the atomics, while a compare and swap is a full
+ * barrier with all of them, so the loads of the cells can't be ordered
+ * before it (nor the stores of the producer after it).
+ */
+static APR_INLINE apr_uint32_t spsc_read_pos(volatile apr_uint32_t *pos)
+{
+    return apr_atomic_cas32(pos, 0, 0);
+}
+
+/**
+ * Single pusher ring: stores data at the push position, or returns
+ * APR_EAGAIN when the ring is full. Only the pusher writes enq_pos and
+ * reads deq_pos again when its cached copy says the ring is full.
+ */
+static apr_status_t spsc_enqueue(apr_queue_t *queue, void *data)
+{
+    apr_uint32_t pos = queue->enq_pos;
+
+    if (pos - queue->deq_cache > queue->mask) {
+        queue->deq_cache = spsc_read_pos(&queue->deq_pos);
+        if (pos - queue->deq_cache > queue->mask) {
+            return APR_EAGAIN;
+        }
+    }
+
+    queue->data[pos & queue->mask] = data;
+    /* publish, the exchange orders the store of the data before it */
+    apr_atomic_xchg32(&queue->enq_pos, pos + 1);
+
+    return APR_SUCCESS;
+}
+
+/**
+ * Single popper ring: takes the data at the pop position, or returns
+ * APR_EAGAIN when the ring is empty.
+ */
+static apr_status_t spsc_dequeue(apr_queue_t *queue, void **data)
+{
+    apr_uint32_t pos = queue->deq_pos;
+
+    if (pos == queue->enq_cache) {
+        queue->enq_cache = spsc_read_pos(&queue->enq_pos);
+        if (pos == queue->enq_cache) {
+            return APR_EAGAIN;
+        }
+    }
+
+    *data = queue->data[pos & queue->mask];
+    apr_atomic_xchg32(&queue->deq_pos, pos + 1);
+
+    return APR_SUCCESS;
+}
+
+/**
+ * Claims the cell at the push position and stores data in it, or
+ * returns APR_EAGAIN when the ring is full. Never blocks.
+ */
+static apr_status_t lf_enqueue(apr_queue_t *queue, void *data)
+{
+    queue_cell_t *cell;
+    apr_uint32_t pos;
+
+    if (queue->flags & APR_QUEUE_SPSC) {
+        return spsc_enqueue(queue, data);
+    }
+
+    pos = apr_atomic_read32(&queue->enq_pos);
+
+    for (;;) {
+        apr_int32_t dif;
+
+        cell = &queue->cells[pos & queue->mask];
+        dif = (apr_int32_t)(apr_atomic_read32(&cell->seq) - pos);
+        if (dif == 0) {
+            apr_uint32_t old = apr_atomic_cas32(&queue->enq_pos, pos + 1, pos);
+            if (old == pos) {
+                break;
+            }
+            pos = old;
+        }
+        else if (dif < 0) {
+            return APR_EAGAIN;
+        }
+        else {
+            /* another producer took this cell, catch up */
+            pos = apr_atomic_read32(&queue->enq_pos);
+        }
+    }
+
+    cell->data = data;
+    /* publish, the exchange orders the store of the data before it */
+    apr_atomic_xchg32(&cell->seq, pos + 1);
+
+    return APR_SUCCESS;
+}
+
+/**
+ * Claims the cell at the pop position and takes its data, or returns
+ * APR_EAGAIN when the ring is empty. Never blocks.
+ */
+static apr_status_t lf_dequeue(apr_queue_t *queue, void **data)
+{
+    queue_cell_t *cell;
+    apr_uint32_t pos;
+
+    if (queue->flags & APR_QUEUE_SPSC) {
+        return spsc_dequeue(queue, data);
+    }
+
+    pos = apr_atomic_read32(&queue->deq_pos);
+
+    for (;;) {
+        apr_int32_t dif;
+
+        cell = &queue->cells[pos & queue->mask];
+        dif = (apr_int32_t)(apr_atomic_read32(&cell->seq) - (pos + 1));
+        if (dif == 0) {
+            apr_uint32_t old = apr_atomic_cas32(&queue->deq_pos, pos + 1, pos);
+            if (old == pos) {
+                break;
+            }
+            pos = old;
+        }
+        else if (dif < 0) {
+            return APR_EAGAIN;
+        }
+        else {
+            pos = apr_atomic_read32(&queue->deq_pos);
+        }
+    }
+
+    *data = cell->data;
+    /* hand the cell over to the producer one lap ahead */
+    apr_atomic_xchg32(&cell->seq, pos + queue->mask + 1);
+
+    return APR_SUCCESS;
+}
+
+/**
+ * Wakes up one thread waiting on cond, or all of them if all is set
+ * since several elements were moved. The mutex is only taken
+ * when the waiters count says someone is (about to get) blocked: that
+ * count is raised under the mutex before the waiter checks the ring a
+ * last time, so either it sees our change or we see it waiting.
+ */
+static apr_status_t lf_wake(apr_queue_t *queue,
+                            volatile apr_uint32_t *waiters,
+                            apr_thread_cond_t *cond, int all)
+{
+    apr_status_t rv;
+
+    if (!apr_atomic_read32(waiters)) {
+        return APR_SUCCESS;
+    }
+
+    rv = apr_thread_mutex_lock(queue->one_big_mutex);
+    if (rv != APR_SUCCESS) {
+        return rv;
+    }
+    Q_DBG("lf signal", queue);
+    if (all) {
+        rv = apr_thread_cond_broadcast(cond);
+    }
+    else {
+        rv = apr_thread_cond_signal(cond);
+    }
+    if (rv != APR_SUCCESS) {
+        apr_thread_mutex_unlock(queue->one_big_mutex);
+        return rv;
+    }
+
+    return apr_thread_mutex_unlock(queue->one_big_mutex);
+}
+
+/**
+ * Push onto the lock-free ring, waiting on not_full only while the
+ * ring is actually full. Does not wake up the other side.
+ */
+static apr_status_t lf_push_wait(apr_queue_t *queue, void *data)
+{
+    apr_status_t rv;
+
+    rv = lf_enqueue(queue, data);
+    if (rv == APR_EAGAIN) {
+        unsigned int interrupts;
+
+        rv = apr_thread_mutex_lock(queue->one_big_mutex);
+        if (rv != APR_SUCCESS) {
+            return rv;
+        }
+
+        interrupts = queue->interrupts;
+        apr_atomic_inc32(&queue->full_waiters);
+        while ((rv = lf_enqueue(queue, data)) == APR_EAGAIN) {
+            if (queue->terminated) {
+                rv = APR_EOF; /* no more elements ever again */
+                break;
+            }
+            if (queue->interrupts != interrupts) {
+                Q_DBG("queue full (intr)", queue);
+                rv = APR_EINTR;
+                break;
+            }
+            rv = apr_thread_cond_wait(queue->not_full, queue->one_big_mutex);
+            if (rv != APR_SUCCESS) {
+                break;
+            }
+        }
+        apr_atomic_dec32(&queue->full_waiters);
+
+        apr_thread_mutex_unlock(queue->one_big_mutex);
+    }
+
+    return rv;
+}
+
+static apr_status_t lf_push(apr_queue_t *queue, void *data)
+{
+    apr_status_t rv;
+
+    rv = lf_push_wait(queue, data);
+    if (rv != APR_SUCCESS) {
+        return rv;
+    }
+
+    return lf_wake(queue, &queue->empty_waiters, queue->not_empty, 0);
+}
+
+/**
+ * Pop from the lock-free ring, waiting on not_empty only while the
+ * ring is actually empty. Does not wake up the other side.
+ */
+static apr_status_t lf_pop_wait(apr_queue_t *queue, void **data)
+{
+    apr_status_t rv;
+
+    rv = lf_dequeue(queue, data);
+    if (rv == APR_EAGAIN) {
+        unsigned int interrupts;
+
+        rv = apr_thread_mutex_lock(queue->one_big_mutex);
+        if (rv != APR_SUCCESS) {
+            return rv;
+        }
+
+        interrupts = queue->interrupts;
+        apr_atomic_inc32(&queue->empty_waiters);
+        while ((rv = lf_dequeue(queue, data)) == APR_EAGAIN) {
+            if (queue->terminated) {
+                rv = APR_EOF; /* no more elements ever again */
+                break;
+            }
+            if (queue->interrupts != interrupts) {
+                Q_DBG("queue empty (intr)", queue);
+                rv = APR_EINTR;
+                break;
+            }
+            rv = apr_thread_cond_wait(queue->not_empty, queue->one_big_mutex);
+            if (rv != APR_SUCCESS) {
+                break;
+            }
+        }
+        apr_atomic_dec32(&queue->empty_waiters);
+
+        apr_thread_mutex_unlock(queue->one_big_mutex);
+    }
+
+    return rv;
+}
+
+static apr_status_t lf_pop(apr_queue_t *queue, void **data)
+{
+    apr_status_t rv;
+
+    rv = lf_pop_wait(queue, data);
+    if (rv != APR_SUCCESS) {
+        return rv;
+    }
+
+    return lf_wake(queue, &queue->full_waiters, queue->not_full, 0);
+}
+
 /**
  * Push new data onto the queue. Blocks if the queue is full. Once
  * the push operation has completed, it signals other threads waiting
@@ -153,6 +514,10 @@ APU_DECLARE(apr_status_t) apr_queue_push(apr_queue_t *queue, void *data)
         return APR_EOF; /* no more elements ever again */
     }
 
+    if (apr_queue_ring(queue)) {
+        return lf_push(queue, data);
+    }
+
     rv = apr_thread_mutex_lock(queue->one_big_mutex);
     if (rv != APR_SUCCESS) {
         return rv;
@@ -216,6 +581,14 @@ APU_DECLARE(apr_status_t) apr_queue_trypush(apr_queue_t *queue, void *data)
         return APR_EOF; /* no more elements ever again */
     }
 
+    if (apr_queue_ring(queue)) {
+        rv = lf_enqueue(queue, data);
+        if (rv != APR_SUCCESS) {
+            return rv;
+        }
+        return lf_wake(queue, &queue->empty_waiters, queue->not_empty, 0);
+    }
+
     rv = apr_thread_mutex_lock(queue->one_big_mutex);
     if (rv != APR_SUCCESS) {
         return rv;
@@ -249,6 +622,20 @@ APU_DECLARE(apr_status_t) apr_queue_trypush(apr_queue_t *queue, void *data)
  * not thread safe
  */
 APU_DECLARE(unsigned int) apr_queue_size(apr_queue_t *queue) {
+    if (apr_queue_ring(queue)) {
+        apr_uint32_t out = apr_atomic_read32(&queue->deq_pos);
+        apr_uint32_t in = apr_atomic_read32(&queue->enq_pos);
+        apr_int32_t nelts = (apr_int32_t)(in - out);
+
+        /* the positions are read apart, so clamp the estimate */
+        if (nelts < 0) {
+            return 0;
+        }
+        if ((unsigned int)nelts > queue->bounds) {
+            return queue->bounds;
+        }
+        return nelts;
+    }
     return queue->nelts;
 }
 
@@ -266,6 +653,10 @@ APU_DECLARE(apr_status_t) apr_queue_pop(apr_queue_t *queue, void **data)
         return APR_EOF; /* no more elements ever again */
     }
 
+    if (apr_queue_ring(queue)) {
+        return lf_pop(queue, data);
+    }
+
     rv = apr_thread_mutex_lock(queue->one_big_mutex);
     if (rv != APR_SUCCESS) {
         return rv;
@@ -330,6 +721,14 @@ APU_DECLARE(apr_status_t) apr_queue_trypop(apr_queue_t *queue, void **data)
         return APR_EOF; /* no more elements ever again */
     }
 
+    if (apr_queue_ring(queue)) {
+        rv = lf_dequeue(queue, data);
+        if (rv != APR_SUCCESS) {
+            return rv;
+        }
+        return lf_wake(queue, &queue->full_waiters, queue->not_full, 0);
+    }
+
     rv = apr_thread_mutex_lock(queue->one_big_mutex);
     if (rv != APR_SUCCESS) {
         return rv;
@@ -359,6 +758,280 @@ APU_DECLARE(apr_status_t) apr_queue_trypop(apr_queue_t *queue, void **data)
     return rv;
 }
 
+/**
+ * Push as many of the nelts elements as fit onto the lock-free ring,
+ * waiting for the first one only if block is set.
+ */
+static apr_status_t lf_push_batch(apr_queue_t *queue, void **data,
+                                  unsigned int nelts, unsigned int *pushed,
+                                  int block)
+{
+    apr_status_t rv;
+    unsigned int n = 0;
+
+    while (n < nelts && lf_enqueue(queue, data[n]) == APR_SUCCESS) {
+        n++;
+    }
+    if (n == 0) {
+        if (!block) {
+            return APR_EAGAIN;
+        }
+        rv = lf_push_wait(queue, data[0]);
+        if (rv != APR_SUCCESS) {
+            return rv;
+        }
+        n = 1;
+        while (n < nelts && lf_enqueue(queue, data[n]) == APR_SUCCESS) {
+            n++;
+        }
+    }
+    *pushed = n;
+
+    return lf_wake(queue, &queue->empty_waiters, queue->not_empty, n > 1);
+}
+
+/**
+ * Pop up to nelts elements from the lock-free ring, waiting for the
+ * first one only if block is set.
+ */
+static apr_status_t lf_pop_batch(apr_queue_t *queue, void **data,
+                                 unsigned int nelts, unsigned int *popped,
+                                 int block)
+{
+    apr_status_t rv;
+    unsigned int n = 0;
+
+    while (n < nelts && lf_dequeue(queue, &data[n]) == APR_SUCCESS) {
+        n++;
+    }
+    if (n == 0) {
+        if (!block) {
+            return APR_EAGAIN;
+        }
+        rv = lf_pop_wait(queue, &data[0]);
+        if (rv != APR_SUCCESS) {
+            return rv;
+        }
+        n = 1;
+        while (n < nelts && lf_dequeue(queue, &data[n]) == APR_SUCCESS) {
+            n++;
+        }
+    }
+    *popped = n;
+
+    return lf_wake(queue, &queue->full_waiters, queue->not_full, n > 1);
+}
+
+/**
+ * Push as many of the nelts elements as fit onto the queue under one
+ * lock, waiting while the queue is full only if block is set. Waiting
+ * poppers are signalled once, or broadcast to if more than one element
+ * was pushed.
+ */
+static apr_status_t queue_push_batch(apr_queue_t *queue, void **data,
+                                     unsigned int nelts,
+                                     unsigned int *pushed, int block)
+{
+    apr_status_t rv;
+    unsigned int n;
+
+    *pushed = 0;
+
+    if (queue->terminated) {
+        return APR_EOF; /* no more elements ever again */
+    }
+
+    if (nelts == 0) {
+        return APR_SUCCESS;
+    }
+
+    if (apr_queue_ring(queue)) {
+        return lf_push_batch(queue, data, nelts, pushed, block);
+    }
+
+    rv = apr_thread_mutex_lock(queue->one_big_mutex);
+    if (rv != APR_SUCCESS) {
+        return rv;
+    }
+
+    if (apr_queue_full(queue)) {
+        if (!block) {
+            apr_thread_mutex_unlock(queue->one_big_mutex);
+            return APR_EAGAIN;
+        }
+        if (!queue->terminated) {
+            queue->full_waiters++;
+            rv = apr_thread_cond_wait(queue->not_full, queue->one_big_mutex);
+            queue->full_waiters--;
+            if (rv != APR_SUCCESS) {
+                apr_thread_mutex_unlock(queue->one_big_mutex);
+                return rv;
+            }
+        }
+        /* If we wake up and it's still full, then we were interrupted */
+        if (apr_queue_full(queue)) {
+            Q_DBG("queue full (intr)", queue);
+            rv = apr_thread_mutex_unlock(queue->one_big_mutex);
+            if (rv != APR_SUCCESS) {
+                return rv;
+            }
+            if (queue->terminated) {
+                return APR_EOF; /* no more elements ever again */
+            }
+            else {
+                return APR_EINTR;
+            }
+        }
+    }
+
+    for (n = 0; n < nelts && !apr_queue_full(queue); n++) {
+        queue->data[queue->in] = data[n];
+        queue->in++;
+        if (queue->in >= queue->bounds)
+            queue->in -= queue->bounds;
+        queue->nelts++;
+    }
+    *pushed = n;
+
+    if (queue->empty_waiters) {
+        Q_DBG("sig !empty", queue);
+        if (n > 1) {
+            rv = apr_thread_cond_broadcast(queue->not_empty);
+        }
+        else {
+            rv = apr_thread_cond_signal(queue->not_empty);
+        }
+        if (rv != APR_SUCCESS) {
+            apr_thread_mutex_unlock(queue->one_big_mutex);
+            return rv;
+        }
+    }
+
+    rv = apr_thread_mutex_unlock(queue->one_big_mutex);
+    return rv;
+}
+
+/**
+ * Pop up to nelts elements from the queue under one lock, waiting
+ * while the queue is empty only if block is set. Waiting pushers are
+ * signalled once, or broadcast to if more than one element was popped.
+ */
+static apr_status_t queue_pop_batch(apr_queue_t *queue, void **data,
+                                    unsigned int nelts,
+                                    unsigned int *popped, int block)
+{
+    apr_status_t rv;
+    unsigned int n;
+
+    *popped = 0;
+
+    if (queue->terminated) {
+        return APR_EOF; /* no more elements ever again */
+    }
+
+    if (nelts == 0) {
+        return APR_SUCCESS;
+    }
+
+    if (apr_queue_ring(queue)) {
+        return lf_pop_batch(queue, data, nelts, popped, block);
+    }
+
+    rv = apr_thread_mutex_lock(queue->one_big_mutex);
+    if (rv != APR_SUCCESS) {
+        return rv;
+    }
+
+    if (apr_queue_empty(queue)) {
+        if (!block) {
+            apr_thread_mutex_unlock(queue->one_big_mutex);
+            return APR_EAGAIN;
+        }
+        if (!queue->terminated) {
+            queue->empty_waiters++;
+            rv = apr_thread_cond_wait(queue->not_empty, queue->one_big_mutex);
+            queue->empty_waiters--;
+            if (rv != APR_SUCCESS) {
+                apr_thread_mutex_unlock(queue->one_big_mutex);
+                return rv;
+            }
+        }
+        /* If we wake up and it's still empty, then we were interrupted */
+        if (apr_queue_empty(queue)) {
+            Q_DBG("queue empty (intr)", queue);
+            rv = apr_thread_mutex_unlock(queue->one_big_mutex);
+            if (rv != APR_SUCCESS) {
+                return rv;
+            }
+            if (queue->terminated) {
+                return APR_EOF; /* no more elements ever again */
+            }
+            else {
+                return APR_EINTR;
+            }
+        }
+    }
+
+    for (n = 0; n < nelts && !apr_queue_empty(queue); n++) {
+        data[n] = queue->data[queue->out];
+        queue->nelts--;
+
+        queue->out++;
+        if (queue->out >= queue->bounds)
+            queue->out -= queue->bounds;
+    }
+    *popped = n;
+
+    if (queue->full_waiters) {
+        Q_DBG("signal !full", queue);
+        if (n > 1) {
+            rv = apr_thread_cond_broadcast(queue->not_full);
+        }
+        else {
+            rv = apr_thread_cond_signal(queue->not_full);
+        }
+        if (rv != APR_SUCCESS) {
+            apr_thread_mutex_unlock(queue->one_big_mutex);
+            return rv;
+        }
+    }
+
+    rv = apr_thread_mutex_unlock(queue->one_big_mutex);
+    return rv;
+}
+
+APU_DECLARE(apr_status_t) apr_queue_push_batch(apr_queue_t *queue,
+                                               void **data,
+                                               unsigned int nelts,
+                                               unsigned int *pushed)
+{
+    return queue_push_batch(queue, data, nelts, pushed, 1);
+}
+
+APU_DECLARE(apr_status_t) apr_queue_trypush_batch(apr_queue_t *queue,
+                                                  void **data,
+                                                  unsigned int nelts,
+                                                  unsigned int *pushed)
+{
+    return queue_push_batch(queue, data, nelts, pushed, 0);
+}
+
+APU_DECLARE(apr_status_t) apr_queue_pop_batch(apr_queue_t *queue,
+                                              void **data,
+                                              unsigned int nelts,
+                                              unsigned int *popped)
+{
+    return queue_pop_batch(queue, data, nelts, popped, 1);
+}
+
+APU_DECLARE(apr_status_t) apr_queue_trypop_batch(apr_queue_t *queue,
+                                                 void **data,
+                                                 unsigned int nelts,
+                                                 unsigned int *popped)
+{
+    return queue_pop_batch(queue, data, nelts, popped, 0);
+}
+
 APU_DECLARE(apr_status_t) apr_queue_interrupt_all(apr_queue_t *queue)
 {
     apr_status_t rv;
@@ -366,6 +1039,8 @@ APU_DECLARE(apr_status_t) apr_queue_interrupt_all(apr_queue_t *queue)
     if ((rv = apr_thread_mutex_lock(queue->one_big_mutex)) != APR_SUCCESS) {
         return rv;
     }
+    /* lock-free waiters loop on spurious wakeups, this tells them apart */
+    queue->interrupts++;
     apr_thread_cond_broadcast(queue->not_empty);
     apr_thread_cond_broadcast(queue->not_full);
 
@@ -22,11 +22,28 @@
 #include "apr_thread_cond.h"
 #include "apr_portable.h"
 
+#define APR_WANT_MEMFUNC
+#include "apr_want.h"
+
 #if APR_HAS_THREADS
 
 #define TASK_PRIORITY_SEGS 4
 #define TASK_PRIORITY_SEG(x) (((x)->dispatch.priority & 0xFF) / 64)
 
+/* The scheduled tasks are kept in a 4-ary min heap of their times */
+#define HEAP_ARITY 4
+#define HEAP_INIT_SIZE 16
+#define HEAP_BEFORE(a, b) ((a)->dispatch.time < (b)->dispatch.time \
+                           || ((a)->dispatch.time == (b)->dispatch.time \
+                               && (a)->id < (b)->id))
+
+/* Number of tasks a work stealing thread runs from the deques before
+ * looking for due scheduled tasks.
+ */
+#define WS_POLL_INTERVAL 32
+
+struct apr_thread_pool_deque;
+
 typedef struct apr_thread_pool_task
 {
     APR_RING_ENTRY(apr_thread_pool_task) link;
@@ -38,10 +55,79 @@ typedef struct apr_thread_pool_task
         apr_byte_t priority;
         apr_time_t time;
     } dispatch;
+    struct apr_thread_pool_deque *deque; /* recycled there, if not NULL */
+    apr_uint64_t id;            /* of the scheduled task, for timer handles */
+    apr_size_t heap_idx;        /* position of the scheduled task */
+    apr_thread_pool_handle_t *handle; /* completed when done, if not NULL */
+    apr_size_t deps_pending;    /* handles to complete before it's queued */
+    apr_status_t deps_status;   /* first failure of its dependencies */
 } apr_thread_pool_task_t;
 
 APR_RING_HEAD(apr_thread_pool_tasks, apr_thread_pool_task);
 
+/* An edge from a handle to a task waiting for its completion */
+struct apr_thread_pool_dep
+{
+    APR_RING_ENTRY(apr_thread_pool_dep) link;
+    apr_thread_pool_task_t *task;
+};
+
+APR_RING_HEAD(apr_thread_pool_deps, apr_thread_pool_dep);
+
+/*
+ * A handle is referenced by its task until it completes and by the caller
+ * until released, everything being protected by the pool's lock.
+ */
+struct apr_thread_pool_handle_t
+{
+    APR_RING_ENTRY(apr_thread_pool_handle_t) link;
+    apr_thread_pool_t *tp;
+    struct apr_thread_pool_deps dependents;
+    apr_thread_cond_t *done_cond;   /* created on first wait, kept recycled */
+    void *result;
+    apr_status_t status;
+    int done;
+    int waiters;
+    int refcount;
+};
+
+APR_RING_HEAD(apr_thread_pool_handles, apr_thread_pool_handle_t);
+
+/*
+ * A parallel loop is run by the caller and helper tasks, claiming chunks of
+ * the range until it's exhausted. The chunks shrink with the remaining
+ * iterations (down to the grain), so that uneven iterations end up balanced
+ * between the participants.
+ * The loop is referenced by the caller and by each helper task pushed, and
+ * recycled by the last one, since the helpers not started when the caller
+ * is done may still run later (and return immediately), or be removed by
+ * apr_thread_pool_tasks_cancel(). The caller only waits for the helpers
+ * running, everything being protected by the loop's own lock.
+ */
+struct parallel_loop
+{
+    APR_RING_ENTRY(parallel_loop) link;
+    apr_thread_pool_t *tp;
+    apr_thread_mutex_t *lock;
+    apr_thread_cond_t *done_cond;
+    apr_size_t refcount;
+    int closed;                 /* the caller is done, helpers can't join */
+    apr_size_t running;         /* helpers joined and not returned yet */
+    apr_size_t joined;          /* helpers joined, the index of partials */
+    apr_size_t next;
+    apr_size_t end;
+    apr_size_t grain;
+    apr_size_t participants;    /* the caller and the helpers pushed */
+    apr_thread_pool_range_fn_t fn;
+    apr_thread_pool_reduce_fn_t reduce;
+    void *baton;
+    char *partials;
+    apr_size_t partial_size;
+    apr_status_t rv;
+};
+
+APR_RING_HEAD(apr_thread_pool_loops, parallel_loop);
+
 struct apr_thread_list_elt
 {
     APR_RING_ENTRY(apr_thread_list_elt) link;
@@ -49,6 +135,28 @@ struct apr_thread_list_elt
     void *current_owner;
     enum { TH_RUN, TH_STOP, TH_PROBATION } state;
     int signal_work_done;
+    struct apr_thread_pool_deque *deque;
+    apr_size_t polls;
+};
+
+/*
+ * Work stealing mode: the tasks pushed by a worker thread go to its own
+ * deque, ordered by priority like the pool's tasks. The owner and the
+ * thieves take tasks from the head, under the deque's lock only.
+ * The current_owner of a thread is set under the lock of the deque the
+ * task is taken from (or the pool's lock), and cleared under the lock of
+ * the thread's deque, so that tasks_cancel() holding all the locks sees
+ * every task either queued or running.
+ */
+struct apr_thread_pool_deque
+{
+    apr_thread_mutex_t *lock;
+    struct apr_thread_pool_tasks tasks;
+    struct apr_thread_pool_tasks recycled_tasks;
+    struct apr_thread_list_elt *elt; /* NULL if not used by a thread */
+    volatile apr_size_t task_cnt;
+    volatile apr_size_t tasks_run;
+    apr_size_t index;
 };
 
 APR_RING_HEAD(apr_thread_list, apr_thread_list_elt);
@@ -70,7 +178,9 @@ struct apr_thread_pool
     volatile apr_size_t thd_high;
     volatile apr_size_t thd_timed_out;
     struct apr_thread_pool_tasks *tasks;
-    struct apr_thread_pool_tasks *scheduled_tasks;
+    apr_thread_pool_task_t **scheduled_heap;
+    apr_size_t scheduled_heap_size;
+    apr_uint64_t scheduled_id;
     struct apr_thread_list *busy_thds;
     struct apr_thread_list *idle_thds;
     struct apr_thread_list *dead_thds;
@@ -82,11 +192,46 @@ struct apr_thread_pool
     struct apr_thread_pool_tasks *recycled_tasks;
     struct apr_thread_list *recycled_thds;
     apr_thread_pool_task_t *task_idx[TASK_PRIORITY_SEGS];
+    struct apr_thread_pool_deque *deques;
+    apr_size_t deque_cnt;
+    apr_threadkey_t *deque_key;
+    struct apr_thread_pool_tasks waiting_tasks; /* for their dependencies */
+    struct apr_thread_pool_handles recycled_handles;
+    struct apr_thread_pool_deps recycled_deps;
+    struct apr_thread_pool_loops recycled_loops;
 };
 
+static apr_status_t deques_create(apr_thread_pool_t *me, apr_size_t cnt)
+{
+    apr_status_t rv;
+    apr_size_t i;
+
+    rv = apr_threadkey_private_create(&me->deque_key, NULL, me->pool);
+    if (APR_SUCCESS != rv) {
+        return rv;
+    }
+    me->deques = apr_pcalloc(me->pool, cnt * sizeof(*me->deques));
+    for (i = 0; i < cnt; i++) {
+        struct apr_thread_pool_deque *d = &me->deques[i];
+
+        rv = apr_thread_mutex_create(&d->lock, APR_THREAD_MUTEX_DEFAULT,
+                                     me->pool);
+        if (APR_SUCCESS != rv) {
+            me->deques = NULL;
+            return rv;
+        }
+        APR_RING_INIT(&d->tasks, apr_thread_pool_task, link);
+        APR_RING_INIT(&d->recycled_tasks, apr_thread_pool_task, link);
+        d->index = i;
+    }
+    me->deque_cnt = cnt;
+    return APR_SUCCESS;
+}
+
 static apr_status_t thread_pool_construct(apr_thread_pool_t **tp,
                                           apr_size_t init_threads,
                                           apr_size_t max_threads,
+                                          apr_uint32_t flags,
                                           apr_pool_t *pool)
 {
     apr_status_t rv;
@@ -135,11 +280,6 @@ static apr_status_t thread_pool_construct(apr_thread_pool_t **tp,
         goto CATCH_ENOMEM;
     }
     APR_RING_INIT(me->tasks, apr_thread_pool_task, link);
-    me->scheduled_tasks = apr_palloc(me->pool, sizeof(*me->scheduled_tasks));
-    if (!me->scheduled_tasks) {
-        goto CATCH_ENOMEM;
-    }
-    APR_RING_INIT(me->scheduled_tasks, apr_thread_pool_task, link);
     me->recycled_tasks = apr_palloc(me->pool, sizeof(*me->recycled_tasks));
     if (!me->recycled_tasks) {
         goto CATCH_ENOMEM;
@@ -165,9 +305,24 @@ static apr_status_t thread_pool_construct(apr_thread_pool_t **tp,
         goto CATCH_ENOMEM;
     }
     APR_RING_INIT(me->recycled_thds, apr_thread_list_elt, link);
+    APR_RING_INIT(&me->waiting_tasks, apr_thread_pool_task, link);
+    APR_RING_INIT(&me->recycled_handles, apr_thread_pool_handle_t, link);
+    APR_RING_INIT(&me->recycled_deps, apr_thread_pool_dep, link);
+    APR_RING_INIT(&me->recycled_loops, parallel_loop, link);
+    if (flags & APR_THREAD_POOL_WORK_STEALING) {
+        /* one deque per thread, threads can't outnumber them */
+        if (max_threads < init_threads) {
+            max_threads = init_threads;
+        }
+        rv = deques_create(me, max_threads ? max_threads : 1);
+        if (APR_SUCCESS != rv) {
+            goto CATCH_ERROR;
+        }
+    }
     goto FINAL_EXIT;
   CATCH_ENOMEM:
     rv = APR_ENOMEM;
+  CATCH_ERROR:
     apr_thread_cond_destroy(me->all_done);
     apr_thread_cond_destroy(me->work_done);
     apr_thread_cond_destroy(me->more_work);
@@ -177,24 +332,140 @@ static apr_status_t thread_pool_construct(apr_thread_pool_t **tp,
 }
 
 /*
+ * Move the scheduled task at i up the heap to its place.
+ * NOTE: This function is not thread safe by itself. Caller should hold the lock
+ */
+static void heap_sift_up(apr_thread_pool_t *me, apr_size_t i)
+{
+    apr_thread_pool_task_t **heap = me->scheduled_heap;
+    apr_thread_pool_task_t *t = heap[i];
+
+    while (i > 0) {
+        apr_size_t parent = (i - 1) / HEAP_ARITY;
+
+        if (!HEAP_BEFORE(t, heap[parent])) {
+            break;
+        }
+        heap[i] = heap[parent];
+        heap[i]->heap_idx = i;
+        i = parent;
+    }
+    heap[i] = t;
+    t->heap_idx = i;
+}
+
+/*
+ * Move the scheduled task at i down the heap to its place.
  * NOTE: This function is not thread safe by itself. Caller should hold the lock
  */
-static apr_thread_pool_task_t *pop_task(apr_thread_pool_t * me)
+static void heap_sift_down(apr_thread_pool_t *me, apr_size_t i)
+{
+    apr_thread_pool_task_t **heap = me->scheduled_heap;
+    apr_thread_pool_task_t *t = heap[i];
+    apr_size_t n = me->scheduled_task_cnt;
+
+    for (;;) {
+        apr_size_t child = i * HEAP_ARITY + 1, last, best;
+
+        if (child >= n) {
+            break;
+        }
+        last = child + HEAP_ARITY;
+        if (last > n) {
+            last = n;
+        }
+        for (best = child++; child < last; child++) {
+            if (HEAP_BEFORE(heap[child], heap[best])) {
+                best = child;
+            }
+        }
+        if (!HEAP_BEFORE(heap[best], t)) {
+            break;
+        }
+        heap[i] = heap[best];
+        heap[i]->heap_idx = i;
+        i = best;
+    }
+    heap[i] = t;
+    t->heap_idx = i;
+}
+
+/*
+ * NOTE: This function is not thread safe by itself. Caller should hold the lock
+ */
+static apr_status_t heap_insert(apr_thread_pool_t *me,
+                                apr_thread_pool_task_t *t)
+{
+    if (me->scheduled_task_cnt == me->scheduled_heap_size) {
+        apr_size_t size = me->scheduled_heap_size * 2;
+        apr_thread_pool_task_t **heap;
+
+        if (!size) {
+            size = HEAP_INIT_SIZE;
+        }
+        heap = apr_palloc(me->pool, size * sizeof(*heap));
+        if (!heap) {
+            return APR_ENOMEM;
+        }
+        if (me->scheduled_task_cnt) {
+            memcpy(heap, me->scheduled_heap,
+                   me->scheduled_task_cnt * sizeof(*heap));
+        }
+        me->scheduled_heap = heap;
+        me->scheduled_heap_size = size;
+    }
+
+    me->scheduled_heap[me->scheduled_task_cnt] = t;
+    heap_sift_up(me, me->scheduled_task_cnt++);
+    return APR_SUCCESS;
+}
+
+/*
+ * NOTE: This function is not thread safe by itself. Caller should hold the lock
+ */
+static void heap_remove(apr_thread_pool_t *me, apr_thread_pool_task_t *t)
+{
+    apr_thread_pool_task_t *last;
+    apr_size_t i = t->heap_idx;
+
+    last = me->scheduled_heap[--me->scheduled_task_cnt];
+    if (last != t) {
+        me->scheduled_heap[i] = last;
+        last->heap_idx = i;
+        if (i > 0 && HEAP_BEFORE(last,
+                                 me->scheduled_heap[(i - 1) / HEAP_ARITY])) {
+            heap_sift_up(me, i);
+        }
+        else {
+            heap_sift_down(me, i);
+        }
+    }
+    t->id = 0;
+}
+
+/*
+ * NOTE: This function is not thread safe by itself. Caller should hold the lock
+ */
+static apr_thread_pool_task_t *pop_task(apr_thread_pool_t * me,
+                                        struct apr_thread_pool_deque *d)
 {
     apr_thread_pool_task_t *task = NULL;
     int seg;
 
     /* check for scheduled tasks */
     if (me->scheduled_task_cnt > 0) {
-        task = APR_RING_FIRST(me->scheduled_tasks);
+        apr_time_t now = apr_time_now();
+
+        task = me->scheduled_heap[0];
         assert(task != NULL);
-        assert(task !=
-               APR_RING_SENTINEL(me->scheduled_tasks, apr_thread_pool_task,
-                                 link));
         /* if it's time */
-        if (task->dispatch.time <= apr_time_now()) {
-            --me->scheduled_task_cnt;
-            APR_RING_REMOVE(task, link);
+        if (task->dispatch.time <= now) {
+            heap_remove(me, task);
+            /* more due ones for the other idle threads? */
+            if (me->scheduled_task_cnt > 0 && me->idle_cnt > 0
+                    && me->scheduled_heap[0]->dispatch.time <= now) {
+                apr_thread_cond_signal(me->more_work);
+            }
             return task;
         }
     }
@@ -206,6 +477,20 @@ static apr_thread_pool_task_t *pop_task(apr_thread_pool_t * me)
     task = APR_RING_FIRST(me->tasks);
     assert(task != NULL);
     assert(task != APR_RING_SENTINEL(me->tasks, apr_thread_pool_task, link));
+    /* the tasks of the thread's deque with higher priority go first */
+    if (d) {
+        int own = 0;
+
+        apr_thread_mutex_lock(d->lock);
+        if (d->task_cnt > 0) {
+            own = (APR_RING_FIRST(&d->tasks)->dispatch.priority
+                   > task->dispatch.priority);
+        }
+        apr_thread_mutex_unlock(d->lock);
+        if (own) {
+            return NULL;
+        }
+    }
     --me->task_cnt;
     seg = TASK_PRIORITY_SEG(task);
     if (task == me->task_idx[seg]) {
@@ -224,11 +509,8 @@ static apr_interval_time_t waiting_time(apr_thread_pool_t * me)
 {
     apr_thread_pool_task_t *task = NULL;
 
-    task = APR_RING_FIRST(me->scheduled_tasks);
+    task = me->scheduled_heap[0];
     assert(task != NULL);
-    assert(task !=
-           APR_RING_SENTINEL(me->scheduled_tasks, apr_thread_pool_task,
-                             link));
     return task->dispatch.time - apr_time_now();
 }
 
@@ -256,9 +538,418 @@ static struct apr_thread_list_elt *elt_new(apr_thread_pool_t * me,
     elt->current_owner = NULL;
     elt->signal_work_done = 0;
     elt->state = TH_RUN;
+    elt->deque = NULL;
+    elt->polls = 0;
     return elt;
 }
 
+/*
+ * Queue task t by priority, at the bottom (push) or at the top of the tasks
+ * of same priority.
+ * NOTE: This function is not thread safe by itself. Caller should hold the lock
+ */
+static void insert_task(apr_thread_pool_t *me, apr_thread_pool_task_t *t,
+                        int push);
+
+/*
+ * NOTE: This function is not thread safe by itself. Caller should hold the lock
+ */
+static apr_thread_pool_handle_t *handle_new(apr_thread_pool_t *me)
+{
+    apr_thread_pool_handle_t *h;
+
+    if (APR_RING_EMPTY(&me->recycled_handles, apr_thread_pool_handle_t,
+                       link)) {
+        h = apr_palloc(me->pool, sizeof(*h));
+        if (NULL == h) {
+            return NULL;
+        }
+        h->done_cond = NULL;
+    }
+    else {
+        h = APR_RING_FIRST(&me->recycled_handles);
+        APR_RING_REMOVE(h, link);
+    }
+    APR_RING_ELEM_INIT(h, link);
+
+    h->tp = me;
+    APR_RING_INIT(&h->dependents, apr_thread_pool_dep, link);
+    h->result = NULL;
+    h->status = APR_SUCCESS;
+    h->done = 0;
+    h->waiters = 0;
+    h->refcount = 2;            /* the task's and the caller's */
+    return h;
+}
+
+/*
+ * NOTE: This function is not thread safe by itself. Caller should hold the lock
+ */
+static void handle_unref(apr_thread_pool_t *me, apr_thread_pool_handle_t *h)
+{
+    if (--h->refcount == 0) {
+        APR_RING_INSERT_TAIL(&me->recycled_handles, h,
+                             apr_thread_pool_handle_t, link);
+    }
+}
+
+/*
+ * Make task t wait for the handles in deps which are not completed yet.
+ * NOTE: This function is not thread safe by itself. Caller should hold the lock
+ */
+static apr_status_t task_depend(apr_thread_pool_t *me,
+                                apr_thread_pool_task_t *t,
+                                apr_thread_pool_handle_t *const *deps,
+                                apr_size_t ndeps)
+{
+    struct apr_thread_pool_deps edges;
+    struct apr_thread_pool_dep *dep;
+    apr_size_t i;
+
+    /* Allocate all the edges first so that failing leaves nothing linked */
+    APR_RING_INIT(&edges, apr_thread_pool_dep, link);
+    for (i = 0; i < ndeps; i++) {
+        if (deps[i]->tp != me) {
+            APR_RING_CONCAT(&me->recycled_deps, &edges,
+                            apr_thread_pool_dep, link);
+            return APR_EINVAL;
+        }
+        if (deps[i]->done) {
+            continue;
+        }
+        if (APR_RING_EMPTY(&me->recycled_deps, apr_thread_pool_dep, link)) {
+            dep = apr_palloc(me->pool, sizeof(*dep));
+            if (NULL == dep) {
+                APR_RING_CONCAT(&me->recycled_deps, &edges,
+                                apr_thread_pool_dep, link);
+                return APR_ENOMEM;
+            }
+        }
+        else {
+            dep = APR_RING_FIRST(&me->recycled_deps);
+            APR_RING_REMOVE(dep, link);
+        }
+        APR_RING_INSERT_TAIL(&edges, dep, apr_thread_pool_dep, link);
+    }
+
+    for (i = 0; i < ndeps; i++) {
+        apr_thread_pool_handle_t *h = deps[i];
+
+        if (h->done) {
+            if (APR_SUCCESS != h->status && APR_SUCCESS == t->deps_status) {
+                t->deps_status = h->status;
+            }
+            continue;
+        }
+        dep = APR_RING_FIRST(&edges);
+        APR_RING_REMOVE(dep, link);
+        dep->task = t;
+        APR_RING_INSERT_TAIL(&h->dependents, dep, apr_thread_pool_dep, link);
+        ++t->deps_pending;
+    }
+    return APR_SUCCESS;
+}
+
+static void task_ready(apr_thread_pool_t *me, apr_thread_pool_task_t *t);
+
+/*
+ * Complete the handle of task t (if any) with the given status and result,
+ * waking up its waiters and releasing the tasks depending on it.
+ * NOTE: This function is not thread safe by itself. Caller should hold the lock
+ */
+static void task_complete(apr_thread_pool_t *me, apr_thread_pool_task_t *t,
+                          apr_status_t status, void *result)
+{
+    apr_thread_pool_handle_t *h = t->handle;
+
+    if (NULL == h) {
+        return;
+    }
+    t->handle = NULL;
+
+    h->status = status;
+    h->result = result;
+    h->done = 1;
+    if (h->waiters) {
+        apr_thread_cond_broadcast(h->done_cond);
+    }
+
+    while (!APR_RING_EMPTY(&h->dependents, apr_thread_pool_dep, link)) {
+        struct apr_thread_pool_dep *dep = APR_RING_FIRST(&h->dependents);
+        apr_thread_pool_task_t *dt = dep->task;
+
+        APR_RING_REMOVE(dep, link);
+        APR_RING_INSERT_TAIL(&me->recycled_deps, dep, apr_thread_pool_dep,
+                             link);
+        if (APR_SUCCESS != status && APR_SUCCESS == dt->deps_status) {
+            dt->deps_status = status;
+        }
+        if (--dt->deps_pending == 0) {
+            APR_RING_REMOVE(dt, link);
+            task_ready(me, dt);
+        }
+    }
+
+    handle_unref(me, h);
+}
+
+/*
+ * Queue the waiting task t whose dependencies are all completed, or complete
+ * it without running if one of them failed (or the pool is terminated).
+ * NOTE: This function is not thread safe by itself. Caller should hold the lock
+ */
+static void task_ready(apr_thread_pool_t *me, apr_thread_pool_task_t *t)
+{
+    if (APR_SUCCESS != t->deps_status || me->terminated) {
+        task_complete(me, t, me->terminated ? APR_NOTFOUND : t->deps_status,
+                      NULL);
+        APR_RING_INSERT_TAIL(me->recycled_tasks, t, apr_thread_pool_task,
+                             link);
+        return;
+    }
+
+    insert_task(me, t, 1);
+    me->task_cnt++;
+    if (me->task_cnt > me->tasks_high)
+        me->tasks_high = me->task_cnt;
+    apr_thread_cond_signal(me->more_work);
+}
+
+/*
+ * Give a free deque to the work stealing thread elt.
+ * NOTE: This function is not thread safe by itself. Caller should hold the lock
+ */
+static void ws_attach(apr_thread_pool_t *me, struct apr_thread_list_elt *elt)
+{
+    apr_size_t i;
+
+    for (i = 0; i < me->deque_cnt; i++) {
+        if (!me->deques[i].elt) {
+            me->deques[i].elt = elt;
+            elt->deque = &me->deques[i];
+            apr_threadkey_private_set(elt->deque, me->deque_key);
+            return;
+        }
+    }
+}
+
+/*
+ * Release the deque of the exiting thread elt, handing its tasks over to
+ * the pool (or dropping them if terminated).
+ * NOTE: This function is not thread safe by itself. Caller should hold the lock
+ */
+static void ws_detach(apr_thread_pool_t *me, struct apr_thread_list_elt *elt)
+{
+    struct apr_thread_pool_deque *d = elt->deque;
+    apr_thread_pool_task_t *t;
+    int moved = 0;
+
+    if (!d) {
+        return;
+    }
+
+    apr_thread_mutex_lock(d->lock);
+    while (!APR_RING_EMPTY(&d->tasks, apr_thread_pool_task, link)) {
+        t = APR_RING_FIRST(&d->tasks);
+        APR_RING_REMOVE(t, link);
+        --d->task_cnt;
+        t->deque = NULL;
+        if (me->terminated) {
+            APR_RING_INSERT_TAIL(me->recycled_tasks, t,
+                                 apr_thread_pool_task, link);
+            continue;
+        }
+        insert_task(me, t, 1);
+        me->task_cnt++;
+        moved = 1;
+    }
+    APR_RING_CONCAT(me->recycled_tasks, &d->recycled_tasks,
+                    apr_thread_pool_task, link);
+    d->elt = NULL;
+    apr_thread_mutex_unlock(d->lock);
+
+    elt->deque = NULL;
+    apr_threadkey_private_set(NULL, me->deque_key);
+    if (moved) {
+        apr_thread_cond_signal(me->more_work);
+    }
+}
+
+/*
+ * Take the first task of deque d for thread elt, or NULL.
+ */
+static apr_thread_pool_task_t *ws_pop_deque(struct apr_thread_pool_deque *d,
+                                            struct apr_thread_list_elt *elt)
+{
+    apr_thread_pool_task_t *task = NULL;
+
+    apr_thread_mutex_lock(d->lock);
+    if (d->task_cnt > 0) {
+        task = APR_RING_FIRST(&d->tasks);
+        APR_RING_REMOVE(task, link);
+        --d->task_cnt;
+        ++d->tasks_run;
+        elt->current_owner = task->owner;
+    }
+    apr_thread_mutex_unlock(d->lock);
+
+    return task;
+}
+
+/*
+ * Take the next task for the work stealing thread elt: from the pool's tasks
+ * if there are some with a higher priority than its own (or due scheduled
+ * tasks from time to time), then from its deque, then stolen from the other
+ * threads' deques.
+ */
+static apr_thread_pool_task_t *ws_pop_task(apr_thread_pool_t *me,
+                                           struct apr_thread_list_elt *elt)
+{
+    struct apr_thread_pool_deque *d = elt->deque;
+    apr_thread_pool_task_t *task = NULL;
+    int polled = 0;
+    apr_size_t i;
+
+    if (me->task_cnt
+        || (me->scheduled_task_cnt && ++elt->polls >= WS_POLL_INTERVAL)) {
+        elt->polls = 0;
+        polled = 1;
+        apr_thread_mutex_lock(me->lock);
+        task = pop_task(me, d);
+        if (task) {
+            ++me->tasks_run;
+            elt->current_owner = task->owner;
+        }
+        apr_thread_mutex_unlock(me->lock);
+        if (task) {
+            return task;
+        }
+    }
+
+    task = ws_pop_deque(d, elt);
+    if (task) {
+        return task;
+    }
+
+    if (me->scheduled_task_cnt && !polled) {
+        apr_thread_mutex_lock(me->lock);
+        task = pop_task(me, NULL);
+        if (task) {
+            ++me->tasks_run;
+            elt->current_owner = task->owner;
+        }
+        apr_thread_mutex_unlock(me->lock);
+        if (task) {
+            return task;
+        }
+    }
+
+    for (i = 1; i < me->deque_cnt; i++) {
+        struct apr_thread_pool_deque *v;
+
+        v = &me->deques[(d->index + i) % me->deque_cnt];
+        if (v->task_cnt > 0) {
+            task = ws_pop_deque(v, elt);
+            if (task) {
+                return task;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Recycle the task run by the work stealing thread elt, and let
+ * tasks_cancel() know if it waits for it.
+ */
+static void ws_task_done(apr_thread_pool_t *me,
+                         struct apr_thread_list_elt *elt,
+                         apr_thread_pool_task_t *task,
+                         apr_status_t status, void *result)
+{
+    struct apr_thread_pool_deque *d = task->deque;
+    int signal_work_done;
+
+    if (d) {
+        apr_thread_mutex_lock(d->lock);
+        APR_RING_INSERT_TAIL(&d->recycled_tasks, task,
+                             apr_thread_pool_task, link);
+        apr_thread_mutex_unlock(d->lock);
+    }
+    else {
+        apr_thread_mutex_lock(me->lock);
+        task_complete(me, task, status, result);
+        APR_RING_INSERT_TAIL(me->recycled_tasks, task,
+                             apr_thread_pool_task, link);
+        apr_thread_mutex_unlock(me->lock);
+    }
+
+    d = elt->deque;
+    apr_thread_mutex_lock(d->lock);
+    elt->current_owner = NULL;
+    signal_work_done = elt->signal_work_done;
+    elt->signal_work_done = 0;
+    apr_thread_mutex_unlock(d->lock);
+
+    if (signal_work_done) {
+        apr_thread_mutex_lock(me->lock);
+        apr_thread_cond_broadcast(me->work_done);
+        apr_thread_mutex_unlock(me->lock);
+    }
+}
+
+/*
+ * Run tasks in work stealing mode until there are none left or the thread
+ * is asked to stop. The pool's lock is released meanwhile.
+ * NOTE: Caller should hold the lock
+ */
+static void ws_run_tasks(apr_thread_pool_t *me,
+                         struct apr_thread_list_elt *elt, apr_thread_t *t)
+{
+    apr_thread_pool_task_t *task;
+    apr_status_t status;
+    void *result;
+
+    apr_thread_mutex_unlock(me->lock);
+
+    while (elt->state != TH_STOP && (task = ws_pop_task(me, elt))) {
+        /* Run the task (or drop it if terminated already) */
+        status = APR_NOTFOUND;
+        result = NULL;
+        if (!me->terminated) {
+            apr_thread_data_set(task, "apr_thread_pool_task", NULL, t);
+            result = task->func(t, task->param);
+            status = APR_SUCCESS;
+        }
+        ws_task_done(me, elt, task, status, result);
+    }
+
+    apr_thread_mutex_lock(me->lock);
+}
+
+/*
+ * Whether an idle work stealing thread has something to do.
+ * NOTE: This function is not thread safe by itself. Caller should hold the lock
+ */
+static int ws_has_tasks(apr_thread_pool_t *me)
+{
+    apr_size_t i, cnt;
+
+    if (me->task_cnt) {
+        return 1;
+    }
+    for (i = 0; i < me->deque_cnt; i++) {
+        apr_thread_mutex_lock(me->deques[i].lock);
+        cnt = me->deques[i].task_cnt;
+        apr_thread_mutex_unlock(me->deques[i].lock);
+        if (cnt) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
 /*
  * The worker thread function. Take a task from the queue and perform it if
  * there is any. Otherwise, put itself into the idle thread list and waiting
@@ -273,6 +964,8 @@ static void *APR_THREAD_FUNC thread_pool_func(apr_thread_t * t, void *param)
     apr_thread_pool_task_t *task = NULL;
     apr_interval_time_t wait;
     struct apr_thread_list_elt *elt;
+    apr_status_t status;
+    void *result;
 
     apr_thread_mutex_lock(me->lock);
 
@@ -281,6 +974,9 @@ static void *APR_THREAD_FUNC thread_pool_func(apr_thread_t * t, void *param)
         apr_thread_mutex_unlock(me->lock);
         apr_thread_exit(t, APR_ENOMEM);
     }
+    if (me->deques) {
+        ws_attach(me, elt);
+    }
 
     for (;;) {
         /* Test if not new element, it is awakened from idle */
@@ -293,30 +989,40 @@ static void *APR_THREAD_FUNC thread_pool_func(apr_thread_t * t, void *param)
             ++me->busy_cnt;
             APR_RING_INSERT_TAIL(me->busy_thds, elt,
                                  apr_thread_list_elt, link);
-            do {
-                task = pop_task(me);
-                if (!task) {
-                    break;
-                }
-                ++me->tasks_run;
-                elt->current_owner = task->owner;
-                apr_thread_mutex_unlock(me->lock);
-
-                /* Run the task (or drop it if terminated already) */
-                if (!me->terminated) {
-                    apr_thread_data_set(task, "apr_thread_pool_task", NULL, t);
-                    task->func(t, task->param);
-                }
-
-                apr_thread_mutex_lock(me->lock);
-                APR_RING_INSERT_TAIL(me->recycled_tasks, task,
-                                     apr_thread_pool_task, link);
-                elt->current_owner = NULL;
-                if (elt->signal_work_done) {
-                    elt->signal_work_done = 0;
-                    apr_thread_cond_signal(me->work_done);
-                }
-            } while (elt->state != TH_STOP);
+            if (elt->deque) {
+                ws_run_tasks(me, elt, t);
+            }
+            else {
+                do {
+                    task = pop_task(me, NULL);
+                    if (!task) {
+                        break;
+                    }
+                    ++me->tasks_run;
+                    elt->current_owner = task->owner;
+                    apr_thread_mutex_unlock(me->lock);
+
+                    /* Run the task (or drop it if terminated already) */
+                    status = APR_NOTFOUND;
+                    result = NULL;
+                    if (!me->terminated) {
+                        apr_thread_data_set(task, "apr_thread_pool_task",
+                                            NULL, t);
+                        result = task->func(t, task->param);
+                        status = APR_SUCCESS;
+                    }
+
+                    apr_thread_mutex_lock(me->lock);
+                    task_complete(me, task, status, result);
+                    APR_RING_INSERT_TAIL(me->recycled_tasks, task,
+                                         apr_thread_pool_task, link);
+                    elt->current_owner = NULL;
+                    if (elt->signal_work_done) {
+                        elt->signal_work_done = 0;
+                        apr_thread_cond_signal(me->work_done);
+                    }
+                } while (elt->state != TH_STOP);
+            }
             APR_RING_REMOVE(elt, link);
             --me->busy_cnt;
         }
@@ -337,6 +1043,11 @@ static void *APR_THREAD_FUNC thread_pool_func(apr_thread_t * t, void *param)
         ++me->idle_cnt;
         APR_RING_INSERT_TAIL(me->idle_thds, elt, apr_thread_list_elt, link);
 
+        /* Tasks pushed to a deque while we were not idle yet don't signal */
+        if (elt->deque && ws_has_tasks(me)) {
+            continue;
+        }
+
         /* 
          * If there is a scheduled task, always scheduled to perform that task.
          * Since there is no guarantee that current idle threads are scheduled
@@ -359,6 +1070,8 @@ static void *APR_THREAD_FUNC thread_pool_func(apr_thread_t * t, void *param)
         }
     }
 
+    ws_detach(me, elt);
+
     /* Dead thread, to be joined */
     APR_RING_INSERT_TAIL(me->dead_thds, elt, apr_thread_list_elt, link);
     if (--me->thd_cnt == 0 && me->terminated) {
@@ -414,6 +1127,15 @@ APU_DECLARE(apr_status_t) apr_thread_pool_create(apr_thread_pool_t ** me,
                                                  apr_size_t init_threads,
                                                  apr_size_t max_threads,
                                                  apr_pool_t * pool)
+{
+    return apr_thread_pool_create_ex(me, init_threads, max_threads, 0, pool);
+}
+
+APU_DECLARE(apr_status_t) apr_thread_pool_create_ex(apr_thread_pool_t ** me,
+                                                    apr_size_t init_threads,
+                                                    apr_size_t max_threads,
+                                                    apr_uint32_t flags,
+                                                    apr_pool_t * pool)
 {
     apr_thread_t *t;
     apr_status_t rv = APR_SUCCESS;
@@ -421,7 +1143,7 @@ APU_DECLARE(apr_status_t) apr_thread_pool_create(apr_thread_pool_t ** me,
 
     *me = NULL;
 
-    rv = thread_pool_construct(&tp, init_threads, max_threads, pool);
+    rv = thread_pool_construct(&tp, init_threads, max_threads, flags, pool);
     if (APR_SUCCESS != rv)
         return rv;
     apr_pool_pre_cleanup_register(tp->pool, tp, thread_pool_cleanup);
@@ -489,6 +1211,11 @@ static apr_thread_pool_task_t *task_new(apr_thread_pool_t * me,
     t->func = func;
     t->param = param;
     t->owner = owner;
+    t->deque = NULL;
+    t->id = 0;
+    t->handle = NULL;
+    t->deps_pending = 0;
+    t->deps_status = APR_SUCCESS;
     if (time > 0) {
         t->dispatch.time = apr_time_now() + time;
     }
@@ -541,15 +1268,15 @@ static apr_thread_pool_task_t *add_if_empty(apr_thread_pool_t * me,
 }
 
 /*
-*   schedule a task to run in "time" microseconds. Find the spot in the ring where
-*   the time fits. Adjust the short_time so the thread wakes up when the time is reached.
+*   schedule a task to run in "time" microseconds. Add it to the heap, and wake
+*   up a thread to wait until the (possibly new) earliest time is reached.
 */
 static apr_status_t schedule_task(apr_thread_pool_t *me,
                                   apr_thread_start_t func, void *param,
-                                  void *owner, apr_interval_time_t time)
+                                  void *owner, apr_interval_time_t time,
+                                  apr_thread_pool_timer_t *timer)
 {
     apr_thread_pool_task_t *t;
-    apr_thread_pool_task_t *t_loc;
     apr_thread_t *thd;
     apr_status_t rv = APR_SUCCESS;
 
@@ -569,25 +1296,20 @@ static apr_status_t schedule_task(apr_thread_pool_t *me,
         apr_thread_mutex_unlock(me->lock);
         return APR_ENOMEM;
     }
-    t_loc = APR_RING_FIRST(me->scheduled_tasks);
-    while (NULL != t_loc) {
-        /* if the time is less than the entry insert ahead of it */
-        if (t->dispatch.time < t_loc->dispatch.time) {
-            ++me->scheduled_task_cnt;
-            APR_RING_INSERT_BEFORE(t_loc, t, link);
-            break;
-        }
-        else {
-            t_loc = APR_RING_NEXT(t_loc, link);
-            if (t_loc ==
-                APR_RING_SENTINEL(me->scheduled_tasks, apr_thread_pool_task,
-                                  link)) {
-                ++me->scheduled_task_cnt;
-                APR_RING_INSERT_TAIL(me->scheduled_tasks, t,
-                                     apr_thread_pool_task, link);
-                break;
-            }
-        }
+    if (time <= 0) {
+        t->dispatch.time = apr_time_now();
+    }
+    t->id = ++me->scheduled_id;
+    rv = heap_insert(me, t);
+    if (APR_SUCCESS != rv) {
+        APR_RING_INSERT_TAIL(me->recycled_tasks, t,
+                             apr_thread_pool_task, link);
+        apr_thread_mutex_unlock(me->lock);
+        return rv;
+    }
+    if (timer) {
+        timer->task = t;
+        timer->id = t->id;
     }
     /* there should be at least one thread for scheduled tasks */
     if (0 == me->thd_cnt) {
@@ -598,21 +1320,139 @@ static apr_status_t schedule_task(apr_thread_pool_t *me,
                 me->thd_high = me->thd_cnt;
         }
     }
-    apr_thread_cond_signal(me->more_work);
-    apr_thread_mutex_unlock(me->lock);
+    apr_thread_cond_signal(me->more_work);
+    apr_thread_mutex_unlock(me->lock);
+
+    return rv;
+}
+
+static void insert_task(apr_thread_pool_t *me, apr_thread_pool_task_t *t,
+                        int push)
+{
+    apr_thread_pool_task_t *t_loc;
+
+    t_loc = add_if_empty(me, t);
+    if (NULL == t_loc) {
+        return;
+    }
+
+    if (push) {
+        while (APR_RING_SENTINEL(me->tasks, apr_thread_pool_task, link) !=
+               t_loc && t_loc->dispatch.priority >= t->dispatch.priority) {
+            t_loc = APR_RING_NEXT(t_loc, link);
+        }
+    }
+    APR_RING_INSERT_BEFORE(t_loc, t, link);
+    if (!push) {
+        if (t_loc == me->task_idx[TASK_PRIORITY_SEG(t)]) {
+            me->task_idx[TASK_PRIORITY_SEG(t)] = t;
+        }
+    }
+}
+
+/*
+ * Push a task from work stealing thread to its own deque, only waking up an
+ * idle thread (or creating one) to steal it if needed.
+ */
+static apr_status_t ws_add_task(apr_thread_pool_t *me,
+                                struct apr_thread_pool_deque *d,
+                                apr_thread_start_t func, void *param,
+                                apr_byte_t priority, int push, void *owner)
+{
+    apr_thread_pool_task_t *t;
+    apr_thread_pool_task_t *t_loc;
+    apr_thread_t *thd;
+    apr_status_t rv = APR_SUCCESS;
+    apr_size_t cnt;
+
+    if (me->terminated) {
+        /* Let the caller know that we are done */
+        return APR_NOTFOUND;
+    }
+
+    apr_thread_mutex_lock(d->lock);
+    if (APR_RING_EMPTY(&d->recycled_tasks, apr_thread_pool_task, link)) {
+        apr_thread_mutex_unlock(d->lock);
+        apr_thread_mutex_lock(me->lock);
+        t = task_new(me, func, param, priority, owner, 0);
+        apr_thread_mutex_unlock(me->lock);
+        if (NULL == t) {
+            return APR_ENOMEM;
+        }
+        apr_thread_mutex_lock(d->lock);
+    }
+    else {
+        t = APR_RING_FIRST(&d->recycled_tasks);
+        APR_RING_REMOVE(t, link);
+        APR_RING_ELEM_INIT(t, link);
+        t->func = func;
+        t->param = param;
+        t->owner = owner;
+        t->dispatch.priority = priority;
+    }
+    t->deque = d;
+
+    if (push) {
+        t_loc = APR_RING_LAST(&d->tasks);
+        while (t_loc != APR_RING_SENTINEL(&d->tasks, apr_thread_pool_task, link)
+               && t_loc->dispatch.priority < t->dispatch.priority) {
+            t_loc = APR_RING_PREV(t_loc, link);
+        }
+        APR_RING_INSERT_AFTER(t_loc, t, link);
+    }
+    else {
+        t_loc = APR_RING_FIRST(&d->tasks);
+        while (t_loc != APR_RING_SENTINEL(&d->tasks, apr_thread_pool_task, link)
+               && t_loc->dispatch.priority > t->dispatch.priority) {
+            t_loc = APR_RING_NEXT(t_loc, link);
+        }
+        APR_RING_INSERT_BEFORE(t_loc, t, link);
+    }
+    cnt = ++d->task_cnt;
+    apr_thread_mutex_unlock(d->lock);
+
+    /* An idle thread increments idle_cnt before it looks at the deques */
+    if (me->idle_cnt || (me->thd_cnt < me->thd_max && cnt > me->threshold)) {
+        apr_thread_mutex_lock(me->lock);
+        if (0 == me->idle_cnt && me->thd_cnt < me->thd_max
+                && cnt > me->threshold) {
+            rv = apr_thread_create(&thd, NULL, thread_pool_func, me, me->pool);
+            if (APR_SUCCESS == rv) {
+                ++me->thd_cnt;
+                if (me->thd_cnt > me->thd_high)
+                    me->thd_high = me->thd_cnt;
+            }
+        }
+        apr_thread_cond_signal(me->more_work);
+        apr_thread_mutex_unlock(me->lock);
+    }
 
     return rv;
 }
 
 static apr_status_t add_task(apr_thread_pool_t *me, apr_thread_start_t func,
                              void *param, apr_byte_t priority, int push,
-                             void *owner)
+                             void *owner,
+                             apr_thread_pool_handle_t *const *deps,
+                             apr_size_t ndeps,
+                             apr_thread_pool_handle_t **handle)
 {
     apr_thread_pool_task_t *t;
-    apr_thread_pool_task_t *t_loc;
+    apr_thread_pool_handle_t *h = NULL;
     apr_thread_t *thd;
     apr_status_t rv = APR_SUCCESS;
 
+    /* Tasks with a handle or dependencies always go through the pool's lock */
+    if (me->deques && !handle && !ndeps) {
+        void *d = NULL;
+
+        /* Pushed by one of our threads? */
+        apr_threadkey_private_get(&d, me->deque_key);
+        if (d) {
+            return ws_add_task(me, d, func, param, priority, push, owner);
+        }
+    }
+
     apr_thread_mutex_lock(me->lock);
 
     if (me->terminated) {
@@ -629,26 +1469,39 @@ static apr_status_t add_task(apr_thread_pool_t *me, apr_thread_start_t func,
         apr_thread_mutex_unlock(me->lock);
         return APR_ENOMEM;
     }
-
-    t_loc = add_if_empty(me, t);
-    if (NULL == t_loc) {
-        goto FINAL_EXIT;
-    }
-
-    if (push) {
-        while (APR_RING_SENTINEL(me->tasks, apr_thread_pool_task, link) !=
-               t_loc && t_loc->dispatch.priority >= t->dispatch.priority) {
-            t_loc = APR_RING_NEXT(t_loc, link);
+    if (handle) {
+        h = handle_new(me);
+        if (NULL == h) {
+            rv = APR_ENOMEM;
+            goto CATCH_ERROR;
         }
+        t->handle = h;
     }
-    APR_RING_INSERT_BEFORE(t_loc, t, link);
-    if (!push) {
-        if (t_loc == me->task_idx[TASK_PRIORITY_SEG(t)]) {
-            me->task_idx[TASK_PRIORITY_SEG(t)] = t;
+    if (ndeps) {
+        rv = task_depend(me, t, deps, ndeps);
+        if (APR_SUCCESS != rv) {
+            goto CATCH_ERROR;
         }
     }
+    if (handle) {
+        *handle = h;
+    }
+
+    if (t->deps_pending) {
+        /* Queued by task_complete() of its last dependency */
+        APR_RING_INSERT_TAIL(&me->waiting_tasks, t, apr_thread_pool_task,
+                             link);
+        apr_thread_mutex_unlock(me->lock);
+        return APR_SUCCESS;
+    }
+    if (APR_SUCCESS != t->deps_status) {
+        task_ready(me, t);
+        apr_thread_mutex_unlock(me->lock);
+        return APR_SUCCESS;
+    }
+
+    insert_task(me, t, push);
 
-  FINAL_EXIT:
     me->task_cnt++;
     if (me->task_cnt > me->tasks_high)
         me->tasks_high = me->task_cnt;
@@ -666,6 +1519,15 @@ static apr_status_t add_task(apr_thread_pool_t *me, apr_thread_start_t func,
     apr_thread_mutex_unlock(me->lock);
 
     return rv;
+
+  CATCH_ERROR:
+    if (h) {
+        APR_RING_INSERT_TAIL(&me->recycled_handles, h,
+                             apr_thread_pool_handle_t, link);
+    }
+    APR_RING_INSERT_TAIL(me->recycled_tasks, t, apr_thread_pool_task, link);
+    apr_thread_mutex_unlock(me->lock);
+    return rv;
 }
 
 APU_DECLARE(apr_status_t) apr_thread_pool_push(apr_thread_pool_t *me,
@@ -674,7 +1536,7 @@ APU_DECLARE(apr_status_t) apr_thread_pool_push(apr_thread_pool_t *me,
                                                apr_byte_t priority,
                                                void *owner)
 {
-    return add_task(me, func, param, priority, 1, owner);
+    return add_task(me, func, param, priority, 1, owner, NULL, 0, NULL);
 }
 
 APU_DECLARE(apr_status_t) apr_thread_pool_schedule(apr_thread_pool_t *me,
@@ -683,7 +1545,40 @@ APU_DECLARE(apr_status_t) apr_thread_pool_schedule(apr_thread_pool_t *me,
                                                    apr_interval_time_t time,
                                                    void *owner)
 {
-    return schedule_task(me, func, param, owner, time);
+    return schedule_task(me, func, param, owner, time, NULL);
+}
+
+APU_DECLARE(apr_status_t) apr_thread_pool_schedule_ex(apr_thread_pool_t *me,
+                                                      apr_thread_start_t func,
+                                                      void *param,
+                                                      apr_interval_time_t time,
+                                                      void *owner,
+                                                      apr_thread_pool_timer_t *timer)
+{
+    return schedule_task(me, func, param, owner, time, timer);
+}
+
+APU_DECLARE(apr_status_t) apr_thread_pool_schedule_cancel(apr_thread_pool_t *me,
+                                                          apr_thread_pool_timer_t *timer)
+{
+    apr_thread_pool_task_t *t = timer->task;
+    apr_status_t rv = APR_NOTFOUND;
+
+    apr_thread_mutex_lock(me->lock);
+
+    /* Still in the heap, not run nor recycled for another task? */
+    if (t && t->id == timer->id && t->heap_idx < me->scheduled_task_cnt
+            && me->scheduled_heap[t->heap_idx] == t) {
+        heap_remove(me, t);
+        APR_RING_INSERT_TAIL(me->recycled_tasks, t,
+                             apr_thread_pool_task, link);
+        rv = APR_SUCCESS;
+    }
+    timer->task = NULL;
+
+    apr_thread_mutex_unlock(me->lock);
+
+    return rv;
 }
 
 APU_DECLARE(apr_status_t) apr_thread_pool_top(apr_thread_pool_t *me,
@@ -692,30 +1587,465 @@ APU_DECLARE(apr_status_t) apr_thread_pool_top(apr_thread_pool_t *me,
                                               apr_byte_t priority,
                                               void *owner)
 {
-    return add_task(me, func, param, priority, 0, owner);
+    return add_task(me, func, param, priority, 0, owner, NULL, 0, NULL);
+}
+
+APU_DECLARE(apr_status_t) apr_thread_pool_push_ex(apr_thread_pool_t *me,
+                                                  apr_thread_start_t func,
+                                                  void *param,
+                                                  apr_byte_t priority,
+                                                  void *owner,
+                                                  apr_thread_pool_handle_t *const *deps,
+                                                  apr_size_t ndeps,
+                                                  apr_thread_pool_handle_t **handle)
+{
+    return add_task(me, func, param, priority, 1, owner, deps, ndeps, handle);
+}
+
+static apr_status_t handle_wait(apr_thread_pool_handle_t *h,
+                                apr_interval_time_t timeout, void **result)
+{
+    apr_thread_pool_t *me = h->tp;
+    apr_status_t rv = APR_SUCCESS;
+    apr_time_t deadline = 0;
+
+    if (timeout > 0) {
+        deadline = apr_time_now() + timeout;
+    }
+
+    apr_thread_mutex_lock(me->lock);
+    while (!h->done) {
+        if (0 == timeout) {
+            rv = APR_EAGAIN;
+            break;
+        }
+        if (NULL == h->done_cond) {
+            rv = apr_thread_cond_create(&h->done_cond, me->pool);
+            if (APR_SUCCESS != rv) {
+                break;
+            }
+        }
+        ++h->waiters;
+        if (timeout < 0) {
+            rv = apr_thread_cond_wait(h->done_cond, me->lock);
+        }
+        else {
+            apr_interval_time_t left = deadline - apr_time_now();
+
+            if (left > 0) {
+                rv = apr_thread_cond_timedwait(h->done_cond, me->lock, left);
+            }
+            else {
+                rv = APR_TIMEUP;
+            }
+        }
+        --h->waiters;
+        if (APR_SUCCESS != rv && !h->done) {
+            break;
+        }
+    }
+    if (h->done) {
+        rv = h->status;
+        if (result) {
+            *result = h->result;
+        }
+    }
+    apr_thread_mutex_unlock(me->lock);
+
+    return rv;
+}
+
+APU_DECLARE(apr_status_t) apr_thread_pool_handle_wait(apr_thread_pool_handle_t *handle,
+                                                      void **result)
+{
+    return handle_wait(handle, -1, result);
+}
+
+APU_DECLARE(apr_status_t) apr_thread_pool_handle_timedwait(apr_thread_pool_handle_t *handle,
+                                                           apr_interval_time_t timeout,
+                                                           void **result)
+{
+    return handle_wait(handle, timeout > 0 ? timeout : 0, result);
+}
+
+APU_DECLARE(apr_status_t) apr_thread_pool_handle_poll(apr_thread_pool_handle_t *handle,
+                                                      void **result)
+{
+    return handle_wait(handle, 0, result);
+}
+
+APU_DECLARE(void) apr_thread_pool_handle_release(apr_thread_pool_handle_t *handle)
+{
+    apr_thread_pool_t *me = handle->tp;
+
+    apr_thread_mutex_lock(me->lock);
+    handle_unref(me, handle);
+    apr_thread_mutex_unlock(me->lock);
+}
+
+static apr_status_t parallel_loop_new(apr_thread_pool_t *me,
+                                      struct parallel_loop **loop)
+{
+    struct parallel_loop *l;
+    apr_status_t rv = APR_SUCCESS;
+
+    apr_thread_mutex_lock(me->lock);
+    if (APR_RING_EMPTY(&me->recycled_loops, parallel_loop, link)) {
+        l = apr_pcalloc(me->pool, sizeof(*l));
+        if (NULL == l) {
+            apr_thread_mutex_unlock(me->lock);
+            return APR_ENOMEM;
+        }
+        rv = apr_thread_mutex_create(&l->lock, APR_THREAD_MUTEX_DEFAULT,
+                                     me->pool);
+        if (APR_SUCCESS == rv) {
+            rv = apr_thread_cond_create(&l->done_cond, me->pool);
+        }
+        if (APR_SUCCESS != rv) {
+            apr_thread_mutex_unlock(me->lock);
+            return rv;
+        }
+    }
+    else {
+        l = APR_RING_FIRST(&me->recycled_loops);
+        APR_RING_REMOVE(l, link);
+    }
+    apr_thread_mutex_unlock(me->lock);
+
+    APR_RING_ELEM_INIT(l, link);
+    l->tp = me;
+    l->refcount = 1;            /* the caller's */
+    l->closed = 0;
+    l->running = 0;
+    l->joined = 0;
+    l->fn = NULL;
+    l->reduce = NULL;
+    l->baton = NULL;
+    l->partials = NULL;
+    l->partial_size = 0;
+    l->rv = APR_SUCCESS;
+    *loop = l;
+    return APR_SUCCESS;
+}
+
+/*
+ * NOTE: This function is not thread safe by itself. Caller should hold the
+ * loop's lock, which is released.
+ */
+static void parallel_loop_unref(struct parallel_loop *loop)
+{
+    apr_thread_pool_t *me = loop->tp;
+    int last = (--loop->refcount == 0);
+
+    apr_thread_mutex_unlock(loop->lock);
+    if (last) {
+        apr_thread_mutex_lock(me->lock);
+        APR_RING_INSERT_TAIL(&me->recycled_loops, loop, parallel_loop, link);
+        apr_thread_mutex_unlock(me->lock);
+    }
+}
+
+static int parallel_claim(struct parallel_loop *loop,
+                          apr_size_t *begin, apr_size_t *end)
+{
+    apr_size_t left, n;
+
+    apr_thread_mutex_lock(loop->lock);
+    left = loop->end - loop->next;
+    if (0 == left) {
+        apr_thread_mutex_unlock(loop->lock);
+        return 0;
+    }
+    n = left / (2 * loop->participants);
+    if (n < loop->grain) {
+        n = loop->grain;
+    }
+    if (n > left) {
+        n = left;
+    }
+    *begin = loop->next;
+    loop->next += n;
+    *end = loop->next;
+    apr_thread_mutex_unlock(loop->lock);
+    return 1;
+}
+
+static void parallel_run(struct parallel_loop *loop, apr_size_t idx)
+{
+    void *partial = NULL;
+    apr_size_t begin, end;
+    apr_status_t rv;
+
+    if (loop->partials) {
+        partial = loop->partials + idx * loop->partial_size;
+    }
+    while (parallel_claim(loop, &begin, &end)) {
+        if (loop->reduce) {
+            rv = loop->reduce(loop->baton, partial, begin, end);
+        }
+        else {
+            rv = loop->fn(loop->baton, begin, end);
+        }
+        if (APR_SUCCESS != rv) {
+            /* Stop everyone at their next claim */
+            apr_thread_mutex_lock(loop->lock);
+            if (APR_SUCCESS == loop->rv) {
+                loop->rv = rv;
+            }
+            loop->next = loop->end;
+            apr_thread_mutex_unlock(loop->lock);
+        }
+    }
+}
+
+static void *APR_THREAD_FUNC parallel_task(apr_thread_t *t, void *param)
+{
+    struct parallel_loop *loop = param;
+    apr_size_t idx;
+
+    apr_thread_mutex_lock(loop->lock);
+    if (loop->closed || loop->next == loop->end) {
+        /* Too late, the others did it all */
+        parallel_loop_unref(loop);
+        return NULL;
+    }
+    idx = ++loop->joined;
+    ++loop->running;
+    apr_thread_mutex_unlock(loop->lock);
+
+    parallel_run(loop, idx);
+
+    apr_thread_mutex_lock(loop->lock);
+    if (--loop->running == 0 && loop->closed) {
+        apr_thread_cond_signal(loop->done_cond);
+    }
+    parallel_loop_unref(loop);
+    return NULL;
+}
+
+static apr_status_t parallel_loop_run(struct parallel_loop *loop,
+                                      apr_size_t begin, apr_size_t end,
+                                      apr_size_t grain, apr_pool_t *pool,
+                                      const void *identity, void *result,
+                                      apr_thread_pool_combine_fn_t combine)
+{
+    apr_thread_pool_t *me = loop->tp;
+    apr_size_t chunks, helpers, i;
+    apr_status_t rv;
+
+    if (0 == grain) {
+        grain = 1;
+    }
+    chunks = (end - begin - 1) / grain + 1;
+    helpers = me->thd_max;
+    if (helpers > chunks - 1) {
+        helpers = chunks - 1;
+    }
+
+    loop->next = begin;
+    loop->end = end;
+    loop->grain = grain;
+    loop->participants = helpers + 1;
+    if (loop->partial_size) {
+        loop->partials = apr_palloc(pool, (helpers + 1) * loop->partial_size);
+        if (NULL == loop->partials) {
+            apr_thread_mutex_lock(loop->lock);
+            parallel_loop_unref(loop);
+            return APR_ENOMEM;
+        }
+        for (i = 0; i <= helpers; i++) {
+            memcpy(loop->partials + i * loop->partial_size, identity,
+                   loop->partial_size);
+        }
+    }
+
+    /* The helpers which can't be pushed leave more work to the others */
+    loop->refcount += helpers;
+    for (i = 0; i < helpers; i++) {
+        if (APR_SUCCESS != apr_thread_pool_push(me, parallel_task, loop,
+                                                APR_THREAD_TASK_PRIORITY_NORMAL,
+                                                NULL)) {
+            apr_thread_mutex_lock(loop->lock);
+            loop->refcount -= helpers - i;
+            apr_thread_mutex_unlock(loop->lock);
+            break;
+        }
+    }
+    parallel_run(loop, 0);
+
+    /* Wait for the helpers running, the others won't join anymore */
+    apr_thread_mutex_lock(loop->lock);
+    loop->closed = 1;
+    while (loop->running) {
+        apr_thread_cond_wait(loop->done_cond, loop->lock);
+    }
+
+    if (loop->partials) {
+        memcpy(result, identity, loop->partial_size);
+        for (i = 0; i <= loop->joined; i++) {
+            combine(loop->baton, result,
+                    loop->partials + i * loop->partial_size);
+        }
+    }
+    rv = loop->rv;
+    parallel_loop_unref(loop);
+    return rv;
+}
+
+APU_DECLARE(apr_status_t) apr_thread_pool_parallel_for(apr_thread_pool_t *me,
+                                                       apr_size_t begin,
+                                                       apr_size_t end,
+                                                       apr_size_t grain,
+                                                       apr_thread_pool_range_fn_t fn,
+                                                       void *baton)
+{
+    struct parallel_loop *loop;
+    apr_status_t rv;
+
+    if (end <= begin) {
+        return APR_SUCCESS;
+    }
+
+    rv = parallel_loop_new(me, &loop);
+    if (APR_SUCCESS != rv) {
+        return rv;
+    }
+    loop->fn = fn;
+    loop->baton = baton;
+    return parallel_loop_run(loop, begin, end, grain, NULL, NULL, NULL, NULL);
+}
+
+APU_DECLARE(apr_status_t) apr_thread_pool_parallel_reduce(apr_thread_pool_t *me,
+                                                          apr_size_t begin,
+                                                          apr_size_t end,
+                                                          apr_size_t grain,
+                                                          apr_thread_pool_reduce_fn_t reduce,
+                                                          apr_thread_pool_combine_fn_t combine,
+                                                          void *baton,
+                                                          const void *identity,
+                                                          void *result,
+                                                          apr_size_t size,
+                                                          apr_pool_t *pool)
+{
+    struct parallel_loop *loop;
+    apr_status_t rv;
+
+    if (0 == size) {
+        return APR_EINVAL;
+    }
+    if (end <= begin) {
+        memcpy(result, identity, size);
+        return APR_SUCCESS;
+    }
+
+    rv = parallel_loop_new(me, &loop);
+    if (APR_SUCCESS != rv) {
+        return rv;
+    }
+    loop->reduce = reduce;
+    loop->baton = baton;
+    loop->partial_size = size;
+    return parallel_loop_run(loop, begin, end, grain, pool, identity, result,
+                             combine);
+}
+
+/*
+ * Drop the loop reference of task t if it is a parallel loop helper, the
+ * task being removed before it ran.
+ * NOTE: This function is not thread safe by itself. Caller should hold the lock
+ */
+static void parallel_task_discard(apr_thread_pool_t *me,
+                                  apr_thread_pool_task_t *t)
+{
+    struct parallel_loop *loop;
+    int last;
+
+    if (t->func != parallel_task) {
+        return;
+    }
+    loop = t->param;
+    apr_thread_mutex_lock(loop->lock);
+    last = (--loop->refcount == 0);
+    apr_thread_mutex_unlock(loop->lock);
+    if (last) {
+        APR_RING_INSERT_TAIL(&me->recycled_loops, loop, parallel_loop, link);
+    }
 }
 
 static apr_status_t remove_scheduled_tasks(apr_thread_pool_t *me,
                                            void *owner)
 {
     apr_thread_pool_task_t *t_loc;
-    apr_thread_pool_task_t *next;
+    apr_size_t i, n = 0;
 
-    t_loc = APR_RING_FIRST(me->scheduled_tasks);
-    while (t_loc !=
-           APR_RING_SENTINEL(me->scheduled_tasks, apr_thread_pool_task,
-                             link)) {
-        next = APR_RING_NEXT(t_loc, link);
+    for (i = 0; i < me->scheduled_task_cnt; i++) {
+        t_loc = me->scheduled_heap[i];
         /* if this is the owner remove it */
         if (!owner || t_loc->owner == owner) {
-            --me->scheduled_task_cnt;
-            APR_RING_REMOVE(t_loc, link);
+            t_loc->id = 0;
+            APR_RING_INSERT_TAIL(me->recycled_tasks, t_loc,
+                                 apr_thread_pool_task, link);
         }
-        t_loc = next;
+        else {
+            me->scheduled_heap[n++] = t_loc;
+        }
+    }
+    me->scheduled_task_cnt = n;
+
+    /* Rebuild the heap from the remaining tasks */
+    for (i = n; i-- > 0;) {
+        heap_sift_down(me, i);
+    }
+    return APR_SUCCESS;
+}
+
+static apr_status_t remove_deque_tasks(apr_thread_pool_t *me, void *owner)
+{
+    apr_thread_pool_task_t *t_loc;
+    apr_thread_pool_task_t *next;
+    apr_size_t i;
+
+    for (i = 0; i < me->deque_cnt; i++) {
+        struct apr_thread_pool_deque *d = &me->deques[i];
+
+        apr_thread_mutex_lock(d->lock);
+        t_loc = APR_RING_FIRST(&d->tasks);
+        while (t_loc != APR_RING_SENTINEL(&d->tasks, apr_thread_pool_task,
+                                          link)) {
+            next = APR_RING_NEXT(t_loc, link);
+            if (!owner || t_loc->owner == owner) {
+                --d->task_cnt;
+                APR_RING_REMOVE(t_loc, link);
+                parallel_task_discard(me, t_loc);
+                APR_RING_INSERT_TAIL(&d->recycled_tasks, t_loc,
+                                     apr_thread_pool_task, link);
+            }
+            t_loc = next;
+        }
+        apr_thread_mutex_unlock(d->lock);
     }
     return APR_SUCCESS;
 }
 
+/* Must be locked by the caller */
+static void lock_deques(apr_thread_pool_t *me)
+{
+    apr_size_t i;
+
+    for (i = 0; i < me->deque_cnt; i++) {
+        apr_thread_mutex_lock(me->deques[i].lock);
+    }
+}
+
+static void unlock_deques(apr_thread_pool_t *me)
+{
+    apr_size_t i;
+
+    for (i = me->deque_cnt; i > 0; i--) {
+        apr_thread_mutex_unlock(me->deques[i - 1].lock);
+    }
+}
+
 static apr_status_t remove_tasks(apr_thread_pool_t *me, void *owner)
 {
     apr_thread_pool_task_t *t_loc;
@@ -738,12 +2068,36 @@ static apr_status_t remove_tasks(apr_thread_pool_t *me, void *owner)
                 }
             }
             APR_RING_REMOVE(t_loc, link);
+            task_complete(me, t_loc, APR_NOTFOUND, NULL);
+            parallel_task_discard(me, t_loc);
+            APR_RING_INSERT_TAIL(me->recycled_tasks, t_loc,
+                                 apr_thread_pool_task, link);
         }
         t_loc = next;
     }
     return APR_SUCCESS;
 }
 
+/*
+ * The waiting tasks are still referenced by the handles they depend on, so
+ * they are only marked to be completed without running once released.
+ */
+static apr_status_t remove_waiting_tasks(apr_thread_pool_t *me, void *owner)
+{
+    apr_thread_pool_task_t *t_loc;
+
+    for (t_loc = APR_RING_FIRST(&me->waiting_tasks);
+         t_loc != APR_RING_SENTINEL(&me->waiting_tasks, apr_thread_pool_task,
+                                    link);
+         t_loc = APR_RING_NEXT(t_loc, link)) {
+        if ((!owner || t_loc->owner == owner)
+                && APR_SUCCESS == t_loc->deps_status) {
+            t_loc->deps_status = APR_NOTFOUND;
+        }
+    }
+    return APR_SUCCESS;
+}
+
 /* Must be locked by the caller */
 static void wait_on_busy_threads(apr_thread_pool_t *me, void *owner)
 {
@@ -752,6 +2106,9 @@ static void wait_on_busy_threads(apr_thread_pool_t *me, void *owner)
 #endif
     struct apr_thread_list_elt *elt;
 
+    /* The owners of work stealing threads are also set under the deques' */
+    lock_deques(me);
+
     elt = APR_RING_FIRST(me->busy_thds);
     while (elt != APR_RING_SENTINEL(me->busy_thds, apr_thread_list_elt, link)) {
         if (owner ? owner != elt->current_owner : !elt->current_owner) {
@@ -771,12 +2128,16 @@ static void wait_on_busy_threads(apr_thread_pool_t *me, void *owner)
 #endif
 
         elt->signal_work_done = 1;
+        unlock_deques(me);
         apr_thread_cond_wait(me->work_done, me->lock);
+        lock_deques(me);
 
         /* Restart */
         elt = APR_RING_FIRST(me->busy_thds);
     }
 
+    unlock_deques(me);
+
     /* Maintain dead threads */
     join_dead_threads(me);
 }
@@ -794,6 +2155,12 @@ APU_DECLARE(apr_status_t) apr_thread_pool_tasks_cancel(apr_thread_pool_t *me,
     if (me->scheduled_task_cnt > 0) {
         rv = remove_scheduled_tasks(me, owner);
     }
+    if (me->deques) {
+        rv = remove_deque_tasks(me, owner);
+    }
+    if (!APR_RING_EMPTY(&me->waiting_tasks, apr_thread_pool_task, link)) {
+        rv = remove_waiting_tasks(me, owner);
+    }
 
     wait_on_busy_threads(me, owner);
 
@@ -804,7 +2171,13 @@ APU_DECLARE(apr_status_t) apr_thread_pool_tasks_cancel(apr_thread_pool_t *me,
 
 APU_DECLARE(apr_size_t) apr_thread_pool_tasks_count(apr_thread_pool_t *me)
 {
-    return me->task_cnt;
+    apr_size_t cnt = me->task_cnt;
+    apr_size_t i;
+
+    for (i = 0; i < me->deque_cnt; i++) {
+        cnt += me->deques[i].task_cnt;
+    }
+    return cnt;
 }
 
 APU_DECLARE(apr_size_t)
@@ -831,7 +2204,13 @@ APU_DECLARE(apr_size_t) apr_thread_pool_idle_count(apr_thread_pool_t *me)
 APU_DECLARE(apr_size_t)
     apr_thread_pool_tasks_run_count(apr_thread_pool_t * me)
 {
-    return me->tasks_run;
+    apr_size_t cnt = me->tasks_run;
+    apr_size_t i;
+
+    for (i = 0; i < me->deque_cnt; i++) {
+        cnt += me->deques[i].tasks_run;
+    }
+    return cnt;
 }
 
 APU_DECLARE(apr_size_t)
@@ -960,6 +2339,10 @@ APU_DECLARE(apr_size_t) apr_thread_pool_thread_max_set(apr_thread_pool_t *me,
 {
     apr_size_t n, i;
 
+    /* No more work stealing threads than deques */
+    if (me->deques && cnt > me->deque_cnt) {
+        cnt = me->deque_cnt;
+    }
     me->thd_max = cnt;
     n = me->thd_cnt;
     if (n <= cnt) {
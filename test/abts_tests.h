@@ -44,6 +44,7 @@ const struct testlist {
     {testqueue},
     {testreslist},
     {testsiphash},
+    {testthreadpool},
     {testjson}
 };
 
@@ -0,0 +1,589 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Micro-benchmarks of the bucket allocator and brigade functions.
+ *
+ * Every workload runs a fixed number of operations on data generated
+ * from a fixed seed, so that runs are comparable across builds, and
+ * reports the fastest of several repetitions. With -c the results are
+ * printed as CSV, for scripts comparing runs.
+ *
+ * The workloads exercising the bucket allocator run twice, once with the
+ * default allocator of apr_bucket_alloc_create() and once with one whose
+ * size class freelists are enabled (see apr_bucket_alloc_opts_t).
+ */
+
+#include "apr.h"
+#include "apr_general.h"
+#include "apr_getopt.h"
+#include "apr_pools.h"
+#include "apr_strings.h"
+#include "apr_file_io.h"
+#include "apr_time.h"
+#include "apr_buckets.h"
+#define APR_WANT_MEMFUNC
+#define APR_WANT_STRFUNC
+#include "apr_want.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* The size of the generated data, and of the benchmark file */
+#define DATA_SIZE (4 * 1024 * 1024)
+
+/* The maximum length of a line for split_line */
+#define MAX_LINE 8192
+
+/* The boundary separating the parts of the split_boundary data */
+#define BOUNDARY "\r\n--c0ffee-b0undary-42"
+
+/* The watermarks of the size class freelists of the caching allocator */
+#define CACHE_MAX_FREE (4 * 1024 * 1024)
+#define CACHE_MIN_FREE (1024 * 1024)
+
+typedef struct bench_ctx_t {
+    apr_pool_t *pool;
+    /* the allocator of the running workload, one of the two below */
+    apr_bucket_alloc_t *ba;
+    /* created by apr_bucket_alloc_create(), without caching */
+    apr_bucket_alloc_t *ba_default;
+    /* created by apr_bucket_alloc_create_ex2(), with caching */
+    apr_bucket_alloc_t *ba_cached;
+    /* DATA_SIZE bytes of printable data, with lines of 20 to 120 bytes */
+    char *data;
+    /* the same data with a boundary every 1000 to 9000 bytes */
+    char *parts;
+    apr_size_t parts_len;
+    const char *fname;
+} bench_ctx_t;
+
+/* Run n operations of a workload, returning the number of bytes they
+ * processed (zero when it does not apply).
+ */
+typedef apr_size_t (*bench_fn)(bench_ctx_t *ctx, apr_pool_t *p, int n);
+
+typedef struct bench_t {
+    const char *name;
+    bench_fn run;
+    /* the number of operations at scale 1 */
+    int ops;
+    /* non zero to run the workload with both allocators */
+    int both;
+} bench_t;
+
+/* A fixed seed pseudo-random sequence, the same on all platforms */
+static apr_uint32_t bench_seed;
+
+static apr_uint32_t bench_rand(void)
+{
+    bench_seed = bench_seed * 1103515245 + 12345;
+    return (bench_seed >> 16) & 0x7fff;
+}
+
+static void bench_data(bench_ctx_t *ctx)
+{
+    apr_size_t i, next, len;
+
+    bench_seed = 42;
+    ctx->data = apr_palloc(ctx->pool, DATA_SIZE);
+    for (i = 0, next = 0; i < DATA_SIZE; i++) {
+        if (i == next) {
+            ctx->data[i] = '\n';
+            next = i + 20 + bench_rand() % 100;
+        }
+        else {
+            ctx->data[i] = 'a' + bench_rand() % 26;
+        }
+    }
+
+    ctx->parts = apr_palloc(ctx->pool, DATA_SIZE);
+    for (i = 0; i < DATA_SIZE - sizeof(BOUNDARY); ) {
+        len = 1000 + bench_rand() % 8000;
+        if (len > DATA_SIZE - sizeof(BOUNDARY) - i) {
+            len = DATA_SIZE - sizeof(BOUNDARY) - i;
+        }
+        memcpy(ctx->parts + i, ctx->data + i, len);
+        i += len;
+        memcpy(ctx->parts + i, BOUNDARY, sizeof(BOUNDARY) - 1);
+        i += sizeof(BOUNDARY) - 1;
+    }
+    ctx->parts_len = i;
+}
+
+/* A brigade of the data in buckets of APR_BUCKET_BUFF_SIZE bytes, as
+ * read from the network, though not copied.
+ */
+static apr_bucket_brigade *bench_brigade(bench_ctx_t *ctx, apr_pool_t *p,
+                                         const char *data, apr_size_t len)
+{
+    apr_bucket_brigade *bb = apr_brigade_create(p, ctx->ba);
+    apr_size_t n;
+
+    for (; len; data += n, len -= n) {
+        n = (len < APR_BUCKET_BUFF_SIZE) ? len : APR_BUCKET_BUFF_SIZE;
+        APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_immortal_create(data, n,
+                                                               ctx->ba));
+    }
+    return bb;
+}
+
+static apr_size_t bench_alloc(bench_ctx_t *ctx, int n, apr_size_t size)
+{
+    void *blocks[16];
+    int i, j;
+
+    for (i = 0; i < n; i += 16) {
+        for (j = 0; j < 16; j++) {
+            blocks[j] = apr_bucket_alloc(size, ctx->ba);
+        }
+        for (j = 0; j < 16; j++) {
+            apr_bucket_free(blocks[j]);
+        }
+    }
+    return 0;
+}
+
+static apr_size_t bench_alloc_small(bench_ctx_t *ctx, apr_pool_t *p, int n)
+{
+    return bench_alloc(ctx, n, sizeof(apr_bucket));
+}
+
+static apr_size_t bench_alloc_8k(bench_ctx_t *ctx, apr_pool_t *p, int n)
+{
+    return bench_alloc(ctx, n, APR_BUCKET_BUFF_SIZE);
+}
+
+static apr_size_t bench_alloc_64k(bench_ctx_t *ctx, apr_pool_t *p, int n)
+{
+    return bench_alloc(ctx, n, 60000);
+}
+
+static apr_size_t bench_brigade_write(bench_ctx_t *ctx, apr_pool_t *p, int n)
+{
+    apr_bucket_brigade *bb = apr_brigade_create(p, ctx->ba);
+    apr_size_t off = 0, total = 0;
+    int i;
+
+    for (i = 0; i < n; i++) {
+        apr_size_t len = 1 + (off & 63);
+
+        if (off + len > DATA_SIZE) {
+            apr_brigade_cleanup(bb);
+            off = 0;
+        }
+        apr_brigade_write(bb, NULL, NULL, ctx->data + off, len);
+        off += len;
+        total += len;
+    }
+    apr_brigade_destroy(bb);
+    return total;
+}
+
+static apr_size_t bench_split_line(bench_ctx_t *ctx, apr_pool_t *p, int n)
+{
+    apr_bucket_brigade *bb = NULL, *line = apr_brigade_create(p, ctx->ba);
+    apr_size_t total = 0;
+    int i;
+
+    for (i = 0; i < n; i++) {
+        apr_off_t len;
+
+        if (!bb || APR_BRIGADE_EMPTY(bb)) {
+            bb = bench_brigade(ctx, p, ctx->data, DATA_SIZE);
+        }
+        apr_brigade_split_line(line, bb, APR_BLOCK_READ, MAX_LINE);
+        apr_brigade_length(line, 0, &len);
+        total += (apr_size_t)len;
+        apr_brigade_cleanup(line);
+    }
+    return total;
+}
+
+static apr_size_t bench_split_boundary(bench_ctx_t *ctx, apr_pool_t *p,
+                                       int n)
+{
+    apr_bucket_brigade *bb = NULL, *part = apr_brigade_create(p, ctx->ba);
+    apr_size_t total = 0;
+    int i;
+
+    for (i = 0; i < n; i++) {
+        apr_off_t len;
+
+        if (!bb || APR_BRIGADE_EMPTY(bb)) {
+            bb = bench_brigade(ctx, p, ctx->parts, ctx->parts_len);
+        }
+        apr_brigade_split_boundary(part, bb, APR_BLOCK_READ, BOUNDARY,
+                                   sizeof(BOUNDARY) - 1, DATA_SIZE);
+        apr_brigade_length(part, 0, &len);
+        total += (apr_size_t)len + sizeof(BOUNDARY) - 1;
+        apr_brigade_cleanup(part);
+    }
+    return total;
+}
+
+/* One operation: partition a brigade of 256 1K buckets at 64 offsets */
+static apr_size_t bench_partition(bench_ctx_t *ctx, apr_pool_t *p, int n)
+{
+    apr_bucket_brigade *bb = apr_brigade_create(p, ctx->ba);
+    apr_bucket *e;
+    int i, j;
+
+    bench_seed = 42;
+    for (i = 0; i < n; i++) {
+        for (j = 0; j < 256; j++) {
+            APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_immortal_create(
+                                    ctx->data + j * 1024, 1024, ctx->ba));
+        }
+        for (j = 0; j < 64; j++) {
+            apr_brigade_partition(bb, (bench_rand() * 8) % (256 * 1024),
+                                  &e);
+        }
+        apr_brigade_cleanup(bb);
+    }
+    apr_brigade_destroy(bb);
+    return 0;
+}
+
+static apr_size_t bench_flatten(bench_ctx_t *ctx, apr_pool_t *p, int n)
+{
+    apr_bucket_brigade *bb = bench_brigade(ctx, p, ctx->data, 256 * 1024);
+    char *buf = apr_palloc(p, 256 * 1024);
+    apr_size_t len, total = 0;
+    int i;
+
+    for (i = 0; i < n; i++) {
+        len = 256 * 1024;
+        apr_brigade_flatten(bb, buf, &len);
+        total += len;
+    }
+    return total;
+}
+
+static apr_size_t bench_to_iovec(bench_ctx_t *ctx, apr_pool_t *p, int n)
+{
+    apr_bucket_brigade *bb = apr_brigade_create(p, ctx->ba);
+    struct iovec vec[64];
+    int i, nvec;
+
+    for (i = 0; i < 64; i++) {
+        APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_heap_create(
+                                ctx->data + i * 100, 100, NULL, ctx->ba));
+    }
+    for (i = 0; i < n; i++) {
+        nvec = 64;
+        apr_brigade_to_iovec(bb, vec, &nvec);
+    }
+    return (apr_size_t)n * 64 * 100;
+}
+
+/* One operation for the following three: build a brigade of 512 pieces
+ * of 20 bytes, measure it, partition it in the middle and gather it in
+ * an iovec, as a protocol writer does.
+ */
+#define PIECES 512
+#define PIECE_SIZE 20
+
+static apr_size_t bench_ring(bench_ctx_t *ctx, apr_pool_t *p, int n)
+{
+    apr_bucket_brigade *bb = apr_brigade_create(p, ctx->ba);
+    struct iovec vec[PIECES + 1];
+    apr_bucket *e;
+    apr_off_t len;
+    int i, j, nvec;
+
+    for (i = 0; i < n; i++) {
+        for (j = 0; j < PIECES; j++) {
+            APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_heap_create(
+                                    ctx->data + j * PIECE_SIZE, PIECE_SIZE,
+                                    NULL, ctx->ba));
+        }
+        apr_brigade_length(bb, 1, &len);
+        apr_brigade_partition(bb, len / 2 + 7, &e);
+        nvec = PIECES + 1;
+        apr_brigade_to_iovec(bb, vec, &nvec);
+        apr_brigade_cleanup(bb);
+    }
+    apr_brigade_destroy(bb);
+    return (apr_size_t)n * PIECES * PIECE_SIZE;
+}
+
+static apr_size_t bench_array(bench_ctx_t *ctx, apr_pool_t *p, int n,
+                              int write)
+{
+    apr_brigade_array_t *a = apr_brigade_array_create(p, ctx->ba);
+    struct iovec vec[PIECES + 1];
+    apr_off_t len;
+    int i, j, index, nvec;
+
+    for (i = 0; i < n; i++) {
+        for (j = 0; j < PIECES; j++) {
+            if (write) {
+                apr_brigade_array_write(a, ctx->data + j * PIECE_SIZE,
+                                        PIECE_SIZE);
+            }
+            else {
+                apr_brigade_array_insert(a, apr_bucket_heap_create(
+                                         ctx->data + j * PIECE_SIZE,
+                                         PIECE_SIZE, NULL, ctx->ba));
+            }
+        }
+        apr_brigade_array_length(a, 1, &len);
+        apr_brigade_array_partition(a, len / 2 + 7, &index);
+        nvec = PIECES + 1;
+        apr_brigade_array_to_iovec(a, vec, &nvec);
+        apr_brigade_array_cleanup(a);
+    }
+    apr_brigade_array_destroy(a);
+    return (apr_size_t)n * PIECES * PIECE_SIZE;
+}
+
+static apr_size_t bench_array_buckets(bench_ctx_t *ctx, apr_pool_t *p, int n)
+{
+    return bench_array(ctx, p, n, 0);
+}
+
+static apr_size_t bench_array_writes(bench_ctx_t *ctx, apr_pool_t *p, int n)
+{
+    return bench_array(ctx, p, n, 1);
+}
+
+/* One operation: read the whole benchmark file through a FILE bucket */
+static apr_size_t bench_file(bench_ctx_t *ctx, apr_pool_t *p, int n,
+                             int mmap)
+{
+    apr_bucket_brigade *bb = apr_brigade_create(p, ctx->ba);
+    apr_file_t *f;
+    apr_size_t total = 0;
+    int i;
+
+    if (apr_file_open(&f, ctx->fname, APR_FOPEN_READ, APR_OS_DEFAULT,
+                      p) != APR_SUCCESS) {
+        return 0;
+    }
+    for (i = 0; i < n; i++) {
+        apr_bucket *e = apr_bucket_file_create(f, 0, DATA_SIZE, p, ctx->ba);
+
+        apr_bucket_file_enable_mmap(e, mmap);
+        APR_BRIGADE_INSERT_TAIL(bb, e);
+        while (!APR_BRIGADE_EMPTY(bb)) {
+            const char *str;
+            apr_size_t len;
+
+            e = APR_BRIGADE_FIRST(bb);
+            if (apr_bucket_read(e, &str, &len, APR_BLOCK_READ)
+                    != APR_SUCCESS) {
+                apr_brigade_cleanup(bb);
+                break;
+            }
+            total += len;
+            apr_bucket_delete(e);
+        }
+    }
+    apr_file_close(f);
+    return total;
+}
+
+static apr_size_t bench_file_read(bench_ctx_t *ctx, apr_pool_t *p, int n)
+{
+    return bench_file(ctx, p, n, 0);
+}
+
+static apr_size_t bench_file_mmap(bench_ctx_t *ctx, apr_pool_t *p, int n)
+{
+    return bench_file(ctx, p, n, 1);
+}
+
+static const bench_t benches[] = {
+    { "alloc_small",        bench_alloc_small,      4000000, 1 },
+    { "alloc_8k",           bench_alloc_8k,         4000000, 1 },
+    { "alloc_64k",          bench_alloc_64k,        1000000, 1 },
+    { "brigade_write",      bench_brigade_write,    4000000, 1 },
+    { "split_line",         bench_split_line,       1000000, 1 },
+    { "split_boundary",     bench_split_boundary,   200000,  1 },
+    { "partition_256x64",   bench_partition,        20000,   1 },
+    { "flatten_256k",       bench_flatten,          5000,    1 },
+    { "to_iovec_64",        bench_to_iovec,         1000000, 1 },
+    { "ring_512x20",        bench_ring,             10000,   1 },
+    { "array_512x20",       bench_array_buckets,    10000,   1 },
+    { "array_write_512x20", bench_array_writes,     10000,   1 },
+    { "file_read_4m",       bench_file_read,        200,     0 },
+    { "file_mmap_4m",       bench_file_mmap,        200,     0 },
+    { NULL }
+};
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "usage: %s [-c] [-s scale] [-r repeat] [workload ...]\n"
+            "  -c         print the results as CSV\n"
+            "  -s scale   multiply the number of operations (default 1)\n"
+            "  -r repeat  repetitions, the fastest is reported (default 5)\n"
+            "workloads:", argv0);
+    {
+        const bench_t *b;
+
+        for (b = benches; b->name; b++) {
+            fprintf(stderr, " %s", b->name);
+        }
+    }
+    fprintf(stderr, "\n");
+    exit(1);
+}
+
+static int selected(const char *name, apr_getopt_t *opt)
+{
+    int i;
+
+    if (opt->ind == opt->argc) {
+        return 1;
+    }
+    for (i = opt->ind; i < opt->argc; i++) {
+        if (!strcmp(opt->argv[i], name)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Run a workload repeat times with the allocator in ctx->ba, and report
+ * the fastest run.
+ */
+static void run_bench(bench_ctx_t *ctx, const bench_t *b, const char *alloc,
+                      int ops, int repeat, int csv)
+{
+    apr_interval_time_t best = 0;
+    apr_size_t bytes = 0;
+    double ns, bps;
+    int r;
+
+    for (r = 0; r < repeat; r++) {
+        apr_pool_t *p;
+        apr_time_t start;
+        apr_interval_time_t t;
+
+        apr_pool_create(&p, ctx->pool);
+        start = apr_time_now();
+        bytes = b->run(ctx, p, ops);
+        t = apr_time_now() - start;
+        apr_pool_destroy(p);
+        if (!r || t < best) {
+            best = t;
+        }
+    }
+    if (best < 1) {
+        best = 1;
+    }
+
+    ns = (double)best * 1000 / ops;
+    bps = (double)bytes * APR_USEC_PER_SEC / best;
+    if (csv) {
+        printf("%s,%s,%d,%" APR_SIZE_T_FMT ",%.1f,%.0f\n",
+               b->name, alloc, ops, bytes, ns, bps);
+    }
+    else if (bytes) {
+        printf("%-20s %-9s %10d %12.1f %12.1f\n", b->name, alloc, ops, ns,
+               bps / (1024 * 1024));
+    }
+    else {
+        printf("%-20s %-9s %10d %12.1f %12s\n", b->name, alloc, ops, ns,
+               "-");
+    }
+    fflush(stdout);
+}
+
+int main(int argc, const char * const *argv)
+{
+    bench_ctx_t ctx;
+    apr_bucket_alloc_opts_t opts;
+    apr_getopt_t *opt;
+    apr_file_t *f;
+    const bench_t *b;
+    const char *arg;
+    char c;
+    double scale = 1;
+    int repeat = 5, csv = 0;
+    apr_status_t rv;
+
+    apr_app_initialize(&argc, &argv, NULL);
+    atexit(apr_terminate);
+
+    apr_pool_create(&ctx.pool, NULL);
+    ctx.ba_default = apr_bucket_alloc_create(ctx.pool);
+    memset(&opts, 0, sizeof(opts));
+    opts.max_free = CACHE_MAX_FREE;
+    opts.min_free = CACHE_MIN_FREE;
+    ctx.ba_cached = apr_bucket_alloc_create_ex2(NULL, ctx.pool, &opts);
+
+    apr_getopt_init(&opt, ctx.pool, argc, argv);
+    while ((rv = apr_getopt(opt, "cs:r:", &c, &arg)) == APR_SUCCESS) {
+        switch (c) {
+        case 'c':
+            csv = 1;
+            break;
+        case 's':
+            scale = atof(arg);
+            break;
+        case 'r':
+            repeat = atoi(arg);
+            break;
+        }
+    }
+    if (rv != APR_EOF || scale <= 0 || repeat <= 0) {
+        usage(argv[0]);
+    }
+
+    bench_data(&ctx);
+    ctx.fname = "benchbuckets.bin";
+    rv = apr_file_open(&f, ctx.fname, APR_FOPEN_WRITE | APR_FOPEN_CREATE
+                       | APR_FOPEN_TRUNCATE, APR_OS_DEFAULT, ctx.pool);
+    if (rv == APR_SUCCESS) {
+        rv = apr_file_write_full(f, ctx.data, DATA_SIZE, NULL);
+        apr_file_close(f);
+    }
+    if (rv != APR_SUCCESS) {
+        fprintf(stderr, "cannot write %s\n", ctx.fname);
+        return 1;
+    }
+
+    if (csv) {
+        printf("workload,allocator,ops,bytes,ns_per_op,bytes_per_sec\n");
+    }
+    else {
+        printf("%-20s %-9s %10s %12s %12s\n", "workload", "allocator",
+               "ops", "ns/op", "MB/s");
+    }
+    for (b = benches; b->name; b++) {
+        int ops = (int)(b->ops * scale);
+
+        if (!selected(b->name, opt)) {
+            continue;
+        }
+        if (ops < 1) {
+            ops = 1;
+        }
+        ctx.ba = ctx.ba_default;
+        run_bench(&ctx, b, "default", ops, repeat, csv);
+        if (b->both) {
+            ctx.ba = ctx.ba_cached;
+            run_bench(&ctx, b, "cached", ops, repeat, csv);
+        }
+    }
+
+    apr_file_remove(ctx.fname, ctx.pool);
+    apr_pool_destroy(ctx.pool);
+    return 0;
+}
@@ -18,6 +18,9 @@
 #include "testutil.h"
 #include "apr_buckets.h"
 #include "apr_strings.h"
+#include "apr_thread_proc.h"
+#include "apr_md5.h"
+#include "apr_sha1.h"
 
 static void test_create(abts_case *tc, void *data)
 {
@@ -322,6 +325,45 @@ static void test_splitboundary(abts_case *tc, void *data)
     apr_brigade_destroy(bout);
     apr_brigade_destroy(bin);
 
+    /* false partial match at the end of the bucket */
+    bin = make_simple_brigade(ba, "xx--bo--bou", "ndary tail");
+    bout = apr_brigade_create(p, ba);
+
+    apr_assert_success(tc, "split boundary",
+                       apr_brigade_split_boundary(bout, bin,
+                                              APR_BLOCK_READ, "--boundary",
+                                              APR_BUCKETS_STRING, 100));
+
+    flatten_match(tc, "split boundary", bout, "xx--bo");
+    flatten_match(tc, "remainder", bin, " tail");
+
+    apr_brigade_destroy(bout);
+    apr_brigade_destroy(bin);
+
+    /* one byte buckets */
+    {
+        const char *str = "a--b--boundaryz";
+        apr_size_t i;
+
+        bin = apr_brigade_create(p, ba);
+        for (i = 0; str[i]; i++) {
+            APR_BRIGADE_INSERT_TAIL(bin,
+                                    apr_bucket_immortal_create(str + i, 1, ba));
+        }
+        bout = apr_brigade_create(p, ba);
+
+        apr_assert_success(tc, "split boundary",
+                           apr_brigade_split_boundary(bout, bin,
+                                                  APR_BLOCK_READ, "--boundary",
+                                                  APR_BUCKETS_STRING, 100));
+
+        flatten_match(tc, "split boundary", bout, "a--b");
+        flatten_match(tc, "remainder", bin, "z");
+
+        apr_brigade_destroy(bout);
+        apr_brigade_destroy(bin);
+    }
+
     apr_bucket_alloc_destroy(ba);
 }
 
@@ -555,6 +597,51 @@ static void test_truncfile(abts_case *tc, void *data)
     apr_bucket_alloc_destroy(ba);
 }
 
+static void test_file_read_ahead(abts_case *tc, void *data)
+{
+    apr_bucket_alloc_t *ba = apr_bucket_alloc_create(p);
+    apr_bucket_brigade *bb = apr_brigade_create(p, ba);
+    apr_file_t *f = make_test_file(tc, "readahead.bin", "");
+    apr_bucket *e;
+    apr_off_t offset = 0;
+    apr_size_t len, i;
+    apr_status_t rv;
+    char *contents, *flat;
+
+    len = 3 * APR_BUCKET_BUFF_SIZE + 100;
+    contents = apr_palloc(p, len);
+    for (i = 0; i < len; i++) {
+        contents[i] = 'a' + i % 26;
+    }
+    APR_ASSERT_SUCCESS(tc, "write test file",
+                       apr_file_write_full(f, contents, len, NULL));
+    APR_ASSERT_SUCCESS(tc, "rewind test file",
+                       apr_file_seek(f, APR_SET, &offset));
+
+    e = apr_bucket_file_create(f, 0, len, p, ba);
+    APR_BRIGADE_INSERT_TAIL(bb, e);
+    apr_bucket_file_enable_mmap(e, 0);
+    rv = apr_bucket_file_set_read_ahead(e, 2);
+    ABTS_ASSERT(tc, "set read ahead", rv == APR_SUCCESS || rv == APR_ENOTIMPL);
+
+    APR_ASSERT_SUCCESS(tc, "flatten brigade",
+                       apr_brigade_pflatten(bb, &flat, &i, p));
+    ABTS_SIZE_EQUAL(tc, len, i);
+    ABTS_ASSERT(tc, "file contents", memcmp(flat, contents, len) == 0);
+
+    if (rv == APR_SUCCESS) {
+        offset = 0;
+        APR_ASSERT_SUCCESS(tc, "get file offset",
+                           apr_file_seek(f, APR_CUR, &offset));
+        ABTS_ASSERT(tc, "file offset unchanged", offset == 0);
+    }
+
+    apr_file_close(f);
+    apr_file_remove("readahead.bin", p);
+    apr_brigade_destroy(bb);
+    apr_bucket_alloc_destroy(ba);
+}
+
 static const char hello[] = "hello, world";
 
 static void test_partition(abts_case *tc, void *data)
@@ -630,6 +717,262 @@ static void test_write_putstrs(abts_case *tc, void *data)
     apr_bucket_alloc_destroy(ba);
 }
 
+static void test_coalesce(abts_case *tc, void *data)
+{
+    apr_bucket_alloc_t *ba = apr_bucket_alloc_create(p);
+    apr_bucket_brigade *bb = apr_brigade_create(p, ba);
+    const char *large = "0123456789abcdefghij";
+    apr_bucket *e;
+    int count = 0;
+
+    APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_immortal_create("he", 2, ba));
+    APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_immortal_create("llo", 3, ba));
+    APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_transient_create(", ", 2, ba));
+    APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_pool_create("wor", 3, p, ba));
+    APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_flush_create(ba));
+    APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_heap_create("ld", 2, NULL, ba));
+    APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_immortal_create(large, 20, ba));
+    APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_immortal_create("!", 1, ba));
+    APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_immortal_create("?", 1, ba));
+    APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_immortal_create("#", 1, ba));
+
+    APR_ASSERT_SUCCESS(tc, "coalesce brigade",
+                       apr_brigade_coalesce(bb, 8, 9));
+
+    for (e = APR_BRIGADE_FIRST(bb); e != APR_BRIGADE_SENTINEL(bb);
+         e = APR_BUCKET_NEXT(e)) {
+        count++;
+    }
+    ABTS_INT_EQUAL(tc, 6, count);
+
+    /* the first run is cut at the chunk size */
+    e = APR_BRIGADE_FIRST(bb);
+    ABTS_ASSERT(tc, "merged bucket", APR_BUCKET_IS_HEAP(e));
+    ABTS_SIZE_EQUAL(tc, 7, e->length);
+    e = APR_BUCKET_NEXT(e);
+    ABTS_ASSERT(tc, "single bucket kept", APR_BUCKET_IS_POOL(e));
+    e = APR_BUCKET_NEXT(e);
+    ABTS_ASSERT(tc, "metadata kept", APR_BUCKET_IS_FLUSH(e));
+    e = APR_BUCKET_NEXT(e);
+    ABTS_SIZE_EQUAL(tc, 2, e->length);
+    e = APR_BUCKET_NEXT(e);
+    ABTS_ASSERT(tc, "large bucket kept", APR_BUCKET_IS_IMMORTAL(e));
+    e = APR_BUCKET_NEXT(e);
+    ABTS_ASSERT(tc, "last run merged", APR_BUCKET_IS_HEAP(e));
+    ABTS_SIZE_EQUAL(tc, 3, e->length);
+
+    flatten_match(tc, "coalesced data", bb,
+                  "hello, world0123456789abcdefghij!?#");
+
+    apr_brigade_destroy(bb);
+    apr_bucket_alloc_destroy(ba);
+}
+
+static void test_cursor(abts_case *tc, void *data)
+{
+    apr_bucket_alloc_t *ba = apr_bucket_alloc_create(p);
+    apr_bucket_brigade *bb = apr_brigade_create(p, ba);
+    apr_brigade_cursor_t cur;
+    struct iovec vec[8];
+    const char *line;
+    char buf[8];
+    apr_size_t len;
+    int nvec = 8;
+
+    APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_immortal_create("GET /a", 6, ba));
+    APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_immortal_create(" HTTP", 5, ba));
+    APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_flush_create(ba));
+    APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_immortal_create("/1.1\r", 5, ba));
+    APR_BRIGADE_INSERT_TAIL(bb,
+                            apr_bucket_immortal_create("\nHost: x\r\n", 10, ba));
+
+    apr_brigade_cursor_init(&cur, bb, APR_BLOCK_READ);
+
+    /* a delimiter spanning buckets */
+    APR_ASSERT_SUCCESS(tc, "find line",
+                       apr_brigade_cursor_find(&cur, "\r\n", 2, &len));
+    ABTS_SIZE_EQUAL(tc, 17, len);
+
+    APR_ASSERT_SUCCESS(tc, "view line",
+                       apr_brigade_cursor_view(&cur, len, &line, p));
+    ABTS_STR_NEQUAL(tc, "GET /a HTTP/1.1\r\n", line, len);
+
+    APR_ASSERT_SUCCESS(tc, "line iovec",
+                       apr_brigade_cursor_iovec(&cur, len, vec, &nvec));
+    ABTS_INT_EQUAL(tc, 4, nvec);
+    ABTS_SIZE_EQUAL(tc, 1, vec[3].iov_len);
+
+    /* consuming trims the last bucket in place */
+    APR_ASSERT_SUCCESS(tc, "consume line",
+                       apr_brigade_cursor_consume(&cur, len));
+    ABTS_ASSERT(tc, "one bucket left",
+                APR_BRIGADE_FIRST(bb) == APR_BRIGADE_LAST(bb));
+
+    APR_ASSERT_SUCCESS(tc, "find line",
+                       apr_brigade_cursor_find(&cur, "\r\n", 2, &len));
+    ABTS_SIZE_EQUAL(tc, 9, len);
+    APR_ASSERT_SUCCESS(tc, "view line",
+                       apr_brigade_cursor_view(&cur, len, &line, p));
+    ABTS_STR_NEQUAL(tc, "Host: x\r\n", line, len);
+    APR_ASSERT_SUCCESS(tc, "consume line",
+                       apr_brigade_cursor_consume(&cur, len));
+    ABTS_ASSERT(tc, "brigade consumed", APR_BRIGADE_EMPTY(bb));
+
+    /* a search resumed as data comes in */
+    APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_immortal_create("abc\r", 4, ba));
+    ABTS_INT_EQUAL(tc, APR_INCOMPLETE,
+                   apr_brigade_cursor_find(&cur, "\r\n", 2, &len));
+    ABTS_SIZE_EQUAL(tc, 4, len);
+    APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_immortal_create("\nrest", 5, ba));
+    APR_ASSERT_SUCCESS(tc, "find line",
+                       apr_brigade_cursor_find(&cur, "\r\n", 2, &len));
+    ABTS_SIZE_EQUAL(tc, 5, len);
+
+    len = 3;
+    APR_ASSERT_SUCCESS(tc, "peek", apr_brigade_cursor_peek(&cur, buf, &len));
+    ABTS_STR_NEQUAL(tc, "abc", buf, len);
+
+    ABTS_INT_EQUAL(tc, APR_INCOMPLETE,
+                   apr_brigade_cursor_consume(&cur, 100));
+    ABTS_ASSERT(tc, "brigade consumed", APR_BRIGADE_EMPTY(bb));
+
+    apr_brigade_destroy(bb);
+    apr_bucket_alloc_destroy(ba);
+}
+
+static void test_reserve(abts_case *tc, void *data)
+{
+    apr_bucket_alloc_t *ba = apr_bucket_alloc_create(p);
+    apr_bucket_brigade *bb = apr_brigade_create(p, ba);
+    char *ptr, *first;
+    apr_size_t avail;
+
+    APR_ASSERT_SUCCESS(tc, "reserve",
+                       apr_brigade_reserve(bb, 5, &ptr, &avail));
+    ABTS_ASSERT(tc, "buffer size", avail >= APR_BUCKET_BUFF_SIZE);
+    ABTS_ASSERT(tc, "nothing written yet",
+                APR_BRIGADE_LAST(bb)->length == 0);
+    memcpy(ptr, "hello", 5);
+    APR_ASSERT_SUCCESS(tc, "commit", apr_brigade_commit(bb, 5));
+    first = ptr;
+
+    /* the same buffer is reused */
+    APR_ASSERT_SUCCESS(tc, "reserve",
+                       apr_brigade_reserve(bb, 7, &ptr, &avail));
+    ABTS_PTR_EQUAL(tc, first + 5, ptr);
+    memcpy(ptr, ", world", 7);
+    APR_ASSERT_SUCCESS(tc, "commit", apr_brigade_commit(bb, 7));
+
+    APR_ASSERT_SUCCESS(tc, "write", apr_brigade_write(bb, NULL, NULL, "!", 1));
+    flatten_match(tc, "reserved data", bb, "hello, world!");
+
+    ABTS_INT_EQUAL(tc, APR_EINVAL, apr_brigade_commit(bb, avail));
+
+    /* more than is left needs a new bucket */
+    APR_ASSERT_SUCCESS(tc, "reserve",
+                       apr_brigade_reserve(bb, avail, &ptr, &avail));
+    ABTS_ASSERT(tc, "new buffer", ptr != first + 13);
+    memset(ptr, 'x', avail);
+    APR_ASSERT_SUCCESS(tc, "commit", apr_brigade_commit(bb, avail));
+    ABTS_ASSERT(tc, "two buckets",
+                APR_BUCKET_NEXT(APR_BRIGADE_FIRST(bb)) == APR_BRIGADE_LAST(bb));
+    ABTS_SIZE_EQUAL(tc, avail, APR_BRIGADE_LAST(bb)->length);
+
+    apr_brigade_destroy(bb);
+    apr_bucket_alloc_destroy(ba);
+}
+
+static int atomic_freed;
+
+static void atomic_free(void *data)
+{
+    atomic_freed++;
+}
+
+#define ATOMIC_THREADS 4
+
+typedef struct {
+    apr_allocator_t *allocator;
+    apr_bucket_alloc_t *list;
+    apr_bucket *e;
+} atomic_ctx_t;
+
+static void * APR_THREAD_FUNC atomic_thread(apr_thread_t *thd, void *data)
+{
+    atomic_ctx_t *ctx = data;
+    int i;
+
+    for (i = 0; i < 10000; i++) {
+        apr_bucket *c;
+
+        apr_bucket_copy(ctx->e, &c);
+        apr_bucket_destroy(c);
+    }
+    apr_bucket_destroy(ctx->e);
+    apr_bucket_alloc_destroy(ctx->list);
+
+    return NULL;
+}
+
+static void test_atomic(abts_case *tc, void *data)
+{
+    apr_bucket_alloc_t *ba = apr_bucket_alloc_create(p);
+    apr_bucket_brigade *bb = apr_brigade_create(p, ba);
+    atomic_ctx_t ctx[ATOMIC_THREADS];
+    apr_bucket *e;
+    int i;
+#if APR_HAS_THREADS
+    apr_thread_t *threads[ATOMIC_THREADS];
+    apr_status_t rv;
+#endif
+
+    atomic_freed = 0;
+    e = apr_bucket_atomic_create(hello, strlen(hello), atomic_free, ba);
+    ABTS_PTR_NOTNULL(tc, e);
+
+    for (i = 0; i < ATOMIC_THREADS; i++) {
+        apr_allocator_create(&ctx[i].allocator);
+        ctx[i].list = apr_bucket_alloc_create_ex(ctx[i].allocator);
+        APR_ASSERT_SUCCESS(tc, "copy to another allocator",
+                           apr_bucket_atomic_copy(e, ctx[i].list, &ctx[i].e));
+        ABTS_PTR_EQUAL(tc, ctx[i].list, ctx[i].e->list);
+    }
+
+    /* shared data survives the original bucket */
+    APR_BRIGADE_INSERT_TAIL(bb, e);
+    apr_bucket_split(e, 5);
+    flatten_match(tc, "atomic data", bb, hello);
+    apr_brigade_cleanup(bb);
+    ABTS_INT_EQUAL(tc, 0, atomic_freed);
+
+#if APR_HAS_THREADS
+    for (i = 0; i < ATOMIC_THREADS; i++) {
+        APR_ASSERT_SUCCESS(tc, "create thread",
+                           apr_thread_create(&threads[i], NULL, atomic_thread,
+                                             &ctx[i], p));
+    }
+    for (i = 0; i < ATOMIC_THREADS; i++) {
+        apr_thread_join(&rv, threads[i]);
+    }
+#else
+    for (i = 0; i < ATOMIC_THREADS; i++) {
+        atomic_thread(NULL, &ctx[i]);
+    }
+#endif
+    ABTS_INT_EQUAL(tc, 1, atomic_freed);
+
+    for (i = 0; i < ATOMIC_THREADS; i++) {
+        apr_allocator_destroy(ctx[i].allocator);
+    }
+
+    e = apr_bucket_heap_create(hello, strlen(hello), NULL, ba);
+    ABTS_INT_EQUAL(tc, APR_EINVAL, apr_bucket_atomic_copy(e, ba, &e));
+    apr_bucket_destroy(e);
+
+    apr_brigade_destroy(bb);
+    apr_bucket_alloc_destroy(ba);
+}
+
 static void test_iovec(abts_case *tc, void *data)
 {
     apr_bucket_alloc_t *ba = apr_bucket_alloc_create(p);
@@ -657,6 +1000,965 @@ static void test_iovec(abts_case *tc, void *data)
     apr_bucket_alloc_destroy(ba);
 }
 
+static void test_alloc_classes(abts_case *tc, void *data)
+{
+    apr_bucket_alloc_opts_t opts;
+    apr_bucket_alloc_t *ba;
+    apr_bucket_brigade *bb;
+    void *mem[4], *again;
+    int n;
+
+    memset(&opts, 0, sizeof opts);
+    opts.max_free = 64 * 1024;
+    opts.min_free = 16 * 1024;
+
+    ba = apr_bucket_alloc_create_ex2(NULL, p, &opts);
+    ABTS_PTR_NOTNULL(tc, ba);
+
+    /* a freed node is handed out again to the same size class */
+    mem[0] = apr_bucket_alloc(10000, ba);
+    ABTS_PTR_NOTNULL(tc, mem[0]);
+    memset(mem[0], 'a', 10000);
+    apr_bucket_free(mem[0]);
+    again = apr_bucket_alloc(9000, ba);
+    ABTS_PTR_EQUAL(tc, mem[0], again);
+    apr_bucket_free(again);
+
+    /* going over the high watermark must keep the allocator sane */
+    for (n = 0; n < 4; n++) {
+        mem[n] = apr_bucket_alloc(30000, ba);
+        ABTS_PTR_NOTNULL(tc, mem[n]);
+        memset(mem[n], 'b', 30000);
+    }
+    for (n = 0; n < 4; n++) {
+        apr_bucket_free(mem[n]);
+    }
+
+    /* and the buckets still work on top of it */
+    bb = apr_brigade_create(p, ba);
+    for (n = 0; n < COUNT; n++) {
+        apr_assert_success(tc, "brigade_write",
+                           apr_brigade_write(bb, NULL, NULL,
+                                             THESTR, sizeof THESTR));
+    }
+    apr_brigade_destroy(bb);
+
+    apr_bucket_alloc_destroy(ba);
+}
+
+static void test_alloc_own_allocator(abts_case *tc, void *data)
+{
+    apr_allocator_t *allocator;
+    apr_bucket_alloc_t *ba;
+    apr_memnode_t *node;
+    apr_pool_t *subp;
+    void *mem;
+
+    apr_assert_success(tc, "allocator create",
+                       apr_allocator_create(&allocator));
+    apr_assert_success(tc, "pool create", apr_pool_create(&subp, p));
+
+    /* the caller's allocator must survive the list, destroyed explicitly */
+    ba = apr_bucket_alloc_create_ex2(allocator, subp, NULL);
+    ABTS_PTR_NOTNULL(tc, ba);
+    mem = apr_bucket_alloc(100, ba);
+    ABTS_PTR_NOTNULL(tc, mem);
+    apr_bucket_free(mem);
+    apr_bucket_alloc_destroy(ba);
+
+    node = apr_allocator_alloc(allocator, 8192);
+    ABTS_PTR_NOTNULL(tc, node);
+    apr_allocator_free(allocator, node);
+
+    /* or by its pool's cleanup */
+    ba = apr_bucket_alloc_create_ex2(allocator, subp, NULL);
+    ABTS_PTR_NOTNULL(tc, ba);
+    apr_pool_destroy(subp);
+
+    node = apr_allocator_alloc(allocator, 8192);
+    ABTS_PTR_NOTNULL(tc, node);
+    apr_allocator_free(allocator, node);
+
+    apr_allocator_destroy(allocator);
+}
+
+static void test_alloc_stats(abts_case *tc, void *data)
+{
+    apr_bucket_alloc_opts_t opts;
+    apr_bucket_alloc_stats_t stats;
+    apr_bucket_alloc_t *ba;
+    apr_bucket_brigade *bb;
+    apr_bucket *e;
+    apr_file_t *f;
+    void *small, *large;
+    const char *str;
+    apr_size_t len;
+
+    ba = apr_bucket_alloc_create(p);
+    ABTS_INT_EQUAL(tc, APR_EINVAL, apr_bucket_alloc_stats_get(ba, &stats));
+    apr_bucket_alloc_destroy(ba);
+
+    memset(&opts, 0, sizeof opts);
+    opts.max_free = 64 * 1024;
+    opts.min_free = 16 * 1024;
+    opts.stats = 1;
+    ba = apr_bucket_alloc_create_ex2(NULL, p, &opts);
+    ABTS_PTR_NOTNULL(tc, ba);
+
+    APR_ASSERT_SUCCESS(tc, "get stats", apr_bucket_alloc_stats_get(ba, &stats));
+    ABTS_SIZE_EQUAL(tc, 0, stats.in_use);
+    ABTS_SIZE_EQUAL(tc, 1, stats.blocks);
+
+    small = apr_bucket_alloc(16, ba);
+    large = apr_bucket_alloc(20000, ba);
+    APR_ASSERT_SUCCESS(tc, "get stats", apr_bucket_alloc_stats_get(ba, &stats));
+    ABTS_ASSERT(tc, "small alloc", stats.allocs[0] == 1);
+    ABTS_ASSERT(tc, "large alloc", stats.allocs[6] == 1);
+    ABTS_ASSERT(tc, "in use", stats.in_use > 20000);
+    ABTS_SIZE_EQUAL(tc, stats.in_use, stats.peak);
+
+    apr_bucket_free(small);
+    apr_bucket_free(large);
+    APR_ASSERT_SUCCESS(tc, "get stats", apr_bucket_alloc_stats_get(ba, &stats));
+    ABTS_ASSERT(tc, "small free", stats.frees[0] == 1);
+    ABTS_ASSERT(tc, "large free", stats.frees[6] == 1);
+    ABTS_SIZE_EQUAL(tc, 0, stats.in_use);
+    ABTS_ASSERT(tc, "peak kept", stats.peak > 20000);
+    ABTS_SIZE_EQUAL(tc, 1, stats.freelist);
+    ABTS_SIZE_EQUAL(tc, 1, stats.class_nodes);
+
+    large = apr_bucket_alloc(20000, ba);
+    apr_bucket_free(large);
+    APR_ASSERT_SUCCESS(tc, "get stats", apr_bucket_alloc_stats_get(ba, &stats));
+    ABTS_ASSERT(tc, "class hit", stats.class_hits == 1);
+
+    /* copies made by the brigade functions */
+    bb = apr_brigade_create(p, ba);
+    APR_ASSERT_SUCCESS(tc, "brigade_write",
+                       apr_brigade_write(bb, NULL, NULL, hello, strlen(hello)));
+    e = apr_bucket_transient_create(hello, strlen(hello), ba);
+    APR_BRIGADE_INSERT_TAIL(bb, e);
+    APR_ASSERT_SUCCESS(tc, "setaside", apr_bucket_setaside(e, p));
+    APR_ASSERT_SUCCESS(tc, "get stats", apr_bucket_alloc_stats_get(ba, &stats));
+    ABTS_ASSERT(tc, "write copied", stats.write_copied == strlen(hello));
+    ABTS_ASSERT(tc, "setaside copied", stats.setaside_copied == strlen(hello));
+    apr_brigade_cleanup(bb);
+
+    /* reads morphing a FILE bucket */
+    f = make_test_file(tc, "allocstats.txt", hello);
+    e = apr_bucket_file_create(f, 0, strlen(hello), p, ba);
+    apr_bucket_file_enable_mmap(e, 0);
+    APR_BRIGADE_INSERT_TAIL(bb, e);
+    APR_ASSERT_SUCCESS(tc, "read file bucket",
+                       apr_bucket_read(e, &str, &len, APR_BLOCK_READ));
+    APR_ASSERT_SUCCESS(tc, "get stats", apr_bucket_alloc_stats_get(ba, &stats));
+    ABTS_ASSERT(tc, "reads", stats.reads == 1);
+    ABTS_ASSERT(tc, "morphs", stats.morphs == 1);
+    ABTS_ASSERT(tc, "morph bytes", stats.morph_bytes == strlen(hello));
+    apr_brigade_destroy(bb);
+    apr_file_close(f);
+    apr_file_remove("allocstats.txt", p);
+
+    APR_ASSERT_SUCCESS(tc, "get stats", apr_bucket_alloc_stats_get(ba, &stats));
+    ABTS_SIZE_EQUAL(tc, 0, stats.in_use);
+
+    apr_bucket_alloc_destroy(ba);
+}
+
+/* Connect two sockets over the loopback interface. */
+static apr_status_t make_socket_pair(apr_socket_t **client,
+                                     apr_socket_t **server)
+{
+    apr_sockaddr_t *sa;
+    apr_socket_t *listener;
+    apr_status_t rv;
+
+    rv = apr_sockaddr_info_get(&sa, "127.0.0.1", APR_INET, 0, 0, p);
+    if (rv == APR_SUCCESS) {
+        rv = apr_socket_create(&listener, sa->family, SOCK_STREAM,
+                               APR_PROTO_TCP, p);
+    }
+    if (rv == APR_SUCCESS) {
+        rv = apr_socket_bind(listener, sa);
+    }
+    if (rv == APR_SUCCESS) {
+        rv = apr_socket_listen(listener, 1);
+    }
+    if (rv == APR_SUCCESS) {
+        rv = apr_socket_addr_get(&sa, APR_LOCAL, listener);
+    }
+    if (rv == APR_SUCCESS) {
+        rv = apr_socket_create(client, sa->family, SOCK_STREAM,
+                               APR_PROTO_TCP, p);
+    }
+    if (rv == APR_SUCCESS) {
+        rv = apr_socket_connect(*client, sa);
+    }
+    if (rv == APR_SUCCESS) {
+        rv = apr_socket_accept(server, listener, p);
+    }
+    return rv;
+}
+
+static void test_spool(abts_case *tc, void *data)
+{
+    apr_bucket_alloc_t *ba = apr_bucket_alloc_create(p);
+    apr_bucket_brigade *bb = apr_brigade_create(p, ba);
+    apr_bucket *e;
+    apr_file_t *fd;
+
+    APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_heap_create("hello", 5, NULL, ba));
+    APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_transient_create(", ", 2, ba));
+    APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_heap_create("brave", 5, NULL, ba));
+    APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_immortal_create(" ", 1, ba));
+    APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_pool_create("world", 5, p, ba));
+    APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_eos_create(ba));
+
+    APR_ASSERT_SUCCESS(tc, "spool brigade", apr_brigade_spool(bb, 5, NULL));
+
+    e = APR_BRIGADE_FIRST(bb);
+    ABTS_ASSERT(tc, "first bucket kept in memory", APR_BUCKET_IS_HEAP(e));
+    e = APR_BUCKET_NEXT(e);
+    ABTS_ASSERT(tc, "next buckets spooled together", APR_BUCKET_IS_FILE(e));
+    ABTS_SIZE_EQUAL(tc, 7, e->length);
+    e = APR_BUCKET_NEXT(e);
+    ABTS_ASSERT(tc, "immortal bucket left", APR_BUCKET_IS_IMMORTAL(e));
+    e = APR_BUCKET_NEXT(e);
+    ABTS_ASSERT(tc, "pool bucket spooled", APR_BUCKET_IS_FILE(e));
+    ABTS_SIZE_EQUAL(tc, 5, e->length);
+    ABTS_ASSERT(tc, "eos bucket left", APR_BUCKET_IS_EOS(APR_BUCKET_NEXT(e)));
+
+    flatten_match(tc, "spooled data", bb, "hello, brave world");
+    apr_brigade_cleanup(bb);
+
+    /* once spooling, smaller buckets follow to keep the data in order */
+    APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_heap_create("hello", 5, NULL, ba));
+    APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_heap_create(", brave", 7, NULL,
+                                                       ba));
+    APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_heap_create(" ", 1, NULL, ba));
+    APR_ASSERT_SUCCESS(tc, "spool brigade", apr_brigade_spool(bb, 10, NULL));
+
+    e = APR_BRIGADE_FIRST(bb);
+    ABTS_ASSERT(tc, "first bucket kept in memory", APR_BUCKET_IS_HEAP(e));
+    e = APR_BUCKET_NEXT(e);
+    ABTS_ASSERT(tc, "small bucket spooled too", APR_BUCKET_IS_FILE(e));
+    ABTS_SIZE_EQUAL(tc, 8, e->length);
+    ABTS_ASSERT(tc, "nothing left",
+                APR_BUCKET_NEXT(e) == APR_BRIGADE_SENTINEL(bb));
+    fd = ((apr_bucket_file *)e->data)->fd;
+
+    /* the next call appends to the same file */
+    APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_pool_create("world", 5, p, ba));
+    APR_ASSERT_SUCCESS(tc, "spool brigade", apr_brigade_spool(bb, 10, NULL));
+    e = APR_BRIGADE_LAST(bb);
+    ABTS_ASSERT(tc, "last bucket spooled", APR_BUCKET_IS_FILE(e));
+    ABTS_PTR_EQUAL(tc, fd, ((apr_bucket_file *)e->data)->fd);
+
+    flatten_match(tc, "spooled again", bb, "hello, brave world");
+
+    apr_brigade_destroy(bb);
+    apr_bucket_alloc_destroy(ba);
+}
+
+static apr_off_t spool_file_size(abts_case *tc, apr_bucket *e)
+{
+    apr_finfo_t finfo;
+
+    ABTS_ASSERT(tc, "spooled bucket", APR_BUCKET_IS_FILE(e));
+    APR_ASSERT_SUCCESS(tc, "stat spool file",
+                       apr_file_info_get(&finfo, APR_FINFO_SIZE,
+                                         ((apr_bucket_file *)e->data)->fd));
+    return finfo.size;
+}
+
+static void test_spool_consumed(abts_case *tc, void *data)
+{
+    apr_bucket_alloc_t *ba = apr_bucket_alloc_create(p);
+    apr_bucket_brigade *bb = apr_brigade_create(p, ba);
+    char buf[1000];
+
+    memset(buf, 'x', sizeof(buf));
+
+    APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_heap_create(buf, 1000, NULL, ba));
+    APR_ASSERT_SUCCESS(tc, "spool brigade", apr_brigade_spool(bb, 0, NULL));
+    ABTS_ASSERT(tc, "spool file size",
+                spool_file_size(tc, APR_BRIGADE_FIRST(bb)) == 1000);
+
+    /* the spooled data is consumed, the next call starts a new file */
+    apr_brigade_cleanup(bb);
+    APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_heap_create(buf, 500, NULL, ba));
+    APR_ASSERT_SUCCESS(tc, "spool brigade", apr_brigade_spool(bb, 0, NULL));
+    ABTS_ASSERT(tc, "new spool file size",
+                spool_file_size(tc, APR_BRIGADE_FIRST(bb)) == 500);
+
+    /* but appends while some of it is still around */
+    APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_heap_create(buf, 300, NULL, ba));
+    APR_ASSERT_SUCCESS(tc, "spool brigade", apr_brigade_spool(bb, 0, NULL));
+    ABTS_SIZE_EQUAL(tc, 300, APR_BRIGADE_LAST(bb)->length);
+    ABTS_ASSERT(tc, "appended spool file size",
+                spool_file_size(tc, APR_BRIGADE_LAST(bb)) == 800);
+
+    /* and starts over once it's all consumed again */
+    apr_brigade_cleanup(bb);
+    APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_heap_create(buf, 200, NULL, ba));
+    APR_ASSERT_SUCCESS(tc, "spool brigade", apr_brigade_spool(bb, 0, NULL));
+    ABTS_ASSERT(tc, "third spool file size",
+                spool_file_size(tc, APR_BRIGADE_FIRST(bb)) == 200);
+
+    apr_brigade_destroy(bb);
+    apr_bucket_alloc_destroy(ba);
+}
+
+static void test_digest(abts_case *tc, void *data)
+{
+    apr_bucket_alloc_t *ba = apr_bucket_alloc_create(p);
+    apr_bucket_brigade *in = apr_brigade_create(p, ba);
+    apr_bucket_brigade *out = apr_brigade_create(p, ba);
+    apr_brigade_digest_t md5, sha1;
+    apr_md5_ctx_t md5_ctx;
+    apr_sha1_ctx_t sha1_ctx;
+    unsigned char expect[APR_SHA1_DIGESTSIZE], result[APR_SHA1_DIGESTSIZE];
+    apr_file_t *f;
+    apr_off_t offset = 0;
+    apr_size_t len, i;
+    char *contents, *flat;
+
+    len = 3 * APR_BUCKET_BUFF_SIZE;
+    contents = apr_palloc(p, len);
+    for (i = 0; i < len; i++) {
+        contents[i] = 'a' + i % 23;
+    }
+    f = make_test_file(tc, "digest.bin", "");
+    APR_ASSERT_SUCCESS(tc, "write test file",
+                       apr_file_write_full(f, contents + 100, len - 100, NULL));
+    APR_ASSERT_SUCCESS(tc, "rewind test file",
+                       apr_file_seek(f, APR_SET, &offset));
+
+    apr_brigade_write(in, NULL, NULL, contents, 100);
+    APR_BRIGADE_INSERT_TAIL(in, apr_bucket_file_create(f, 0, len - 100,
+                                                       p, ba));
+    APR_BRIGADE_INSERT_TAIL(in, apr_bucket_eos_create(ba));
+
+    apr_md5_init(&md5_ctx);
+    apr_sha1_init(&sha1_ctx);
+    apr_brigade_digest_init(&md5, apr_brigade_digest_md5, &md5_ctx);
+    apr_brigade_digest_init(&sha1, apr_brigade_digest_sha1, &sha1_ctx);
+
+    /* pass a bit at a time, through both digests */
+    while (!APR_BRIGADE_EMPTY(in)) {
+        apr_bucket_brigade *mid = apr_brigade_create(p, ba);
+
+        APR_ASSERT_SUCCESS(tc, "md5 pass",
+                           apr_brigade_digest_pass(&md5, mid, in,
+                                                   APR_BLOCK_READ, 1000));
+        APR_ASSERT_SUCCESS(tc, "sha1 pass",
+                           apr_brigade_digest_pass(&sha1, out, mid,
+                                                   APR_BLOCK_READ, -1));
+        ABTS_ASSERT(tc, "all passed", APR_BRIGADE_EMPTY(mid));
+        apr_brigade_destroy(mid);
+    }
+    ABTS_ASSERT(tc, "md5 length", md5.length == (apr_off_t)len);
+    ABTS_ASSERT(tc, "sha1 length", sha1.length == (apr_off_t)len);
+    ABTS_ASSERT(tc, "EOS passed on",
+                APR_BUCKET_IS_EOS(APR_BRIGADE_LAST(out)));
+
+    APR_ASSERT_SUCCESS(tc, "flatten brigade",
+                       apr_brigade_pflatten(out, &flat, &i, p));
+    ABTS_SIZE_EQUAL(tc, len, i);
+    ABTS_ASSERT(tc, "contents", memcmp(flat, contents, len) == 0);
+
+    apr_md5(expect, contents, len);
+    apr_md5_final(result, &md5_ctx);
+    ABTS_ASSERT(tc, "md5 digest",
+                memcmp(expect, result, APR_MD5_DIGESTSIZE) == 0);
+
+    apr_sha1_final(result, &sha1_ctx);
+    apr_sha1_init(&sha1_ctx);
+    apr_sha1_update_binary(&sha1_ctx, (const unsigned char *)contents,
+                           (unsigned int)len);
+    apr_sha1_final(expect, &sha1_ctx);
+    ABTS_ASSERT(tc, "sha1 digest",
+                memcmp(expect, result, APR_SHA1_DIGESTSIZE) == 0);
+
+    apr_file_close(f);
+    apr_file_remove("digest.bin", p);
+    apr_brigade_destroy(in);
+    apr_brigade_destroy(out);
+    apr_bucket_alloc_destroy(ba);
+}
+
+static void test_brigade_array(abts_case *tc, void *data)
+{
+    apr_bucket_alloc_t *ba = apr_bucket_alloc_create(p);
+    apr_bucket_brigade *bb = apr_brigade_create(p, ba);
+    apr_brigade_array_t *a = apr_brigade_array_create(p, ba), *rest;
+    struct iovec vec[64];
+    apr_bucket *e;
+    apr_file_t *f;
+    apr_off_t length;
+    apr_size_t len, off, i;
+    char *contents, *flat;
+    int nvec, index, n;
+
+    len = 3 * APR_BUCKET_BUFF_SIZE + 500;
+    contents = apr_palloc(p, len);
+    for (i = 0; i < len; i++) {
+        contents[i] = 'a' + i % 23;
+    }
+    f = make_test_file(tc, "array.bin", "");
+    APR_ASSERT_SUCCESS(tc, "write test file",
+                       apr_file_write_full(f, contents + 200, len - 300, NULL));
+
+    /* small writes are packed in the array, the file follows them */
+    for (i = 0; i < 200; i += 5) {
+        APR_ASSERT_SUCCESS(tc, "write",
+                           apr_brigade_array_write(a, contents + i, 5));
+    }
+    ABTS_ASSERT(tc, "small writes packed", apr_brigade_array_count(a) < 40);
+    APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_file_create(f, 0, len - 300,
+                                                       p, ba));
+    APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_flush_create(ba));
+    apr_brigade_array_from_brigade(a, bb);
+    ABTS_ASSERT(tc, "brigade emptied", APR_BRIGADE_EMPTY(bb));
+    APR_ASSERT_SUCCESS(tc, "write",
+                       apr_brigade_array_write(a, contents + len - 100, 100));
+
+    APR_ASSERT_SUCCESS(tc, "length",
+                       apr_brigade_array_length(a, 0, &length));
+    ABTS_ASSERT(tc, "length", length == (apr_off_t)len);
+
+    /* partition within written data, the file and the last write */
+    APR_ASSERT_SUCCESS(tc, "partition at 0",
+                       apr_brigade_array_partition(a, 0, &index));
+    ABTS_INT_EQUAL(tc, 0, index);
+    APR_ASSERT_SUCCESS(tc, "partition in writes",
+                       apr_brigade_array_partition(a, 17, &index));
+    APR_ASSERT_SUCCESS(tc, "partition in file",
+                       apr_brigade_array_partition(a, 1000, &index));
+    APR_ASSERT_SUCCESS(tc, "partition in last write",
+                       apr_brigade_array_partition(a, len - 1, &index));
+    n = apr_brigade_array_count(a);
+    ABTS_INT_EQUAL(tc, n - 1, index);
+    APR_ASSERT_SUCCESS(tc, "partition at end",
+                       apr_brigade_array_partition(a, len, &index));
+    ABTS_INT_EQUAL(tc, n, index);
+    ABTS_INT_EQUAL(tc, APR_INCOMPLETE,
+                   apr_brigade_array_partition(a, len + 1, &index));
+
+    /* the iovec holds the data in order, reading the file as needed */
+    nvec = 64;
+    APR_ASSERT_SUCCESS(tc, "to iovec",
+                       apr_brigade_array_to_iovec(a, vec, &nvec));
+    for (off = 0, n = 0; n < nvec; n++) {
+        ABTS_ASSERT(tc, "iovec data",
+                    memcmp(vec[n].iov_base, contents + off,
+                           vec[n].iov_len) == 0);
+        off += vec[n].iov_len;
+    }
+    ABTS_SIZE_EQUAL(tc, len, off);
+
+    /* split in the middle and convert back to brigades */
+    APR_ASSERT_SUCCESS(tc, "partition",
+                       apr_brigade_array_partition(a, len / 2, &index));
+    rest = apr_brigade_array_split(a, index, NULL);
+    APR_ASSERT_SUCCESS(tc, "length",
+                       apr_brigade_array_length(rest, 1, &length));
+    ABTS_ASSERT(tc, "split length", length == (apr_off_t)(len - len / 2));
+
+    apr_brigade_array_to_brigade(a, bb);
+    ABTS_INT_EQUAL(tc, 0, apr_brigade_array_count(a));
+    APR_ASSERT_SUCCESS(tc, "flatten",
+                       apr_brigade_pflatten(bb, &flat, &i, p));
+    ABTS_SIZE_EQUAL(tc, len / 2, i);
+    ABTS_ASSERT(tc, "first half", memcmp(flat, contents, i) == 0);
+    apr_brigade_cleanup(bb);
+
+    apr_brigade_array_to_brigade(rest, bb);
+    for (e = APR_BRIGADE_FIRST(bb);
+         e != APR_BRIGADE_SENTINEL(bb) && !APR_BUCKET_IS_FLUSH(e);
+         e = APR_BUCKET_NEXT(e))
+        ;
+    ABTS_ASSERT(tc, "flush kept", e != APR_BRIGADE_SENTINEL(bb));
+    APR_ASSERT_SUCCESS(tc, "flatten",
+                       apr_brigade_pflatten(bb, &flat, &i, p));
+    ABTS_SIZE_EQUAL(tc, len - len / 2, i);
+    ABTS_ASSERT(tc, "second half",
+                memcmp(flat, contents + len / 2, i) == 0);
+
+    apr_brigade_array_destroy(rest);
+    apr_brigade_array_destroy(a);
+    apr_brigade_destroy(bb);
+    apr_file_close(f);
+    apr_file_remove("array.bin", p);
+    apr_bucket_alloc_destroy(ba);
+}
+
+/* Compress a file through a codec, with a FLUSH midway, then decompress
+ * the result a few bytes at a time.
+ */
+static void codec_roundtrip(abts_case *tc, apr_brigade_codec_e type)
+{
+    apr_bucket_alloc_t *ba = apr_bucket_alloc_create(p);
+    apr_bucket_brigade *in = apr_brigade_create(p, ba);
+    apr_bucket_brigade *mid = apr_brigade_create(p, ba);
+    apr_bucket_brigade *out = apr_brigade_create(p, ba);
+    apr_brigade_codec_t *codec;
+    apr_pool_t *cp;
+    apr_file_t *f;
+    apr_bucket *e;
+    apr_off_t offset = 0;
+    apr_size_t len, i;
+    apr_status_t rv;
+    char *contents, *flat;
+
+    /* the codecs must be gone before their allocator */
+    apr_pool_create(&cp, p);
+
+    rv = apr_brigade_codec_create(&codec, type, 0, 0, cp, ba);
+    if (rv == APR_ENOTIMPL) {
+        ABTS_NOT_IMPL(tc, "Skipped: codec not built");
+        apr_pool_destroy(cp);
+        apr_bucket_alloc_destroy(ba);
+        return;
+    }
+    APR_ASSERT_SUCCESS(tc, "create compressor", rv);
+
+    len = 5 * APR_BUCKET_BUFF_SIZE;
+    contents = apr_palloc(p, len);
+    for (i = 0; i < len; i++) {
+        contents[i] = 'a' + (i * 7 + i / 1000) % 26;
+    }
+    f = make_test_file(tc, "codec.bin", "");
+    APR_ASSERT_SUCCESS(tc, "write test file",
+                       apr_file_write_full(f, contents, len, NULL));
+    APR_ASSERT_SUCCESS(tc, "rewind test file",
+                       apr_file_seek(f, APR_SET, &offset));
+
+    apr_brigade_write(in, NULL, NULL, contents, 100);
+    APR_BRIGADE_INSERT_TAIL(in, apr_bucket_flush_create(ba));
+    APR_BRIGADE_INSERT_TAIL(in, apr_bucket_file_create(f, 100, len - 100,
+                                                       p, ba));
+    APR_BRIGADE_INSERT_TAIL(in, apr_bucket_eos_create(ba));
+    APR_ASSERT_SUCCESS(tc, "compress",
+                       apr_brigade_codec_process(codec, mid, in,
+                                                 APR_BLOCK_READ));
+    ABTS_ASSERT(tc, "input consumed", APR_BRIGADE_EMPTY(in));
+    ABTS_ASSERT(tc, "EOS passed on",
+                APR_BUCKET_IS_EOS(APR_BRIGADE_LAST(mid)));
+
+    /* the FLUSH comes out after the compressed first 100 bytes */
+    e = APR_BRIGADE_FIRST(mid);
+    ABTS_ASSERT(tc, "data before FLUSH", !APR_BUCKET_IS_METADATA(e));
+    ABTS_ASSERT(tc, "FLUSH passed on",
+                APR_BUCKET_IS_FLUSH(APR_BUCKET_NEXT(e)));
+    apr_bucket_delete(APR_BUCKET_NEXT(e));
+    apr_bucket_delete(APR_BRIGADE_LAST(mid));
+
+    APR_ASSERT_SUCCESS(tc, "create decompressor",
+                       apr_brigade_codec_create(&codec, type, 1, 0, cp, ba));
+    while (!APR_BRIGADE_EMPTY(mid)) {
+        rv = apr_brigade_partition(mid, 13, &e);
+        ABTS_ASSERT(tc, "partition", rv == APR_SUCCESS || rv == APR_INCOMPLETE);
+        apr_brigade_split_ex(mid, e, in);
+        APR_ASSERT_SUCCESS(tc, "decompress",
+                           apr_brigade_codec_process(codec, out, mid,
+                                                     APR_BLOCK_READ));
+        APR_BRIGADE_CONCAT(mid, in);
+    }
+    APR_BRIGADE_INSERT_TAIL(mid, apr_bucket_eos_create(ba));
+    APR_ASSERT_SUCCESS(tc, "end decompression",
+                       apr_brigade_codec_process(codec, out, mid,
+                                                 APR_BLOCK_READ));
+    ABTS_ASSERT(tc, "EOS passed on",
+                APR_BUCKET_IS_EOS(APR_BRIGADE_LAST(out)));
+
+    APR_ASSERT_SUCCESS(tc, "flatten brigade",
+                       apr_brigade_pflatten(out, &flat, &i, p));
+    ABTS_SIZE_EQUAL(tc, len, i);
+    ABTS_ASSERT(tc, "decompressed contents", memcmp(flat, contents, len) == 0);
+    apr_brigade_cleanup(out);
+
+    /* a stream cut short, and garbage */
+    APR_ASSERT_SUCCESS(tc, "create compressor",
+                       apr_brigade_codec_create(&codec, type, 0, 0, cp, ba));
+    apr_brigade_write(in, NULL, NULL, contents, 1000);
+    APR_BRIGADE_INSERT_TAIL(in, apr_bucket_eos_create(ba));
+    APR_ASSERT_SUCCESS(tc, "compress",
+                       apr_brigade_codec_process(codec, mid, in,
+                                                 APR_BLOCK_READ));
+    apr_bucket_delete(APR_BRIGADE_LAST(mid));
+    apr_brigade_length(mid, 1, &offset);
+    apr_brigade_partition(mid, offset / 2, &e);
+    apr_brigade_cleanup(apr_brigade_split_ex(mid, e, in));
+    APR_BRIGADE_INSERT_TAIL(mid, apr_bucket_eos_create(ba));
+    APR_ASSERT_SUCCESS(tc, "create decompressor",
+                       apr_brigade_codec_create(&codec, type, 1, 0, cp, ba));
+    ABTS_INT_EQUAL(tc, APR_INCOMPLETE,
+                   apr_brigade_codec_process(codec, out, mid,
+                                             APR_BLOCK_READ));
+    apr_brigade_cleanup(mid);
+    apr_brigade_cleanup(out);
+
+    APR_ASSERT_SUCCESS(tc, "create decompressor",
+                       apr_brigade_codec_create(&codec, type, 1, 0, cp, ba));
+    apr_brigade_write(mid, NULL, NULL, hello, strlen(hello));
+    ABTS_INT_EQUAL(tc, APR_EINVAL,
+                   apr_brigade_codec_process(codec, out, mid,
+                                             APR_BLOCK_READ));
+    apr_brigade_cleanup(mid);
+    apr_brigade_cleanup(out);
+
+    apr_file_close(f);
+    apr_file_remove("codec.bin", p);
+    apr_brigade_destroy(in);
+    apr_brigade_destroy(mid);
+    apr_brigade_destroy(out);
+    apr_pool_destroy(cp);
+    apr_bucket_alloc_destroy(ba);
+}
+
+static void test_codec_deflate(abts_case *tc, void *data)
+{
+    codec_roundtrip(tc, APR_BRIGADE_CODEC_DEFLATE);
+}
+
+static void test_codec_gzip(abts_case *tc, void *data)
+{
+    codec_roundtrip(tc, APR_BRIGADE_CODEC_GZIP);
+}
+
+static void test_codec_zstd(abts_case *tc, void *data)
+{
+    codec_roundtrip(tc, APR_BRIGADE_CODEC_ZSTD);
+}
+
+static void test_send(abts_case *tc, void *data)
+{
+    apr_bucket_alloc_t *ba = apr_bucket_alloc_create(p);
+    apr_bucket_brigade *bb = apr_brigade_create(p, ba);
+    apr_socket_t *client, *server;
+    apr_file_t *f;
+    apr_off_t sent;
+    apr_size_t len, total;
+    char body[1000], expect[1012], buf[1024];
+
+    if (make_socket_pair(&client, &server) != APR_SUCCESS) {
+        ABTS_NOT_IMPL(tc, "Skipped: could not connect over loopback");
+        return;
+    }
+
+    memset(body, 'x', sizeof(body));
+    APR_ASSERT_SUCCESS(tc, "open test file",
+                       apr_file_open(&f, TIF_FNAME,
+                                     APR_FOPEN_READ | APR_FOPEN_WRITE
+                                   | APR_FOPEN_TRUNCATE | APR_FOPEN_CREATE
+                                   | APR_FOPEN_SENDFILE_ENABLED,
+                                     APR_OS_DEFAULT, p));
+    len = sizeof(body);
+    APR_ASSERT_SUCCESS(tc, "write test file",
+                       apr_file_write_full(f, body, len, NULL));
+
+    APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_immortal_create("hello", 5, ba));
+    APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_flush_create(ba));
+    apr_brigade_insert_file(bb, f, 0, sizeof(body), p);
+    APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_transient_create(", ", 2, ba));
+    APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_heap_create("world", 5, NULL, ba));
+    APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_eos_create(ba));
+
+    APR_ASSERT_SUCCESS(tc, "send brigade", apr_brigade_send(client, bb, &sent));
+    ABTS_INT_EQUAL(tc, (int)sizeof(expect), (int)sent);
+    ABTS_ASSERT(tc, "sent brigade is empty", APR_BRIGADE_EMPTY(bb));
+
+    memcpy(expect, "hello", 5);
+    memcpy(expect + 5, body, sizeof(body));
+    memcpy(expect + 5 + sizeof(body), ", world", 7);
+
+    for (total = 0; total < sizeof(expect); total += len) {
+        len = sizeof(buf) - total;
+        if (apr_socket_recv(server, buf + total, &len) != APR_SUCCESS) {
+            break;
+        }
+    }
+    ABTS_SIZE_EQUAL(tc, sizeof(expect), total);
+    ABTS_ASSERT(tc, "received the brigade",
+                memcmp(expect, buf, sizeof(expect)) == 0);
+
+    apr_socket_close(client);
+    apr_socket_close(server);
+    apr_file_close(f);
+    apr_file_remove(TIF_FNAME, p);
+    apr_brigade_destroy(bb);
+    apr_bucket_alloc_destroy(ba);
+}
+
+#if APR_HAS_MMAP
+#define SEND_PARTIAL_SIZE (1024 * 1024)
+
+static void test_send_partial(abts_case *tc, void *data)
+{
+    apr_bucket_alloc_t *ba = apr_bucket_alloc_create(p);
+    apr_bucket_brigade *bb = apr_brigade_create(p, ba);
+    apr_socket_t *client, *server;
+    apr_file_t *f;
+    apr_off_t sent, length;
+    apr_size_t i, len, total = 0, received = 0, expected;
+    apr_status_t rv;
+    char *body, *buf;
+    int eagain = 0;
+
+    if (make_socket_pair(&client, &server) != APR_SUCCESS) {
+        ABTS_NOT_IMPL(tc, "Skipped: could not connect over loopback");
+        return;
+    }
+    apr_socket_opt_set(client, APR_SO_SNDBUF, 4096);
+    apr_socket_opt_set(server, APR_SO_RCVBUF, 4096);
+    apr_socket_opt_set(client, APR_SO_NONBLOCK, 1);
+    apr_socket_timeout_set(client, 0);
+
+    body = apr_palloc(p, SEND_PARTIAL_SIZE);
+    for (i = 0; i < SEND_PARTIAL_SIZE; i++) {
+        body[i] = (char)('a' + i % 23);
+    }
+    APR_ASSERT_SUCCESS(tc, "open test file",
+                       apr_file_open(&f, TIF_FNAME,
+                                     APR_FOPEN_READ | APR_FOPEN_WRITE
+                                   | APR_FOPEN_TRUNCATE | APR_FOPEN_CREATE
+                                   | APR_FOPEN_SENDFILE_ENABLED,
+                                     APR_OS_DEFAULT, p));
+    len = SEND_PARTIAL_SIZE;
+    APR_ASSERT_SUCCESS(tc, "write test file",
+                       apr_file_write_full(f, body, len, NULL));
+
+    APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_immortal_create("head", 4, ba));
+    apr_brigade_insert_file(bb, f, 0, SEND_PARTIAL_SIZE, p);
+    APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_immortal_create("tail", 4, ba));
+    expected = 4 + SEND_PARTIAL_SIZE + 4;
+
+    buf = apr_palloc(p, expected);
+    for (;;) {
+        rv = apr_brigade_send(client, bb, &sent);
+        total += (apr_size_t)sent;
+        if (rv == APR_SUCCESS) {
+            break;
+        }
+        ABTS_ASSERT(tc, "send would block", APR_STATUS_IS_EAGAIN(rv));
+        if (!APR_STATUS_IS_EAGAIN(rv)) {
+            break;
+        }
+
+        /* the unsent tail is left in the brigade */
+        ABTS_ASSERT(tc, "unsent tail", !APR_BRIGADE_EMPTY(bb));
+        APR_ASSERT_SUCCESS(tc, "brigade length",
+                           apr_brigade_length(bb, 1, &length));
+        ABTS_SIZE_EQUAL(tc, expected - total, (apr_size_t)length);
+        if (!eagain && total > 4 && total < 4 + SEND_PARTIAL_SIZE) {
+            apr_bucket *e = APR_BRIGADE_FIRST(bb);
+
+            /* the file bucket was split where the socket stopped */
+            ABTS_ASSERT(tc, "split file bucket", APR_BUCKET_IS_FILE(e));
+            ABTS_INT_EQUAL(tc, (int)(total - 4), (int)e->start);
+        }
+        eagain = 1;
+
+        /* make room for the next send */
+        len = expected - received;
+        APR_ASSERT_SUCCESS(tc, "receive",
+                           apr_socket_recv(server, buf + received, &len));
+        received += len;
+    }
+    ABTS_ASSERT(tc, "some send would block", eagain);
+    ABTS_SIZE_EQUAL(tc, expected, total);
+    ABTS_ASSERT(tc, "sent brigade is empty", APR_BRIGADE_EMPTY(bb));
+
+    while (received < expected) {
+        len = expected - received;
+        if (apr_socket_recv(server, buf + received, &len) != APR_SUCCESS) {
+            break;
+        }
+        received += len;
+    }
+    ABTS_SIZE_EQUAL(tc, expected, received);
+    ABTS_ASSERT(tc, "received the head", memcmp(buf, "head", 4) == 0);
+    ABTS_ASSERT(tc, "received the file",
+                memcmp(buf + 4, body, SEND_PARTIAL_SIZE) == 0);
+    ABTS_ASSERT(tc, "received the tail",
+                memcmp(buf + 4 + SEND_PARTIAL_SIZE, "tail", 4) == 0);
+
+    apr_socket_close(client);
+    apr_socket_close(server);
+    apr_file_close(f);
+    apr_file_remove(TIF_FNAME, p);
+    apr_brigade_destroy(bb);
+    apr_bucket_alloc_destroy(ba);
+}
+
+static void test_mmap_policy(abts_case *tc, void *data)
+{
+    apr_bucket_alloc_t *ba = apr_bucket_alloc_create(p);
+    apr_bucket_brigade *bb = apr_brigade_create(p, ba);
+    apr_bucket_mmap_policy_t policy, unmapped;
+    apr_bucket *e;
+    apr_file_t *f;
+    apr_size_t len, total, i;
+    const char *str;
+    char *contents;
+
+    len = 3 * 65536 + 5000;
+    contents = apr_palloc(p, len);
+    for (i = 0; i < len; i++) {
+        contents[i] = 'a' + i % 23;
+    }
+    f = make_test_file(tc, "mmap.bin", "");
+    APR_ASSERT_SUCCESS(tc, "write test file",
+                       apr_file_write_full(f, contents, len, NULL));
+
+    e = apr_bucket_immortal_create("", 0, ba);
+    ABTS_INT_EQUAL(tc, APR_EINVAL, apr_bucket_mmap_set_policy(e, &policy));
+    apr_bucket_destroy(e);
+
+    /* mapped in 64K pieces, prefetched and populated */
+    memset(&policy, 0, sizeof policy);
+    policy.max_size = 65536 + 100;
+    policy.prefetch = 2 * 65536;
+    policy.populate_size = 65536;
+    policy.sequential = 1;
+    e = apr_bucket_file_create(f, 0, len, p, ba);
+    APR_ASSERT_SUCCESS(tc, "set policy", apr_bucket_mmap_set_policy(e, &policy));
+    APR_BRIGADE_INSERT_TAIL(bb, e);
+
+    for (total = 0, e = APR_BRIGADE_FIRST(bb);
+         e != APR_BRIGADE_SENTINEL(bb);
+         e = APR_BUCKET_NEXT(e)) {
+        APR_ASSERT_SUCCESS(tc, "read file",
+                           apr_bucket_read(e, &str, &i, APR_BLOCK_READ));
+        if (APR_BUCKET_IS_MMAP(e)) {
+            ABTS_ASSERT(tc, "mapping size", i <= 65536);
+        }
+        ABTS_ASSERT(tc, "file contents",
+                    total + i <= len
+                    && memcmp(str, contents + total, i) == 0);
+        total += i;
+    }
+    ABTS_SIZE_EQUAL(tc, len, total);
+    apr_brigade_cleanup(bb);
+
+    /* too short to be mapped */
+    memset(&unmapped, 0, sizeof unmapped);
+    unmapped.min_size = len + 1;
+    e = apr_bucket_file_create(f, 0, len, p, ba);
+    APR_ASSERT_SUCCESS(tc, "set policy",
+                       apr_bucket_mmap_set_policy(e, &unmapped));
+    APR_BRIGADE_INSERT_TAIL(bb, e);
+    APR_ASSERT_SUCCESS(tc, "read file",
+                       apr_bucket_read(e, &str, &i, APR_BLOCK_READ));
+    ABTS_ASSERT(tc, "file read, not mapped", APR_BUCKET_IS_HEAP(e));
+
+    apr_brigade_destroy(bb);
+    apr_file_close(f);
+    apr_file_remove("mmap.bin", p);
+    apr_bucket_alloc_destroy(ba);
+}
+#endif
+
+static void test_pipe_buf_size(abts_case *tc, void *data)
+{
+    apr_bucket_alloc_t *ba = apr_bucket_alloc_create(p);
+    apr_bucket_brigade *bb = apr_brigade_create(p, ba);
+    apr_bucket *e;
+    apr_file_t *in, *out;
+    apr_size_t len, total, i;
+    const char *str;
+    char *contents;
+    int n;
+
+    len = 3 * APR_BUCKET_BUFF_SIZE;
+    contents = apr_palloc(p, len);
+    for (i = 0; i < len; i++) {
+        contents[i] = 'a' + i % 23;
+    }
+
+    APR_ASSERT_SUCCESS(tc, "create pipe", apr_file_pipe_create(&in, &out, p));
+    APR_ASSERT_SUCCESS(tc, "write pipe",
+                       apr_file_write_full(out, contents, len, NULL));
+    apr_file_close(out);
+
+    e = apr_bucket_immortal_create("", 0, ba);
+    ABTS_INT_EQUAL(tc, APR_EINVAL, apr_bucket_pipe_set_buf_size(e, 65536));
+    apr_bucket_destroy(e);
+
+    e = apr_bucket_pipe_create(in, ba);
+    APR_ASSERT_SUCCESS(tc, "set buf size",
+                       apr_bucket_pipe_set_buf_size(e, 65536));
+    APR_BRIGADE_INSERT_TAIL(bb, e);
+
+    /* full reads double the size of the next one */
+    for (total = 0, n = 0, e = APR_BRIGADE_FIRST(bb);
+         e != APR_BRIGADE_SENTINEL(bb);
+         e = APR_BUCKET_NEXT(e)) {
+        APR_ASSERT_SUCCESS(tc, "read pipe",
+                           apr_bucket_read(e, &str, &i, APR_BLOCK_READ));
+        if (i) {
+            ABTS_ASSERT(tc, "pipe contents",
+                        total + i <= len
+                        && memcmp(str, contents + total, i) == 0);
+            total += i;
+            n++;
+        }
+    }
+    ABTS_SIZE_EQUAL(tc, len, total);
+    ABTS_ASSERT(tc, "fewer buckets than fixed size reads", n < 3);
+
+    apr_brigade_destroy(bb);
+    apr_bucket_alloc_destroy(ba);
+}
+
+static void test_send_pipe(abts_case *tc, void *data)
+{
+    apr_bucket_alloc_t *ba = apr_bucket_alloc_create(p);
+    apr_bucket_brigade *bb = apr_brigade_create(p, ba);
+    apr_socket_t *client, *server;
+    apr_file_t *in, *out;
+    apr_off_t sent;
+    apr_size_t len, total;
+    const char *expect = "header, piped body, trailer";
+    char buf[64];
+
+    if (make_socket_pair(&client, &server) != APR_SUCCESS) {
+        ABTS_NOT_IMPL(tc, "Skipped: could not connect over loopback");
+        return;
+    }
+
+    APR_ASSERT_SUCCESS(tc, "create pipe", apr_file_pipe_create(&in, &out, p));
+    len = 12;
+    APR_ASSERT_SUCCESS(tc, "write pipe",
+                       apr_file_write_full(out, "piped body, ", len, NULL));
+    apr_file_close(out);
+
+    APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_immortal_create("header, ", 8, ba));
+    APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_pipe_create(in, ba));
+    APR_BRIGADE_INSERT_TAIL(bb, apr_bucket_immortal_create("trailer", 7, ba));
+
+    /* spliced where the platform allows it, read otherwise */
+    APR_ASSERT_SUCCESS(tc, "send brigade", apr_brigade_send(client, bb, &sent));
+    ABTS_INT_EQUAL(tc, (int)strlen(expect), (int)sent);
+    ABTS_ASSERT(tc, "sent brigade is empty", APR_BRIGADE_EMPTY(bb));
+
+    for (total = 0; total < strlen(expect); total += len) {
+        len = sizeof(buf) - total;
+        if (apr_socket_recv(server, buf + total, &len) != APR_SUCCESS) {
+            break;
+        }
+    }
+    ABTS_SIZE_EQUAL(tc, strlen(expect), total);
+    ABTS_ASSERT(tc, "received the brigade",
+                memcmp(expect, buf, strlen(expect)) == 0);
+
+    apr_socket_close(client);
+    apr_socket_close(server);
+    apr_brigade_destroy(bb);
+    apr_bucket_alloc_destroy(ba);
+}
+
 abts_suite *testbuckets(abts_suite *suite)
 {
     suite = ADD_SUITE(suite);
@@ -674,10 +1976,32 @@ abts_suite *testbuckets(abts_suite *suite)
     abts_run_test(suite, test_insertfile, NULL);
     abts_run_test(suite, test_manyfile, NULL);
     abts_run_test(suite, test_truncfile, NULL);
+    abts_run_test(suite, test_file_read_ahead, NULL);
     abts_run_test(suite, test_partition, NULL);
     abts_run_test(suite, test_write_split, NULL);
     abts_run_test(suite, test_write_putstrs, NULL);
     abts_run_test(suite, test_iovec, NULL);
+    abts_run_test(suite, test_coalesce, NULL);
+    abts_run_test(suite, test_reserve, NULL);
+    abts_run_test(suite, test_cursor, NULL);
+    abts_run_test(suite, test_atomic, NULL);
+    abts_run_test(suite, test_alloc_classes, NULL);
+    abts_run_test(suite, test_alloc_stats, NULL);
+    abts_run_test(suite, test_alloc_own_allocator, NULL);
+    abts_run_test(suite, test_spool, NULL);
+    abts_run_test(suite, test_spool_consumed, NULL);
+    abts_run_test(suite, test_codec_deflate, NULL);
+    abts_run_test(suite, test_codec_gzip, NULL);
+    abts_run_test(suite, test_codec_zstd, NULL);
+    abts_run_test(suite, test_digest, NULL);
+    abts_run_test(suite, test_brigade_array, NULL);
+    abts_run_test(suite, test_send, NULL);
+    abts_run_test(suite, test_send_partial, NULL);
+    abts_run_test(suite, test_send_pipe, NULL);
+    abts_run_test(suite, test_pipe_buf_size, NULL);
+#if APR_HAS_MMAP
+    abts_run_test(suite, test_mmap_policy, NULL);
+#endif
 
     return suite;
 }
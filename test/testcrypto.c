@@ -1839,6 +1839,113 @@ static void test_crypto_block_openssl_pad(abts_case *tc, void *data)
 
 }
 
+/**
+ * Test of OpenSSL block crypt of a brigade, fed in odd sized buckets.
+ */
+static void test_crypto_block_brigade_openssl(abts_case *tc, void *data)
+{
+    apr_pool_t *pool = NULL;
+    const apr_crypto_driver_t *driver;
+    apr_crypto_t *f;
+    const apr_crypto_key_t *key;
+    apr_crypto_block_t *block = NULL;
+    apr_bucket_alloc_t *ba;
+    apr_bucket *e;
+    apr_bucket_brigade *in, *mid, *out;
+    const unsigned char *iv = NULL;
+    unsigned char *cipherText = NULL;
+    apr_size_t cipherTextLen = 0;
+    apr_size_t blockSize = 0;
+    char plain[10000], *flat;
+    apr_size_t i, len;
+    apr_off_t total;
+    apr_status_t rv;
+
+    apr_pool_create(&pool, NULL);
+    driver = get_openssl_driver(tc, pool);
+    f = make(tc, pool, driver);
+    key = keysecret(tc, pool, driver, f, APR_KEY_AES_256, APR_MODE_CBC, 1,
+            32, "KEY_AES_256/MODE_CBC");
+    if (!key) {
+        apr_pool_destroy(pool);
+        return;
+    }
+
+    for (i = 0; i < sizeof(plain); i++) {
+        plain[i] = (char)(i * 7 + i / 251);
+    }
+
+    ba = apr_bucket_alloc_create(pool);
+    in = apr_brigade_create(pool, ba);
+    mid = apr_brigade_create(pool, ba);
+    out = apr_brigade_create(pool, ba);
+
+    rv = apr_crypto_block_encrypt_init(&block, &iv, key, &blockSize, pool);
+    ABTS_ASSERT(tc, "failed to apr_crypto_block_encrypt_init",
+            rv == APR_SUCCESS);
+
+    /* feed the plaintext over several calls, in buckets that do not
+     * line up with the cipher blocks */
+    for (i = 0; i < sizeof(plain); i += len) {
+        len = sizeof(plain) - i < 7 ? sizeof(plain) - i : 7;
+        APR_BRIGADE_INSERT_TAIL(in,
+                apr_bucket_heap_create(plain + i, len, NULL, ba));
+        if (i % 700 == 0) {
+            rv = apr_crypto_block_encrypt_brigade(mid, in, blockSize,
+                    APR_BLOCK_READ, block);
+            ABTS_INT_EQUAL(tc, APR_SUCCESS, rv);
+            apr_brigade_length(in, 1, &total);
+            ABTS_ASSERT(tc, "more than a block left over",
+                    total < (apr_off_t)blockSize);
+        }
+    }
+    APR_BRIGADE_INSERT_TAIL(in, apr_bucket_eos_create(ba));
+    rv = apr_crypto_block_encrypt_brigade(mid, in, blockSize, APR_BLOCK_READ,
+            block);
+    ABTS_INT_EQUAL(tc, APR_SUCCESS, rv);
+    ABTS_ASSERT(tc, "input brigade not consumed", APR_BRIGADE_EMPTY(in));
+    ABTS_ASSERT(tc, "EOS not passed on",
+            APR_BUCKET_IS_EOS(APR_BRIGADE_LAST(mid)));
+    apr_crypto_block_cleanup(block);
+
+    /* the result must match a one shot encryption with the same iv */
+    encrypt_block(tc, pool, driver, f, key, (const unsigned char *)plain,
+            sizeof(plain), &cipherText, &cipherTextLen, &iv, &blockSize,
+            "KEY_AES_256/MODE_CBC");
+    rv = apr_brigade_pflatten(mid, &flat, &len, pool);
+    ABTS_INT_EQUAL(tc, APR_SUCCESS, rv);
+    ABTS_ASSERT(tc, "ciphertext length mismatch", len == cipherTextLen);
+    ABTS_ASSERT(tc, "ciphertext mismatch",
+            cipherText && !memcmp(flat, cipherText, cipherTextLen));
+
+    /* and decrypt back to the plaintext, with the ciphertext buckets
+     * no longer aligned on the cipher blocks */
+    block = NULL;
+    rv = apr_crypto_block_decrypt_init(&block, &blockSize, iv, key, pool);
+    ABTS_ASSERT(tc, "failed to apr_crypto_block_decrypt_init",
+            rv == APR_SUCCESS);
+    rv = apr_brigade_partition(mid, 1, &e);
+    ABTS_INT_EQUAL(tc, APR_SUCCESS, rv);
+    rv = apr_crypto_block_decrypt_brigade(out, mid, blockSize, APR_BLOCK_READ,
+            block);
+    ABTS_INT_EQUAL(tc, APR_SUCCESS, rv);
+    ABTS_ASSERT(tc, "EOS not passed on",
+            APR_BUCKET_IS_EOS(APR_BRIGADE_LAST(out)));
+    apr_crypto_block_cleanup(block);
+
+    rv = apr_brigade_pflatten(out, &flat, &len, pool);
+    ABTS_INT_EQUAL(tc, APR_SUCCESS, rv);
+    ABTS_ASSERT(tc, "plaintext length mismatch", len == sizeof(plain));
+    ABTS_ASSERT(tc, "plaintext mismatch", !memcmp(flat, plain, len));
+
+    apr_brigade_destroy(out);
+    apr_brigade_destroy(mid);
+    apr_brigade_destroy(in);
+    apr_bucket_alloc_destroy(ba);
+    apr_pool_destroy(pool);
+
+}
+
 /**
  * Simple test of NSS block crypt.
  */
@@ -2716,6 +2823,9 @@ abts_suite *testcrypto(abts_suite *suite)
     /* test a padded encrypt / decrypt operation - openssl */
     abts_run_test(suite, test_crypto_block_openssl_pad, NULL);
 
+    /* test a padded encrypt / decrypt of a brigade - openssl */
+    abts_run_test(suite, test_crypto_block_brigade_openssl, NULL);
+
     /* test a simple encrypt / decrypt operation - nss */
     abts_run_test(suite, test_crypto_block_nss, NULL);
 
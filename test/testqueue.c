@@ -17,6 +17,7 @@
 #include "apu.h"
 #include "apr_queue.h"
 #include "apr_thread_pool.h"
+#include "apr_thread_proc.h"
 #include "apr_time.h"
 #include "abts.h"
 #include "testutil.h"
@@ -121,6 +122,242 @@ static void test_queue_producer_consumer(abts_case *tc, void *data)
     ABTS_INT_EQUAL(tc, APR_SUCCESS, rv);
 }
 
+#define LOCKFREE_THREADS    4
+#define LOCKFREE_ELEMENTS   100000
+
+static apr_uint64_t lockfree_sums[LOCKFREE_THREADS];
+
+static void * APR_THREAD_FUNC lockfree_producer(apr_thread_t *thd, void *data)
+{
+    apr_size_t base = (apr_size_t)data * LOCKFREE_ELEMENTS;
+    apr_size_t i;
+    apr_status_t rv;
+
+    for (i = 1; i <= LOCKFREE_ELEMENTS; i++) {
+        do {
+            rv = apr_queue_push(queue, (void *)(base + i));
+        } while (rv == APR_EINTR);
+        if (rv != APR_SUCCESS) {
+            break;
+        }
+    }
+
+    apr_thread_exit(thd, rv);
+    return NULL;
+}
+
+static void * APR_THREAD_FUNC lockfree_consumer(apr_thread_t *thd, void *data)
+{
+    apr_size_t n = (apr_size_t)data;
+    apr_size_t i;
+    apr_status_t rv = APR_SUCCESS;
+    void *v;
+
+    for (i = 0; i < LOCKFREE_ELEMENTS; i++) {
+        do {
+            rv = apr_queue_pop(queue, &v);
+        } while (rv == APR_EINTR);
+        if (rv != APR_SUCCESS) {
+            break;
+        }
+        lockfree_sums[n] += (apr_size_t)v;
+    }
+
+    apr_thread_exit(thd, rv);
+    return NULL;
+}
+
+static void * APR_THREAD_FUNC lockfree_waiter(apr_thread_t *thd, void *data)
+{
+    void *v;
+
+    apr_thread_exit(thd, apr_queue_pop(queue, &v));
+    return NULL;
+}
+
+static void test_queue_lockfree(abts_case *tc, void *data)
+{
+    apr_thread_t *threads[2 * LOCKFREE_THREADS];
+    apr_uint64_t sum = 0, total;
+    apr_status_t rv, retval;
+    apr_size_t i;
+    void *v;
+
+    rv = apr_queue_create_ex(&queue, 0, APR_QUEUE_LOCKFREE, p);
+    ABTS_INT_EQUAL(tc, APR_EINVAL, rv);
+
+    /* capacity is rounded up to a power of two */
+    rv = apr_queue_create_ex(&queue, 3, APR_QUEUE_LOCKFREE, p);
+    ABTS_INT_EQUAL(tc, APR_SUCCESS, rv);
+
+    rv = apr_queue_trypop(queue, &v);
+    ABTS_INT_EQUAL(tc, APR_EAGAIN, rv);
+    for (i = 1; i <= 4; i++) {
+        rv = apr_queue_trypush(queue, (void *)i);
+        ABTS_INT_EQUAL(tc, APR_SUCCESS, rv);
+    }
+    rv = apr_queue_trypush(queue, (void *)i);
+    ABTS_INT_EQUAL(tc, APR_EAGAIN, rv);
+    ABTS_INT_EQUAL(tc, 4, apr_queue_size(queue));
+    for (i = 1; i <= 4; i++) {
+        rv = apr_queue_pop(queue, &v);
+        ABTS_INT_EQUAL(tc, APR_SUCCESS, rv);
+        ABTS_PTR_EQUAL(tc, (void *)i, v);
+    }
+    ABTS_INT_EQUAL(tc, 0, apr_queue_size(queue));
+
+    /* every element pushed is popped exactly once */
+    for (i = 0; i < LOCKFREE_THREADS; i++) {
+        lockfree_sums[i] = 0;
+        rv = apr_thread_create(&threads[i], NULL, lockfree_consumer,
+                               (void *)i, p);
+        ABTS_INT_EQUAL(tc, APR_SUCCESS, rv);
+    }
+    for (i = 0; i < LOCKFREE_THREADS; i++) {
+        rv = apr_thread_create(&threads[LOCKFREE_THREADS + i], NULL,
+                               lockfree_producer, (void *)i, p);
+        ABTS_INT_EQUAL(tc, APR_SUCCESS, rv);
+    }
+    for (i = 0; i < 2 * LOCKFREE_THREADS; i++) {
+        rv = apr_thread_join(&retval, threads[i]);
+        ABTS_INT_EQUAL(tc, APR_SUCCESS, rv);
+        ABTS_INT_EQUAL(tc, APR_SUCCESS, retval);
+    }
+    for (i = 0; i < LOCKFREE_THREADS; i++) {
+        sum += lockfree_sums[i];
+    }
+    total = (apr_uint64_t)LOCKFREE_THREADS * LOCKFREE_ELEMENTS;
+    ABTS_TRUE(tc, sum == total * (total + 1) / 2);
+
+    /* a blocked pop is woken up by an interrupt, then by termination */
+    rv = apr_thread_create(&threads[0], NULL, lockfree_waiter, NULL, p);
+    ABTS_INT_EQUAL(tc, APR_SUCCESS, rv);
+    apr_sleep(100000);
+    rv = apr_queue_interrupt_all(queue);
+    ABTS_INT_EQUAL(tc, APR_SUCCESS, rv);
+    apr_thread_join(&retval, threads[0]);
+    ABTS_INT_EQUAL(tc, APR_EINTR, retval);
+
+    rv = apr_thread_create(&threads[0], NULL, lockfree_waiter, NULL, p);
+    ABTS_INT_EQUAL(tc, APR_SUCCESS, rv);
+    apr_sleep(100000);
+    rv = apr_queue_term(queue);
+    ABTS_INT_EQUAL(tc, APR_SUCCESS, rv);
+    apr_thread_join(&retval, threads[0]);
+    ABTS_INT_EQUAL(tc, APR_EOF, retval);
+
+    rv = apr_queue_push(queue, NULL);
+    ABTS_INT_EQUAL(tc, APR_EOF, rv);
+}
+
+static void test_queue_spsc(abts_case *tc, void *data)
+{
+    apr_thread_t *thread;
+    apr_status_t rv, retval;
+    apr_size_t i;
+    int ordered = 1;
+    void *v;
+
+    rv = apr_queue_create_ex(&queue, 16, APR_QUEUE_SPSC, p);
+    ABTS_INT_EQUAL(tc, APR_SUCCESS, rv);
+
+    for (i = 1; i <= 16; i++) {
+        rv = apr_queue_trypush(queue, (void *)i);
+        ABTS_INT_EQUAL(tc, APR_SUCCESS, rv);
+    }
+    rv = apr_queue_trypush(queue, NULL);
+    ABTS_INT_EQUAL(tc, APR_EAGAIN, rv);
+    ABTS_INT_EQUAL(tc, 16, apr_queue_size(queue));
+    for (i = 1; i <= 16; i++) {
+        rv = apr_queue_trypop(queue, &v);
+        ABTS_INT_EQUAL(tc, APR_SUCCESS, rv);
+        ABTS_PTR_EQUAL(tc, (void *)i, v);
+    }
+    rv = apr_queue_trypop(queue, &v);
+    ABTS_INT_EQUAL(tc, APR_EAGAIN, rv);
+
+    /* one producer thread, this thread consuming in order */
+    rv = apr_thread_create(&thread, NULL, lockfree_producer, (void *)0, p);
+    ABTS_INT_EQUAL(tc, APR_SUCCESS, rv);
+    for (i = 1; i <= LOCKFREE_ELEMENTS; i++) {
+        do {
+            rv = apr_queue_pop(queue, &v);
+        } while (rv == APR_EINTR);
+        if (rv != APR_SUCCESS || v != (void *)i) {
+            ordered = 0;
+            break;
+        }
+    }
+    ABTS_INT_EQUAL(tc, APR_SUCCESS, rv);
+    ABTS_TRUE(tc, ordered);
+    rv = apr_thread_join(&retval, thread);
+    ABTS_INT_EQUAL(tc, APR_SUCCESS, rv);
+    ABTS_INT_EQUAL(tc, APR_SUCCESS, retval);
+
+    rv = apr_queue_term(queue);
+    ABTS_INT_EQUAL(tc, APR_SUCCESS, rv);
+    rv = apr_queue_pop(queue, &v);
+    ABTS_INT_EQUAL(tc, APR_EOF, rv);
+}
+
+static void test_queue_batch(abts_case *tc, void *data)
+{
+    apr_uint32_t flags = data ? APR_QUEUE_LOCKFREE : 0;
+    void *in[6], *out[6];
+    unsigned int n;
+    apr_size_t i;
+    apr_status_t rv;
+
+    for (i = 0; i < 6; i++) {
+        in[i] = (void *)(i + 1);
+    }
+
+    rv = apr_queue_create_ex(&queue, 4, flags, p);
+    ABTS_INT_EQUAL(tc, APR_SUCCESS, rv);
+
+    rv = apr_queue_trypop_batch(queue, out, 6, &n);
+    ABTS_INT_EQUAL(tc, APR_EAGAIN, rv);
+    ABTS_INT_EQUAL(tc, 0, n);
+
+    /* only what fits is pushed */
+    rv = apr_queue_push_batch(queue, in, 6, &n);
+    ABTS_INT_EQUAL(tc, APR_SUCCESS, rv);
+    ABTS_INT_EQUAL(tc, 4, n);
+    rv = apr_queue_trypush_batch(queue, in + 4, 2, &n);
+    ABTS_INT_EQUAL(tc, APR_EAGAIN, rv);
+    ABTS_INT_EQUAL(tc, 0, n);
+
+    rv = apr_queue_pop_batch(queue, out, 3, &n);
+    ABTS_INT_EQUAL(tc, APR_SUCCESS, rv);
+    ABTS_INT_EQUAL(tc, 3, n);
+    for (i = 0; i < 3; i++) {
+        ABTS_PTR_EQUAL(tc, in[i], out[i]);
+    }
+
+    rv = apr_queue_trypush_batch(queue, in + 4, 2, &n);
+    ABTS_INT_EQUAL(tc, APR_SUCCESS, rv);
+    ABTS_INT_EQUAL(tc, 2, n);
+
+    /* order is kept across batches and single pops */
+    rv = apr_queue_pop(queue, &out[0]);
+    ABTS_INT_EQUAL(tc, APR_SUCCESS, rv);
+    ABTS_PTR_EQUAL(tc, in[3], out[0]);
+    rv = apr_queue_trypop_batch(queue, out, 6, &n);
+    ABTS_INT_EQUAL(tc, APR_SUCCESS, rv);
+    ABTS_INT_EQUAL(tc, 2, n);
+    ABTS_PTR_EQUAL(tc, in[4], out[0]);
+    ABTS_PTR_EQUAL(tc, in[5], out[1]);
+
+    rv = apr_queue_push_batch(queue, in, 0, &n);
+    ABTS_INT_EQUAL(tc, APR_SUCCESS, rv);
+    ABTS_INT_EQUAL(tc, 0, n);
+
+    rv = apr_queue_term(queue);
+    ABTS_INT_EQUAL(tc, APR_SUCCESS, rv);
+    rv = apr_queue_pop_batch(queue, out, 6, &n);
+    ABTS_INT_EQUAL(tc, APR_EOF, rv);
+}
+
 #endif /* APR_HAS_THREADS */
 
 abts_suite *testqueue(abts_suite *suite)
@@ -129,6 +366,10 @@ abts_suite *testqueue(abts_suite *suite)
 
 #if APR_HAS_THREADS
     abts_run_test(suite, test_queue_producer_consumer, NULL);
+    abts_run_test(suite, test_queue_lockfree, NULL);
+    abts_run_test(suite, test_queue_spsc, NULL);
+    abts_run_test(suite, test_queue_batch, NULL);
+    abts_run_test(suite, test_queue_batch, "lockfree");
 #endif /* APR_HAS_THREADS */
 
     return suite;
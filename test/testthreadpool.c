@@ -0,0 +1,959 @@
+/* Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * The ASF licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "apu.h"
+#include "apr_thread_pool.h"
+#include "apr_atomic.h"
+#include "apr_portable.h"
+#include "apr_time.h"
+#include "abts.h"
+#include "testutil.h"
+
+#define APR_WANT_MEMFUNC
+#include "apr_want.h"
+
+#if APR_HAS_THREADS
+
+/* How long the tests wait for the pool before failing, in milliseconds */
+#define WAIT_MAX 10000
+
+static apr_thread_pool_t *thrp;
+static volatile apr_uint32_t ran, started, pushed, stolen;
+static volatile apr_uint32_t gate1, gate2;
+static apr_os_thread_t pusher;
+static int tag;
+
+static char order[32];
+static volatile apr_uint32_t order_len;
+
+static void reset(void)
+{
+    apr_atomic_set32(&ran, 0);
+    apr_atomic_set32(&started, 0);
+    apr_atomic_set32(&pushed, 0);
+    apr_atomic_set32(&stolen, 0);
+    apr_atomic_set32(&gate1, 0);
+    apr_atomic_set32(&gate2, 0);
+    apr_atomic_set32(&order_len, 0);
+    memset(order, 0, sizeof(order));
+}
+
+static apr_status_t wait_for(volatile apr_uint32_t *counter, apr_uint32_t n)
+{
+    int i;
+
+    for (i = 0; i < WAIT_MAX && apr_atomic_read32(counter) < n; i++) {
+        apr_sleep(1000);
+    }
+    return apr_atomic_read32(counter) >= n ? APR_SUCCESS : APR_TIMEUP;
+}
+
+static void wait_gate(volatile apr_uint32_t *gate)
+{
+    while (!apr_atomic_read32(gate)) {
+        apr_sleep(1000);
+    }
+}
+
+static void *APR_THREAD_FUNC count_task(apr_thread_t *thd, void *data)
+{
+    apr_atomic_inc32(&ran);
+    return data;
+}
+
+static void *APR_THREAD_FUNC gate_task(apr_thread_t *thd, void *data)
+{
+    apr_atomic_inc32(&started);
+    wait_gate(data);
+    return NULL;
+}
+
+static void *APR_THREAD_FUNC order_task(apr_thread_t *thd, void *data)
+{
+    order[apr_atomic_inc32(&order_len)] = *(const char *)data;
+    return data;
+}
+
+static void *APR_THREAD_FUNC steal_child(apr_thread_t *thd, void *data)
+{
+    if (!apr_os_thread_equal(apr_os_thread_current(), pusher)) {
+        apr_atomic_inc32(&stolen);
+    }
+    apr_sleep(1000);
+    apr_atomic_inc32(&ran);
+    return NULL;
+}
+
+static void *APR_THREAD_FUNC steal_root(apr_thread_t *thd, void *data)
+{
+    int i;
+
+    pusher = apr_os_thread_current();
+    for (i = 0; i < 50; i++) {
+        apr_thread_pool_push(thrp, steal_child, NULL,
+                             APR_THREAD_TASK_PRIORITY_NORMAL, NULL);
+    }
+    apr_atomic_set32(&pushed, 1);
+    return NULL;
+}
+
+static void test_ws_steal(abts_case *tc, void *data)
+{
+    apr_status_t rv;
+
+    reset();
+    rv = apr_thread_pool_create_ex(&thrp, 4, 4, APR_THREAD_POOL_WORK_STEALING,
+                                   p);
+    APR_ASSERT_SUCCESS(tc, "create work stealing pool", rv);
+
+    rv = apr_thread_pool_push(thrp, steal_root, NULL,
+                              APR_THREAD_TASK_PRIORITY_NORMAL, NULL);
+    APR_ASSERT_SUCCESS(tc, "push root task", rv);
+
+    /* the tasks pushed by a task go to its thread's deque, the idle
+     * threads steal them from there */
+    APR_ASSERT_SUCCESS(tc, "children ran", wait_for(&ran, 50));
+    ABTS_ASSERT(tc, "children stolen", apr_atomic_read32(&stolen) > 0);
+    ABTS_SIZE_EQUAL(tc, 0, apr_thread_pool_tasks_count(thrp));
+
+    apr_thread_pool_destroy(thrp);
+}
+
+static void *APR_THREAD_FUNC priority_root(apr_thread_t *thd, void *data)
+{
+    apr_thread_pool_push(thrp, order_task, "L",
+                         APR_THREAD_TASK_PRIORITY_LOW, NULL);
+    apr_thread_pool_push(thrp, order_task, "H",
+                         APR_THREAD_TASK_PRIORITY_HIGH, NULL);
+    apr_atomic_set32(&pushed, 1);
+    wait_gate(&gate1);
+    return NULL;
+}
+
+static void test_ws_priority(abts_case *tc, void *data)
+{
+    apr_status_t rv;
+
+    reset();
+    rv = apr_thread_pool_create_ex(&thrp, 1, 1, APR_THREAD_POOL_WORK_STEALING,
+                                   p);
+    APR_ASSERT_SUCCESS(tc, "create work stealing pool", rv);
+
+    rv = apr_thread_pool_push(thrp, priority_root, NULL,
+                              APR_THREAD_TASK_PRIORITY_NORMAL, NULL);
+    APR_ASSERT_SUCCESS(tc, "push root task", rv);
+    APR_ASSERT_SUCCESS(tc, "deque filled", wait_for(&pushed, 1));
+
+    /* pushed from outside, this one goes to the pool's queue */
+    rv = apr_thread_pool_push(thrp, order_task, "N",
+                              APR_THREAD_TASK_PRIORITY_NORMAL, NULL);
+    APR_ASSERT_SUCCESS(tc, "push to the pool's queue", rv);
+    apr_atomic_set32(&gate1, 1);
+
+    APR_ASSERT_SUCCESS(tc, "tasks ran", wait_for(&order_len, 3));
+    ABTS_STR_NEQUAL(tc, "HNL", order, 3);
+
+    apr_thread_pool_destroy(thrp);
+}
+
+static void *APR_THREAD_FUNC cancel_child(apr_thread_t *thd, void *data)
+{
+    apr_atomic_inc32(&started);
+    apr_sleep(20000);
+    apr_atomic_inc32(&ran);
+    return NULL;
+}
+
+static void *APR_THREAD_FUNC cancel_root(apr_thread_t *thd, void *data)
+{
+    int i;
+
+    for (i = 0; i < 20; i++) {
+        apr_thread_pool_push(thrp, cancel_child, NULL,
+                             APR_THREAD_TASK_PRIORITY_NORMAL, &tag);
+    }
+    apr_atomic_set32(&pushed, 1);
+    wait_gate(&gate1);
+    return NULL;
+}
+
+static void test_ws_cancel(abts_case *tc, void *data)
+{
+    apr_uint32_t n;
+    apr_status_t rv;
+
+    reset();
+    rv = apr_thread_pool_create_ex(&thrp, 2, 2, APR_THREAD_POOL_WORK_STEALING,
+                                   p);
+    APR_ASSERT_SUCCESS(tc, "create work stealing pool", rv);
+
+    rv = apr_thread_pool_push(thrp, cancel_root, NULL,
+                              APR_THREAD_TASK_PRIORITY_NORMAL, NULL);
+    APR_ASSERT_SUCCESS(tc, "push root task", rv);
+    APR_ASSERT_SUCCESS(tc, "deque filled", wait_for(&pushed, 1));
+
+    /* the root's thread is held, so a running child was stolen */
+    APR_ASSERT_SUCCESS(tc, "child stolen", wait_for(&started, 1));
+
+    apr_thread_pool_tasks_cancel(thrp, &tag);
+    n = apr_atomic_read32(&ran);
+    ABTS_UINT_EQUAL(tc, apr_atomic_read32(&started), n);
+    ABTS_ASSERT(tc, "deque tasks removed", n < 20);
+    ABTS_SIZE_EQUAL(tc, 0, apr_thread_pool_tasks_count(thrp));
+
+    apr_atomic_set32(&gate1, 1);
+    apr_sleep(50000);
+    ABTS_UINT_EQUAL(tc, n, apr_atomic_read32(&ran));
+
+    apr_thread_pool_destroy(thrp);
+}
+
+static void *APR_THREAD_FUNC handback_root(apr_thread_t *thd, void *data)
+{
+    int i;
+
+    for (i = 0; i < 10; i++) {
+        apr_thread_pool_push(thrp, count_task, NULL,
+                             APR_THREAD_TASK_PRIORITY_NORMAL, NULL);
+    }
+    apr_atomic_set32(&pushed, 1);
+    wait_gate(&gate1);
+    return NULL;
+}
+
+static void test_ws_handback(abts_case *tc, void *data)
+{
+    apr_status_t rv;
+    int i;
+
+    reset();
+    rv = apr_thread_pool_create_ex(&thrp, 2, 2, APR_THREAD_POOL_WORK_STEALING,
+                                   p);
+    APR_ASSERT_SUCCESS(tc, "create work stealing pool", rv);
+    for (i = 0; i < WAIT_MAX && apr_thread_pool_idle_count(thrp) < 2; i++) {
+        apr_sleep(1000);
+    }
+    ABTS_SIZE_EQUAL(tc, 2, apr_thread_pool_idle_count(thrp));
+
+    /* hold the first thread, which then can't steal */
+    rv = apr_thread_pool_push(thrp, gate_task, (void *)&gate2,
+                              APR_THREAD_TASK_PRIORITY_NORMAL, NULL);
+    APR_ASSERT_SUCCESS(tc, "push blocking task", rv);
+    APR_ASSERT_SUCCESS(tc, "blocking task started", wait_for(&started, 1));
+
+    rv = apr_thread_pool_push(thrp, handback_root, NULL,
+                              APR_THREAD_TASK_PRIORITY_NORMAL, NULL);
+    APR_ASSERT_SUCCESS(tc, "push root task", rv);
+    APR_ASSERT_SUCCESS(tc, "deque filled", wait_for(&pushed, 1));
+    ABTS_SIZE_EQUAL(tc, 10, apr_thread_pool_tasks_count(thrp));
+
+    /* stop the last busy thread, the root's, whose deque is handed over
+     * to the pool when it exits */
+    apr_thread_pool_thread_max_set(thrp, 1);
+    apr_atomic_set32(&gate1, 1);
+    for (i = 0; i < WAIT_MAX && apr_thread_pool_threads_count(thrp) > 1; i++) {
+        apr_sleep(1000);
+    }
+    ABTS_SIZE_EQUAL(tc, 1, apr_thread_pool_threads_count(thrp));
+    ABTS_UINT_EQUAL(tc, 0, apr_atomic_read32(&ran));
+    ABTS_SIZE_EQUAL(tc, 10, apr_thread_pool_tasks_count(thrp));
+
+    /* and the remaining thread runs them */
+    apr_atomic_set32(&gate2, 1);
+    APR_ASSERT_SUCCESS(tc, "handed over tasks ran", wait_for(&ran, 10));
+
+    apr_thread_pool_destroy(thrp);
+}
+
+static void test_schedule_order(abts_case *tc, void *data)
+{
+    static const char *names[] = { "0", "1", "2", "3", "4", "5", "6", "7" };
+    apr_status_t rv;
+    int i;
+
+    reset();
+    rv = apr_thread_pool_create(&thrp, 1, 1, p);
+    APR_ASSERT_SUCCESS(tc, "create pool", rv);
+
+    /* hold the thread until all the tasks are due */
+    rv = apr_thread_pool_push(thrp, gate_task, (void *)&gate1,
+                              APR_THREAD_TASK_PRIORITY_NORMAL, NULL);
+    APR_ASSERT_SUCCESS(tc, "push blocking task", rv);
+    APR_ASSERT_SUCCESS(tc, "blocking task started", wait_for(&started, 1));
+
+    /* same delay, so the same or later due times: FIFO order */
+    for (i = 0; i < 8; i++) {
+        rv = apr_thread_pool_schedule(thrp, order_task, (void *)names[i],
+                                      1000, NULL);
+        APR_ASSERT_SUCCESS(tc, "schedule task", rv);
+    }
+    ABTS_SIZE_EQUAL(tc, 8, apr_thread_pool_scheduled_tasks_count(thrp));
+    apr_sleep(20000);
+    apr_atomic_set32(&gate1, 1);
+
+    APR_ASSERT_SUCCESS(tc, "scheduled tasks ran", wait_for(&order_len, 8));
+    ABTS_STR_NEQUAL(tc, "01234567", order, 8);
+
+    apr_thread_pool_destroy(thrp);
+}
+
+static void test_schedule_cancel(abts_case *tc, void *data)
+{
+    apr_thread_pool_timer_t timer, copy, timer2;
+    apr_status_t rv;
+
+    reset();
+    rv = apr_thread_pool_create(&thrp, 1, 1, p);
+    APR_ASSERT_SUCCESS(tc, "create pool", rv);
+
+    /* cancelled before it runs */
+    rv = apr_thread_pool_schedule_ex(thrp, count_task, NULL,
+                                     apr_time_from_sec(10), NULL, &timer);
+    APR_ASSERT_SUCCESS(tc, "schedule task", rv);
+    ABTS_SIZE_EQUAL(tc, 1, apr_thread_pool_scheduled_tasks_count(thrp));
+    copy = timer;
+    rv = apr_thread_pool_schedule_cancel(thrp, &timer);
+    ABTS_INT_EQUAL(tc, APR_SUCCESS, rv);
+    ABTS_PTR_EQUAL(tc, NULL, timer.task);
+    ABTS_SIZE_EQUAL(tc, 0, apr_thread_pool_scheduled_tasks_count(thrp));
+    rv = apr_thread_pool_schedule_cancel(thrp, &timer);
+    ABTS_INT_EQUAL(tc, APR_NOTFOUND, rv);
+    rv = apr_thread_pool_schedule_cancel(thrp, &copy);
+    ABTS_INT_EQUAL(tc, APR_NOTFOUND, rv);
+
+    /* the recycled task of the cancelled one is not the new one */
+    rv = apr_thread_pool_schedule_ex(thrp, count_task, NULL,
+                                     apr_time_from_sec(10), NULL, &timer2);
+    APR_ASSERT_SUCCESS(tc, "schedule task", rv);
+    copy.task = timer2.task;
+    rv = apr_thread_pool_schedule_cancel(thrp, &copy);
+    ABTS_INT_EQUAL(tc, APR_NOTFOUND, rv);
+    ABTS_SIZE_EQUAL(tc, 1, apr_thread_pool_scheduled_tasks_count(thrp));
+    rv = apr_thread_pool_schedule_cancel(thrp, &timer2);
+    ABTS_INT_EQUAL(tc, APR_SUCCESS, rv);
+
+    /* not cancelled after it ran */
+    rv = apr_thread_pool_schedule_ex(thrp, count_task, NULL, 0, NULL,
+                                     &timer);
+    APR_ASSERT_SUCCESS(tc, "schedule task", rv);
+    APR_ASSERT_SUCCESS(tc, "scheduled task ran", wait_for(&ran, 1));
+    rv = apr_thread_pool_schedule_cancel(thrp, &timer);
+    ABTS_INT_EQUAL(tc, APR_NOTFOUND, rv);
+    ABTS_UINT_EQUAL(tc, 1, apr_atomic_read32(&ran));
+
+    apr_thread_pool_destroy(thrp);
+}
+
+static void test_schedule_owner_cancel(abts_case *tc, void *data)
+{
+    static const char *names[] = { "a", "b", "c", "d", "e", "f", "g", "h",
+                                   "i", "j", "k", "l", "m", "n", "o", "p" };
+    static const char expect[] = "acegikmo";
+    int other, i;
+    apr_status_t rv;
+
+    reset();
+    rv = apr_thread_pool_create(&thrp, 1, 1, p);
+    APR_ASSERT_SUCCESS(tc, "create pool", rv);
+
+    /* scheduled out of order, every other task by another owner */
+    for (i = 15; i >= 0; i--) {
+        rv = apr_thread_pool_schedule(thrp, order_task, (void *)names[i],
+                                      20000 + i * 2000,
+                                      (i % 2) ? (void *)&other : NULL);
+        APR_ASSERT_SUCCESS(tc, "schedule task", rv);
+    }
+    ABTS_SIZE_EQUAL(tc, 16, apr_thread_pool_scheduled_tasks_count(thrp));
+
+    /* the remaining ones still run by due time */
+    apr_thread_pool_tasks_cancel(thrp, &other);
+    ABTS_SIZE_EQUAL(tc, 8, apr_thread_pool_scheduled_tasks_count(thrp));
+
+    APR_ASSERT_SUCCESS(tc, "scheduled tasks ran", wait_for(&order_len, 8));
+    apr_sleep(20000);
+    ABTS_UINT_EQUAL(tc, 8, apr_atomic_read32(&order_len));
+    ABTS_STR_NEQUAL(tc, expect, order, 8);
+
+    apr_thread_pool_destroy(thrp);
+}
+
+static void test_schedule_now(abts_case *tc, void *data)
+{
+    apr_status_t rv;
+
+    reset();
+    rv = apr_thread_pool_create(&thrp, 1, 1, p);
+    APR_ASSERT_SUCCESS(tc, "create pool", rv);
+
+    rv = apr_thread_pool_schedule(thrp, count_task, NULL, 0, NULL);
+    APR_ASSERT_SUCCESS(tc, "schedule task now", rv);
+    rv = apr_thread_pool_schedule(thrp, count_task, NULL, -1000, NULL);
+    APR_ASSERT_SUCCESS(tc, "schedule task in the past", rv);
+
+    APR_ASSERT_SUCCESS(tc, "scheduled tasks ran", wait_for(&ran, 2));
+    ABTS_SIZE_EQUAL(tc, 0, apr_thread_pool_scheduled_tasks_count(thrp));
+
+    apr_thread_pool_destroy(thrp);
+}
+
+static void test_handle_wait(abts_case *tc, void *data)
+{
+    apr_thread_pool_handle_t *h1, *h2;
+    void *result = &tag;
+    apr_status_t rv;
+
+    reset();
+    rv = apr_thread_pool_create(&thrp, 1, 1, p);
+    APR_ASSERT_SUCCESS(tc, "create pool", rv);
+
+    rv = apr_thread_pool_push_ex(thrp, gate_task, (void *)&gate1,
+                                 APR_THREAD_TASK_PRIORITY_NORMAL, NULL,
+                                 NULL, 0, &h1);
+    APR_ASSERT_SUCCESS(tc, "push blocking task", rv);
+    rv = apr_thread_pool_push_ex(thrp, count_task, &tag,
+                                 APR_THREAD_TASK_PRIORITY_NORMAL, NULL,
+                                 NULL, 0, &h2);
+    APR_ASSERT_SUCCESS(tc, "push task", rv);
+
+    rv = apr_thread_pool_handle_poll(h1, &result);
+    ABTS_INT_EQUAL(tc, APR_EAGAIN, rv);
+    rv = apr_thread_pool_handle_timedwait(h2, 10000, &result);
+    ABTS_INT_EQUAL(tc, APR_TIMEUP, rv);
+    ABTS_PTR_EQUAL(tc, &tag, result);
+
+    apr_atomic_set32(&gate1, 1);
+    result = &tag;
+    rv = apr_thread_pool_handle_wait(h1, &result);
+    ABTS_INT_EQUAL(tc, APR_SUCCESS, rv);
+    ABTS_PTR_EQUAL(tc, NULL, result);
+
+    /* the task's return value, also once completed */
+    result = NULL;
+    rv = apr_thread_pool_handle_wait(h2, &result);
+    ABTS_INT_EQUAL(tc, APR_SUCCESS, rv);
+    ABTS_PTR_EQUAL(tc, &tag, result);
+    result = NULL;
+    rv = apr_thread_pool_handle_poll(h2, &result);
+    ABTS_INT_EQUAL(tc, APR_SUCCESS, rv);
+    ABTS_PTR_EQUAL(tc, &tag, result);
+    rv = apr_thread_pool_handle_timedwait(h2, 0, NULL);
+    ABTS_INT_EQUAL(tc, APR_SUCCESS, rv);
+
+    apr_thread_pool_handle_release(h1);
+    apr_thread_pool_handle_release(h2);
+    apr_thread_pool_destroy(thrp);
+}
+
+static void test_handle_deps(abts_case *tc, void *data)
+{
+    apr_thread_pool_handle_t *hg, *ha, *hb, *hc, *hd, *deps[2];
+    void *result = NULL;
+    apr_status_t rv;
+
+    reset();
+    rv = apr_thread_pool_create(&thrp, 4, 4, p);
+    APR_ASSERT_SUCCESS(tc, "create pool", rv);
+
+    rv = apr_thread_pool_push_ex(thrp, gate_task, (void *)&gate1,
+                                 APR_THREAD_TASK_PRIORITY_NORMAL, NULL,
+                                 NULL, 0, &hg);
+    APR_ASSERT_SUCCESS(tc, "push blocking task", rv);
+
+    /* a diamond: A before B and C, both before D */
+    rv = apr_thread_pool_push_ex(thrp, order_task, "A",
+                                 APR_THREAD_TASK_PRIORITY_NORMAL, NULL,
+                                 &hg, 1, &ha);
+    APR_ASSERT_SUCCESS(tc, "push A", rv);
+    rv = apr_thread_pool_push_ex(thrp, order_task, "B",
+                                 APR_THREAD_TASK_PRIORITY_NORMAL, NULL,
+                                 &ha, 1, &hb);
+    APR_ASSERT_SUCCESS(tc, "push B", rv);
+    rv = apr_thread_pool_push_ex(thrp, order_task, "C",
+                                 APR_THREAD_TASK_PRIORITY_NORMAL, NULL,
+                                 &ha, 1, &hc);
+    APR_ASSERT_SUCCESS(tc, "push C", rv);
+    deps[0] = hb;
+    deps[1] = hc;
+    rv = apr_thread_pool_push_ex(thrp, order_task, "D",
+                                 APR_THREAD_TASK_PRIORITY_NORMAL, NULL,
+                                 deps, 2, &hd);
+    APR_ASSERT_SUCCESS(tc, "push D", rv);
+
+    /* the waiting tasks are not queued */
+    apr_sleep(20000);
+    ABTS_UINT_EQUAL(tc, 0, apr_atomic_read32(&order_len));
+    ABTS_SIZE_EQUAL(tc, 0, apr_thread_pool_tasks_count(thrp));
+
+    apr_atomic_set32(&gate1, 1);
+    rv = apr_thread_pool_handle_wait(hd, &result);
+    ABTS_INT_EQUAL(tc, APR_SUCCESS, rv);
+    ABTS_STR_EQUAL(tc, "D", result);
+    ABTS_UINT_EQUAL(tc, 4, apr_atomic_read32(&order_len));
+    ABTS_INT_EQUAL(tc, 'A', order[0]);
+    ABTS_ASSERT(tc, "B and C after A, before D",
+                (order[1] == 'B' && order[2] == 'C')
+                || (order[1] == 'C' && order[2] == 'B'));
+    ABTS_INT_EQUAL(tc, 'D', order[3]);
+
+    /* depending on completed tasks */
+    rv = apr_thread_pool_push_ex(thrp, count_task, NULL,
+                                 APR_THREAD_TASK_PRIORITY_NORMAL, NULL,
+                                 deps, 2, NULL);
+    APR_ASSERT_SUCCESS(tc, "push task after completed ones", rv);
+    APR_ASSERT_SUCCESS(tc, "task ran", wait_for(&ran, 1));
+
+    apr_thread_pool_handle_release(hg);
+    apr_thread_pool_handle_release(ha);
+    apr_thread_pool_handle_release(hb);
+    apr_thread_pool_handle_release(hc);
+    apr_thread_pool_handle_release(hd);
+    apr_thread_pool_destroy(thrp);
+}
+
+static void test_handle_cancel(abts_case *tc, void *data)
+{
+    apr_thread_pool_handle_t *hx, *hy, *hz;
+    void *result = &tag;
+    apr_status_t rv;
+    int owner;
+
+    reset();
+    rv = apr_thread_pool_create(&thrp, 1, 1, p);
+    APR_ASSERT_SUCCESS(tc, "create pool", rv);
+
+    rv = apr_thread_pool_push(thrp, gate_task, (void *)&gate1,
+                              APR_THREAD_TASK_PRIORITY_NORMAL, NULL);
+    APR_ASSERT_SUCCESS(tc, "push blocking task", rv);
+    APR_ASSERT_SUCCESS(tc, "blocking task started", wait_for(&started, 1));
+
+    rv = apr_thread_pool_push_ex(thrp, order_task, "X",
+                                 APR_THREAD_TASK_PRIORITY_NORMAL, &owner,
+                                 NULL, 0, &hx);
+    APR_ASSERT_SUCCESS(tc, "push X", rv);
+    rv = apr_thread_pool_push_ex(thrp, order_task, "Y",
+                                 APR_THREAD_TASK_PRIORITY_NORMAL, NULL,
+                                 &hx, 1, &hy);
+    APR_ASSERT_SUCCESS(tc, "push Y", rv);
+    rv = apr_thread_pool_push_ex(thrp, order_task, "Z",
+                                 APR_THREAD_TASK_PRIORITY_NORMAL, NULL,
+                                 &hy, 1, &hz);
+    APR_ASSERT_SUCCESS(tc, "push Z", rv);
+
+    /* completed while the only thread is still busy, so without running */
+    apr_thread_pool_tasks_cancel(thrp, &owner);
+    rv = apr_thread_pool_handle_poll(hx, NULL);
+    ABTS_INT_EQUAL(tc, APR_NOTFOUND, rv);
+    rv = apr_thread_pool_handle_poll(hy, NULL);
+    ABTS_INT_EQUAL(tc, APR_NOTFOUND, rv);
+    rv = apr_thread_pool_handle_wait(hz, &result);
+    ABTS_INT_EQUAL(tc, APR_NOTFOUND, rv);
+    ABTS_PTR_EQUAL(tc, NULL, result);
+
+    apr_atomic_set32(&gate1, 1);
+    apr_sleep(20000);
+    ABTS_UINT_EQUAL(tc, 0, apr_atomic_read32(&order_len));
+
+    apr_thread_pool_handle_release(hx);
+    apr_thread_pool_handle_release(hy);
+    apr_thread_pool_handle_release(hz);
+    apr_thread_pool_destroy(thrp);
+}
+
+static void *APR_THREAD_FUNC gate_opener(apr_thread_t *thd, void *data)
+{
+    apr_sleep(50000);
+    apr_atomic_set32(data, 1);
+    apr_thread_exit(thd, APR_SUCCESS);
+    return NULL;
+}
+
+static void test_handle_destroy(abts_case *tc, void *data)
+{
+    apr_thread_pool_handle_t *hg, *hw;
+    apr_thread_t *opener;
+    apr_status_t rv, retval;
+
+    reset();
+    rv = apr_thread_pool_create(&thrp, 1, 1, p);
+    APR_ASSERT_SUCCESS(tc, "create pool", rv);
+
+    rv = apr_thread_pool_push_ex(thrp, gate_task, (void *)&gate1,
+                                 APR_THREAD_TASK_PRIORITY_NORMAL, NULL,
+                                 NULL, 0, &hg);
+    APR_ASSERT_SUCCESS(tc, "push blocking task", rv);
+    rv = apr_thread_pool_push_ex(thrp, order_task, "W",
+                                 APR_THREAD_TASK_PRIORITY_NORMAL, NULL,
+                                 &hg, 1, &hw);
+    APR_ASSERT_SUCCESS(tc, "push waiting task", rv);
+    APR_ASSERT_SUCCESS(tc, "blocking task started", wait_for(&started, 1));
+    apr_thread_pool_handle_release(hg);
+    apr_thread_pool_handle_release(hw);
+
+    /* the waiting task is dropped once its dependency completes */
+    rv = apr_thread_create(&opener, NULL, gate_opener, (void *)&gate1, p);
+    APR_ASSERT_SUCCESS(tc, "create opener thread", rv);
+    apr_thread_pool_destroy(thrp);
+    apr_thread_join(&retval, opener);
+    ABTS_UINT_EQUAL(tc, 0, apr_atomic_read32(&order_len));
+}
+
+static void test_handle_foreign(abts_case *tc, void *data)
+{
+    apr_thread_pool_t *other;
+    apr_thread_pool_handle_t *h, *h2 = NULL;
+    apr_status_t rv;
+
+    reset();
+    rv = apr_thread_pool_create(&thrp, 1, 1, p);
+    APR_ASSERT_SUCCESS(tc, "create pool", rv);
+    rv = apr_thread_pool_create(&other, 1, 1, p);
+    APR_ASSERT_SUCCESS(tc, "create other pool", rv);
+
+    rv = apr_thread_pool_push_ex(other, count_task, NULL,
+                                 APR_THREAD_TASK_PRIORITY_NORMAL, NULL,
+                                 NULL, 0, &h);
+    APR_ASSERT_SUCCESS(tc, "push task", rv);
+    rv = apr_thread_pool_push_ex(thrp, count_task, NULL,
+                                 APR_THREAD_TASK_PRIORITY_NORMAL, NULL,
+                                 &h, 1, &h2);
+    ABTS_INT_EQUAL(tc, APR_EINVAL, rv);
+    ABTS_PTR_EQUAL(tc, NULL, h2);
+
+    rv = apr_thread_pool_handle_wait(h, NULL);
+    ABTS_INT_EQUAL(tc, APR_SUCCESS, rv);
+    ABTS_UINT_EQUAL(tc, 1, apr_atomic_read32(&ran));
+
+    apr_thread_pool_handle_release(h);
+    apr_thread_pool_destroy(other);
+    apr_thread_pool_destroy(thrp);
+}
+
+#define LOOP_MAX 1000
+
+static volatile apr_uint32_t hits[LOOP_MAX];
+static volatile apr_uint32_t calls;
+
+static apr_status_t hit_range(void *baton, apr_size_t begin, apr_size_t end)
+{
+    apr_size_t i;
+
+    apr_atomic_inc32(&calls);
+    for (i = begin; i < end; i++) {
+        apr_atomic_inc32(&hits[i]);
+    }
+    return APR_SUCCESS;
+}
+
+static apr_status_t fail_range(void *baton, apr_size_t begin, apr_size_t end)
+{
+    apr_atomic_inc32(&calls);
+    if (begin <= 500 && 500 < end) {
+        return APR_EGENERAL;
+    }
+    return APR_SUCCESS;
+}
+
+static apr_status_t cancel_range(void *baton, apr_size_t begin,
+                                 apr_size_t end)
+{
+    /* the helpers are still queued behind the blocking tasks */
+    if (0 == apr_atomic_inc32(&calls)) {
+        apr_thread_pool_tasks_cancel(thrp, NULL);
+    }
+    for (; begin < end; begin++) {
+        apr_atomic_inc32(&hits[begin]);
+    }
+    return APR_SUCCESS;
+}
+
+static apr_status_t sum_range(void *baton, void *partial,
+                              apr_size_t begin, apr_size_t end)
+{
+    apr_uint64_t *sum = partial;
+    apr_size_t i;
+
+    apr_atomic_inc32(&calls);
+    for (i = begin; i < end; i++) {
+        *sum += i;
+    }
+    return APR_SUCCESS;
+}
+
+static void sum_combine(void *baton, void *result, const void *partial)
+{
+    *(apr_uint64_t *)result += *(const apr_uint64_t *)partial;
+}
+
+static apr_status_t sum_loop(apr_size_t begin, apr_size_t end,
+                             apr_size_t grain, apr_uint64_t *sum)
+{
+    apr_uint64_t zero = 0;
+
+    return apr_thread_pool_parallel_reduce(thrp, begin, end, grain,
+                                           sum_range, sum_combine, NULL,
+                                           &zero, sum, sizeof(*sum), p);
+}
+
+static void reset_hits(void)
+{
+    apr_size_t i;
+
+    for (i = 0; i < LOOP_MAX; i++) {
+        apr_atomic_set32(&hits[i], 0);
+    }
+    apr_atomic_set32(&calls, 0);
+}
+
+static void test_parallel_for(abts_case *tc, void *data)
+{
+    apr_status_t rv;
+    apr_size_t i;
+
+    reset();
+    reset_hits();
+    rv = apr_thread_pool_create(&thrp, 4, 4, p);
+    APR_ASSERT_SUCCESS(tc, "create pool", rv);
+
+    rv = apr_thread_pool_parallel_for(thrp, 3, LOOP_MAX - 3, 7, hit_range,
+                                      NULL);
+    APR_ASSERT_SUCCESS(tc, "parallel for", rv);
+    for (i = 0; i < LOOP_MAX; i++) {
+        ABTS_UINT_EQUAL(tc, (3 <= i && i < LOOP_MAX - 3),
+                        apr_atomic_read32(&hits[i]));
+    }
+
+    /* grain larger than the range: a single chunk */
+    apr_atomic_set32(&calls, 0);
+    rv = apr_thread_pool_parallel_for(thrp, 0, 10, 100, hit_range, NULL);
+    APR_ASSERT_SUCCESS(tc, "parallel for in one chunk", rv);
+    ABTS_UINT_EQUAL(tc, 1, apr_atomic_read32(&calls));
+    ABTS_UINT_EQUAL(tc, 1, apr_atomic_read32(&hits[0]));
+    ABTS_UINT_EQUAL(tc, 2, apr_atomic_read32(&hits[9]));
+
+    /* empty ranges */
+    apr_atomic_set32(&calls, 0);
+    rv = apr_thread_pool_parallel_for(thrp, 10, 10, 1, hit_range, NULL);
+    APR_ASSERT_SUCCESS(tc, "parallel for on an empty range", rv);
+    rv = apr_thread_pool_parallel_for(thrp, 10, 5, 1, hit_range, NULL);
+    APR_ASSERT_SUCCESS(tc, "parallel for on a reversed range", rv);
+    ABTS_UINT_EQUAL(tc, 0, apr_atomic_read32(&calls));
+
+    apr_thread_pool_destroy(thrp);
+}
+
+static void test_parallel_error(abts_case *tc, void *data)
+{
+    apr_status_t rv;
+
+    reset();
+    reset_hits();
+    rv = apr_thread_pool_create(&thrp, 4, 4, p);
+    APR_ASSERT_SUCCESS(tc, "create pool", rv);
+
+    rv = apr_thread_pool_parallel_for(thrp, 0, LOOP_MAX, 1, fail_range,
+                                      NULL);
+    ABTS_INT_EQUAL(tc, APR_EGENERAL, rv);
+    ABTS_ASSERT(tc, "stopped before the end",
+                apr_atomic_read32(&calls) < LOOP_MAX);
+
+    apr_thread_pool_destroy(thrp);
+}
+
+static void test_parallel_cancel(abts_case *tc, void *data)
+{
+    apr_status_t rv;
+    apr_size_t i;
+    int round;
+
+    reset();
+    rv = apr_thread_pool_create(&thrp, 2, 2, p);
+    APR_ASSERT_SUCCESS(tc, "create pool", rv);
+
+    for (round = 0; round < 10; round++) {
+        reset();
+        reset_hits();
+        for (i = 0; i < 2; i++) {
+            rv = apr_thread_pool_push(thrp, gate_task, (void *)&gate1,
+                                      APR_THREAD_TASK_PRIORITY_NORMAL, NULL);
+            APR_ASSERT_SUCCESS(tc, "push blocking task", rv);
+        }
+        APR_ASSERT_SUCCESS(tc, "blocking tasks started",
+                           wait_for(&started, 2));
+
+        /* the caller runs the whole loop, its helpers being cancelled */
+        rv = apr_thread_pool_parallel_for(thrp, 0, LOOP_MAX, 1,
+                                          cancel_range, NULL);
+        APR_ASSERT_SUCCESS(tc, "parallel for with cancelled helpers", rv);
+        for (i = 0; i < LOOP_MAX; i++) {
+            ABTS_UINT_EQUAL(tc, 1, apr_atomic_read32(&hits[i]));
+        }
+        ABTS_SIZE_EQUAL(tc, 0, apr_thread_pool_tasks_count(thrp));
+
+        apr_atomic_set32(&gate1, 1);
+        while (apr_thread_pool_busy_count(thrp)) {
+            apr_sleep(1000);
+        }
+    }
+
+    /* the recycled loops still work */
+    reset_hits();
+    rv = apr_thread_pool_parallel_for(thrp, 0, LOOP_MAX, 7, hit_range, NULL);
+    APR_ASSERT_SUCCESS(tc, "parallel for after cancel", rv);
+    for (i = 0; i < LOOP_MAX; i++) {
+        ABTS_UINT_EQUAL(tc, 1, apr_atomic_read32(&hits[i]));
+    }
+
+    apr_thread_pool_destroy(thrp);
+}
+
+static void test_parallel_reduce(abts_case *tc, void *data)
+{
+    apr_uint64_t sum, zero = 0;
+    apr_status_t rv;
+
+    reset();
+    reset_hits();
+    rv = apr_thread_pool_create(&thrp, 4, 4, p);
+    APR_ASSERT_SUCCESS(tc, "create pool", rv);
+
+    rv = sum_loop(0, 100000, 16, &sum);
+    APR_ASSERT_SUCCESS(tc, "parallel reduce", rv);
+    ABTS_ASSERT(tc, "sum of the range", sum == APR_UINT64_C(4999950000));
+
+    apr_atomic_set32(&calls, 0);
+    rv = sum_loop(5, 10, 100, &sum);
+    APR_ASSERT_SUCCESS(tc, "parallel reduce in one chunk", rv);
+    ABTS_ASSERT(tc, "sum of the small range", sum == 35);
+    ABTS_UINT_EQUAL(tc, 1, apr_atomic_read32(&calls));
+
+    /* empty range: the identity */
+    sum = 42;
+    rv = sum_loop(10, 10, 1, &sum);
+    APR_ASSERT_SUCCESS(tc, "parallel reduce on an empty range", rv);
+    ABTS_ASSERT(tc, "identity", sum == 0);
+
+    rv = apr_thread_pool_parallel_reduce(thrp, 0, 10, 1, sum_range,
+                                         sum_combine, NULL, &zero, &sum, 0,
+                                         p);
+    ABTS_INT_EQUAL(tc, APR_EINVAL, rv);
+
+    apr_thread_pool_destroy(thrp);
+}
+
+struct loop_baton
+{
+    apr_size_t end;
+    apr_uint64_t sum;
+    apr_status_t rv;
+};
+
+static void *APR_THREAD_FUNC loop_task(apr_thread_t *thd, void *data)
+{
+    struct loop_baton *b = data;
+
+    b->rv = sum_loop(0, b->end, 1, &b->sum);
+    apr_atomic_inc32(&ran);
+    return NULL;
+}
+
+static void test_parallel_in_task(abts_case *tc, void *data)
+{
+    struct loop_baton b = { 1000, 0, APR_EGENERAL };
+    apr_status_t rv;
+
+    reset();
+    rv = apr_thread_pool_create(&thrp, 1, 1, p);
+    APR_ASSERT_SUCCESS(tc, "create pool", rv);
+
+    /* the helpers can't run until the loop is done */
+    rv = apr_thread_pool_push(thrp, loop_task, &b,
+                              APR_THREAD_TASK_PRIORITY_NORMAL, NULL);
+    APR_ASSERT_SUCCESS(tc, "push loop task", rv);
+    APR_ASSERT_SUCCESS(tc, "loop task ran", wait_for(&ran, 1));
+    APR_ASSERT_SUCCESS(tc, "loop in a task", b.rv);
+    ABTS_ASSERT(tc, "sum in a task", b.sum == 499500);
+
+    apr_thread_pool_destroy(thrp);
+}
+
+static void test_parallel_concurrent(abts_case *tc, void *data)
+{
+    struct loop_baton b[4];
+    apr_uint64_t sum;
+    apr_status_t rv;
+    int i, round;
+
+    reset();
+    rv = apr_thread_pool_create(&thrp, 4, 4, p);
+    APR_ASSERT_SUCCESS(tc, "create pool", rv);
+
+    for (round = 0; round < 10; round++) {
+        apr_atomic_set32(&ran, 0);
+        for (i = 0; i < 4; i++) {
+            b[i].end = 10000 + i;
+            b[i].sum = 0;
+            b[i].rv = APR_EGENERAL;
+            rv = apr_thread_pool_push(thrp, loop_task, &b[i],
+                                      APR_THREAD_TASK_PRIORITY_NORMAL, NULL);
+            APR_ASSERT_SUCCESS(tc, "push loop task", rv);
+        }
+        rv = sum_loop(0, 20000, 1, &sum);
+        APR_ASSERT_SUCCESS(tc, "loop along with the tasks", rv);
+        ABTS_ASSERT(tc, "sum along with the tasks",
+                    sum == APR_UINT64_C(199990000));
+
+        APR_ASSERT_SUCCESS(tc, "loop tasks ran", wait_for(&ran, 4));
+        for (i = 0; i < 4; i++) {
+            apr_uint64_t n = b[i].end;
+
+            APR_ASSERT_SUCCESS(tc, "concurrent loop", b[i].rv);
+            ABTS_ASSERT(tc, "concurrent sum", b[i].sum == n * (n - 1) / 2);
+        }
+    }
+
+    apr_thread_pool_destroy(thrp);
+}
+
+#endif /* APR_HAS_THREADS */
+
+abts_suite *testthreadpool(abts_suite *suite)
+{
+    suite = ADD_SUITE(suite);
+
+#if APR_HAS_THREADS
+    abts_run_test(suite, test_ws_steal, NULL);
+    abts_run_test(suite, test_ws_priority, NULL);
+    abts_run_test(suite, test_ws_cancel, NULL);
+    abts_run_test(suite, test_ws_handback, NULL);
+    abts_run_test(suite, test_schedule_order, NULL);
+    abts_run_test(suite, test_schedule_cancel, NULL);
+    abts_run_test(suite, test_schedule_owner_cancel, NULL);
+    abts_run_test(suite, test_schedule_now, NULL);
+    abts_run_test(suite, test_handle_wait, NULL);
+    abts_run_test(suite, test_handle_deps, NULL);
+    abts_run_test(suite, test_handle_cancel, NULL);
+    abts_run_test(suite, test_handle_destroy, NULL);
+    abts_run_test(suite, test_handle_foreign, NULL);
+    abts_run_test(suite, test_parallel_for, NULL);
+    abts_run_test(suite, test_parallel_error, NULL);
+    abts_run_test(suite, test_parallel_cancel, NULL);
+    abts_run_test(suite, test_parallel_reduce, NULL);
+    abts_run_test(suite, test_parallel_in_task, NULL);
+    abts_run_test(suite, test_parallel_concurrent, NULL);
+#endif /* APR_HAS_THREADS */
+
+    return suite;
+}
@@ -86,6 +86,7 @@ abts_suite *testxlate(abts_suite *suite);
 abts_suite *testrmm(abts_suite *suite);
 abts_suite *testdbm(abts_suite *suite);
 abts_suite *testsiphash(abts_suite *suite);
+abts_suite *testthreadpool(abts_suite *suite);
 abts_suite *testjson(abts_suite *suite);
 abts_suite *testjose(abts_suite *suite);
 